@@ -11,9 +11,25 @@
 #include "shader.h"
 #include "camera.h"
 #include "mesh.h"
+#include "indirect_renderer.h"
+#include "light_clusters.h"
+#include "shader_watcher.h"
+#include "headless_context.h"
+#include "frame_writer.h"
+#include "camera_path.h"
+#include "benchmark.h"
+#include "profiler.h"
+#include "gl_trace.h"
+#include "gl_stats.h"
+#include "gl_resources.h"
+#include "render_graph.h"
+#include "ssao_renderer.h"
 #include <map>
 #include <model.h>
 #include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 #define SCR_WIDTH 1280
 #define SCR_HEIGHT 720
@@ -29,12 +45,15 @@ const char* skyboxFragmentPath = "shaders/cubemap.fs";
 const char* simpleVertexPath = "shaders/simple.vs";
 const char* simpleGeometryPath = "shaders/simple.gs";
 const char* simpleFragmentPath = "shaders/simple.fs";
+/* Point shadow depth pass, built with PointShadowRenderer::getShaderDefines(). */
 const char* simpleDepthVertexPath = "shaders/simpleDepth.vs";
-const char* simpleDepthGeometryPath = "shaders/simpleDepth.gs";
 const char* simpleDepthFragmentPath = "shaders/simpleDepth.fs";
 const char* normalVertexPath = "shaders/normal.vs";
 const char* normalFragmentPath = "shaders/normal.fs";
 const char* normalGeometryPath = "shaders/normal.gs";
+/* Directional light shadows (CascadedShadowMap), receivers build shader.fs with CASCADED_SHADOWS. */
+const char* cascadeDepthVertexPath = "shaders/cascade_depth.vs";
+const char* cascadeDepthFragmentPath = "shaders/cascade_depth.fs";
 const char* simpleShadowVertexPath = "shaders/shadow.vs";
 const char* simpleShadowFragmentPath = "shaders/shadow.fs";
 const char* normalMappingVertexPath = "shaders/normal_map.vs";
@@ -45,28 +64,45 @@ const char* lightingVertexPath = "shaders/lighting.vs";
 const char* lightingFragmentPath = "shaders/lighting.fs";
 const char* hdrVertexPath = "shaders/hdr.vs";
 const char* hdrFragmentPath = "shaders/hdr.fs";
-const char* bloomVertexPath = "shaders/bloom.vs";
-const char* bloomFragmentPath = "shaders/bloom.fs";
+/* The bloom scene shader is lighting.vs/lighting.fs built with bloomDefines. */
+const char* bloomVertexPath = "shaders/lighting.vs";
+const char* bloomFragmentPath = "shaders/lighting.fs";
 const char* lightboxFragmentPath = "shaders/light_box.fs";
 const char* blurVertexPath = "shaders/blur.vs";
 const char* blurFragmentPath = "shaders/blur.fs";
+/* Mip chain bloom (BloomRenderer), both passes use blur.vs. */
+const char* bloomDownsampleFragmentPath = "shaders/bloom_downsample.fs";
+const char* bloomUpsampleFragmentPath = "shaders/bloom_upsample.fs";
 const char* bloomfinalVertexPath = "shaders/bloom_final.vs";
 const char* bloomfinalFragmentPath = "shaders/bloom_final.fs";
 const char* bufferVertexPath = "shaders/buffer.vs";
 const char* bufferFragmentPath = "shaders/buffer.fs";
+const char* bufferAtlasVertexPath = "shaders/buffer_atlas.vs";
+const char* bufferAtlasIndirectVertexPath = "shaders/buffer_atlas_indirect.vs";
+const char* bufferAtlasFragmentPath = "shaders/buffer_atlas.fs";
 const char* defferedShadingVertexPath = "shaders/deferred_shading.vs";
 const char* defferedShadingFragmentPath = "shaders/deferred_shading.fs";
 const char* defferedLightBoxVertexPath = "shaders/deferred_light_box.vs";
 const char* defferedLightBoxFragmentPath = "shaders/deferred_light_box.fs";
+/* Light volume deferred lighting, light_volume.fs is built plain, with STENCIL_PASS and with AMBIENT_PASS. */
+const char* lightVolumeVertexPath = "shaders/light_volume.vs";
+const char* lightVolumeFragmentPath = "shaders/light_volume.fs";
 const char* ssaoGeometryVertexPath = "shaders/ssao_geometry.vs";
 const char* ssaoGeometryFragmentPath = "shaders/ssao_geometry.fs";
 const char* ssaoVertexPath = "shaders/ssao.vs";
-const char* ssaoLightingFragmentPath = "shaders/ssao_lighting.fs";
+/* The SSAO lighting pass is deferred_shading.fs built with ssaoLightingDefines. */
+const char* ssaoLightingFragmentPath = "shaders/deferred_shading.fs";
 const char* ssaoFragmentPath = "shaders/ssao.fs";
 const char* ssaoBlurFragmentPath = "shaders/ssao_blur.fs";
+const char* ssaoUpsampleFragmentPath = "shaders/ssao_upsample.fs";
+/* Horizon based AO mode of SSAORenderer, built with ssao.vs like the passes above. */
+const char* depthPyramidFragmentPath = "shaders/depth_pyramid.fs";
+const char* gtaoFragmentPath = "shaders/gtao.fs";
+const char* gtaoTemporalFragmentPath = "shaders/gtao_temporal.fs";
 /* PBR shaders. */
 const char* pbrVertexPath = "shaders/pbr.vs";
 const char* pbrFragmentPath = "shaders/pbr.fs";
+const char* pbrIndirectVertexPath = "shaders/pbr_indirect.vs";
 const char* cubemapVertexPath = "shaders/cubemap.vs";
 const char* equirectangularToCubemapFragmentPath = "shaders/equirectangular_to_cubemap.fs";
 const char* irradianceConvolutionFragmentPath = "shaders/irradiance_convolution.fs";
@@ -76,6 +112,13 @@ const char* prefilterFragmentPath = "shaders/prefilter.fs";
 const char* brdfVertexPath = "shaders/brdf.vs";
 const char* brdfFragmentPath = "shaders/brdf.fs";
 
+/* Shader permutations. */
+const ShaderDefines bloomDefines{ { "NR_LIGHTS", "4" } };
+const ShaderDefines ssaoLightingDefines{ { "SSAO", "" }, { "NR_LIGHTS", "1" } };
+const ShaderDefines ssaoGeometryInstancedDefines{ { "INSTANCED", "" } };
+const ShaderDefines lightVolumeStencilDefines{ { "STENCIL_PASS", "" } };
+const ShaderDefines lightVolumeAmbientDefines{ { "AMBIENT_PASS", "" } };
+const ShaderDefines cascadedShadowDefines{ { "CASCADED_SHADOWS", "" } };
 
 /* Models. */
 const string modelPath = "models/backpack.obj";
@@ -127,12 +170,20 @@ float lastFrame = 0.0f;
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool first_mouse = true;
+/* Set by framebuffer_size_callback, the render loop resizes its targets when it sees the change. */
+int framebufferWidth = SCR_WIDTH, framebufferHeight = SCR_HEIGHT;
+bool framebufferResized = false;
+/* AO technique the scene is lit with, O switches it while running. */
+AO_Mode aoMode = AO_MODE_SSAO;
+bool aoKeyDown = false;
 
 /** Callbacks. */
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) 
 {
-	glViewport(0, 0, width, height);
+	framebufferWidth = width;
+	framebufferHeight = height;
+	framebufferResized = true;
 }
 
 void processInput(GLFWwindow *window) 
@@ -152,6 +203,13 @@ void processInput(GLFWwindow *window)
 	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
 		camera.process_keyboard(CAMERA_RIGHT, deltaTime);
 	}
+	/* Once per press, not once per frame the key is held. */
+	bool aoKey = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+	if (aoKey && !aoKeyDown) {
+		aoMode = aoMode == AO_MODE_SSAO ? AO_MODE_GTAO : AO_MODE_SSAO;
+		std::cout << "AO mode: " << (aoMode == AO_MODE_GTAO ? "gtao" : "ssao") << std::endl;
+	}
+	aoKeyDown = aoKey;
 }
 
 void mouse_callback(GLFWwindow *window, double xPos, double yPos) 
@@ -176,107 +234,92 @@ void scroll_callback(GLFWwindow *window, double xoffset, double yoffset)
 	camera.process_mouse_scroll(static_cast<float>(yoffset));
 }
 
-unsigned int sphereVAO = 0;
-unsigned int indexCount;
-void renderSphere()
+GeometryHandle sphereGeometry;
+/* Builds the unit UV sphere in the geometry arena. */
+void setupSphere()
 {
-	if (sphereVAO == 0)
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> uv;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned int> indices;
+
+	const unsigned int X_SEGMENTS = 64;
+	const unsigned int Y_SEGMENTS = 64;
+	const float PI = 3.14159265359f;
+	for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
 	{
-		glGenVertexArrays(1, &sphereVAO);
-
-		unsigned int vbo, ebo;
-		glGenBuffers(1, &vbo);
-		glGenBuffers(1, &ebo);
-
-		std::vector<glm::vec3> positions;
-		std::vector<glm::vec2> uv;
-		std::vector<glm::vec3> normals;
-		std::vector<unsigned int> indices;
-
-		const unsigned int X_SEGMENTS = 64;
-		const unsigned int Y_SEGMENTS = 64;
-		const float PI = 3.14159265359f;
-		for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+		for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
 		{
-			for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
-			{
-				float xSegment = (float)x / (float)X_SEGMENTS;
-				float ySegment = (float)y / (float)Y_SEGMENTS;
-				float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-				float yPos = std::cos(ySegment * PI);
-				float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
-
-				positions.push_back(glm::vec3(xPos, yPos, zPos));
-				uv.push_back(glm::vec2(xSegment, ySegment));
-				normals.push_back(glm::vec3(xPos, yPos, zPos));
-			}
+			float xSegment = (float)x / (float)X_SEGMENTS;
+			float ySegment = (float)y / (float)Y_SEGMENTS;
+			float xPos = std::cos(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+			float yPos = std::cos(ySegment * PI);
+			float zPos = std::sin(xSegment * 2.0f * PI) * std::sin(ySegment * PI);
+
+			positions.push_back(glm::vec3(xPos, yPos, zPos));
+			uv.push_back(glm::vec2(xSegment, ySegment));
+			normals.push_back(glm::vec3(xPos, yPos, zPos));
 		}
+	}
 
-		bool oddRow = false;
-		for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+	bool oddRow = false;
+	for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+	{
+		if (!oddRow) // even rows: y == 0, y == 2; and so on
 		{
-			if (!oddRow) // even rows: y == 0, y == 2; and so on
+			for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
 			{
-				for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
-				{
-					indices.push_back(y * (X_SEGMENTS + 1) + x);
-					indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-				}
+				indices.push_back(y * (X_SEGMENTS + 1) + x);
+				indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
 			}
-			else
+		}
+		else
+		{
+			for (int x = X_SEGMENTS; x >= 0; --x)
 			{
-				for (int x = X_SEGMENTS; x >= 0; --x)
-				{
-					indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
-					indices.push_back(y * (X_SEGMENTS + 1) + x);
-				}
+				indices.push_back((y + 1) * (X_SEGMENTS + 1) + x);
+				indices.push_back(y * (X_SEGMENTS + 1) + x);
 			}
-			oddRow = !oddRow;
 		}
-		indexCount = static_cast<unsigned int>(indices.size());
+		oddRow = !oddRow;
+	}
 
-		std::vector<float> data;
-		for (unsigned int i = 0; i < positions.size(); ++i)
+	std::vector<float> data;
+	for (unsigned int i = 0; i < positions.size(); ++i)
+	{
+		data.push_back(positions[i].x);
+		data.push_back(positions[i].y);
+		data.push_back(positions[i].z);
+		if (normals.size() > 0)
 		{
-			data.push_back(positions[i].x);
-			data.push_back(positions[i].y);
-			data.push_back(positions[i].z);
-			if (normals.size() > 0)
-			{
-				data.push_back(normals[i].x);
-				data.push_back(normals[i].y);
-				data.push_back(normals[i].z);
-			}
-			if (uv.size() > 0)
-			{
-				data.push_back(uv[i].x);
-				data.push_back(uv[i].y);
-			}
+			data.push_back(normals[i].x);
+			data.push_back(normals[i].y);
+			data.push_back(normals[i].z);
 		}
-		glBindVertexArray(sphereVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-		glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), &data[0], GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-		unsigned int stride = (3 + 2 + 3) * sizeof(float);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
-	}
-
-	glBindVertexArray(sphereVAO);
-	glDrawElements(GL_TRIANGLE_STRIP, indexCount, GL_UNSIGNED_INT, 0);
+		if (uv.size() > 0)
+		{
+			data.push_back(uv[i].x);
+			data.push_back(uv[i].y);
+		}
+	}
+	sphereGeometry = GeometryArena::get().allocate(VERTEX_FORMAT_P3N3T2, data.data(), static_cast<unsigned int>(positions.size()),
+		indices.data(), static_cast<unsigned int>(indices.size()), GL_TRIANGLE_STRIP);
+}
+
+void renderSphere()
+{
+	if (!sphereGeometry.valid())
+	{
+		setupSphere();
+	}
+	GeometryArena::get().draw(sphereGeometry);
 }
 
-unsigned int cubeVAO = 0;
-unsigned int cubeVBO = 0;
+GeometryHandle cubeGeometry;
 /* Renders a 1x1 3D cube in NDC. */
 void renderCube()
 {
-	if (cubeVAO == 0)
+	if (!cubeGeometry.valid())
 	{
 		float vertices[] = {
 			-1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, 
@@ -317,60 +360,25 @@ void renderCube()
 			-1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f         
 		};
 
-		/* Vertex Array Object. */
-		glGenVertexArrays(1, &cubeVAO);
-		glGenBuffers(1, &cubeVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-		glBindVertexArray(cubeVAO);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-	}
-	glBindVertexArray(cubeVAO);
-	glDrawArrays(GL_TRIANGLES, 0, 36);
-	glBindVertexArray(0);
+		/* The vertices are already in triangle order, the arena only draws indexed geometry. */
+		unsigned int indices[36];
+		for (unsigned int i = 0; i < 36; i++) {
+			indices[i] = i;
+		}
+		cubeGeometry = GeometryArena::get().allocate(VERTEX_FORMAT_P3N3T2, vertices, 36, indices, 36);
+	}
+	GeometryArena::get().draw(cubeGeometry);
 }
 
 /* Renders a 1x1 XY quad in NDC */
-unsigned int quadVAO = 0;
-unsigned int quadVBO;
 void renderQuad()
 {
-	if (quadVAO == 0)
-	{
-		/* Vertices and texture coordinates. */
-		float quadVertices[] = {
-			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
-			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-		};
-		/* Vertex Array Object. */
-		glGenVertexArrays(1, &quadVAO);
-		glGenBuffers(1, &quadVBO);
-		glBindVertexArray(quadVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-	}
-	glBindVertexArray(quadVAO);
-	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	glBindVertexArray(0);
+	GeometryArena::get().drawScreenQuad();
 }
 
-unsigned int loadTexture(char const* path)
+GLTexture loadTexture(char const* path)
 {
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	GLTexture textureID(path, GL_SITE);
 
 	int width, height, nrComponents;
 	unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
@@ -405,15 +413,15 @@ unsigned int loadTexture(char const* path)
 }
 
 
-int main()
+/* Opens the window, makes its context current and loads GL. Returns NULL on failure. */
+GLFWwindow* createWindow()
 {
-	/* Initialize GLFW and specify OpenGL version to 3.3 (core profile). */
+	/* Initialize GLFW and ask for an OpenGL 4.3 (core profile) context for the indirect draw path. */
 	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-	/* MSAA using a 4 subsample buffer per pixel. */
-	glfwWindowHint(GLFW_SAMPLES, 4);
+	/* No samples for the window itself, MSAA happens in the render graph's scene targets. */
 
 #ifdef __APPLE__
 	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
@@ -421,10 +429,16 @@ int main()
 
 	/* Create a window object that holds all the required window information. */
 	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Aurora", NULL, NULL);
+	if (!window) {
+		/* Fall back to 3.3, everything except the indirect path runs on it. */
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Aurora", NULL, NULL);
+	}
 	if (!window) {
 		std::cout << "Failed to create GLFW Window\n";
 		glfwTerminate();
-		return -1;
+		return NULL;
 	}
 	/* Make the context of our window the main context on the current thread. */
 	glfwMakeContextCurrent(window);
@@ -438,8 +452,187 @@ int main()
 	/* Initialize GLAD to get function pointers for OpenGL. */
 	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
 		std::cout << "Failed to initialize GLAD\n";
+		glfwTerminate();
+		return NULL;
+	}
+	return window;
+}
+
+/* Command line: --headless renders without a window through HeadlessContext, --frames N stops after N frames
+ * (default 60 when headless, the whole path with --bench) and --output DIR writes every frame to DIR/frame_NNNN.ppm.
+ * --bench PATH replays a CameraPath with a fixed time step until its last key and writes the timings to the
+ * --report file (bench.json); "Aurora --headless --bench benchmarks/sphere_grid.path" is the benchmark run.
+ * --record-path PATH saves the camera of an interactive session as a path on exit.
+ * --profile FILE writes the Profiler's scope timings on exit and --trace FILE a Chrome trace of every frame, for
+ * chrome://tracing or Perfetto. Both only in builds with AURORA_PROFILING.
+ * --gl-capture FILE records the GL calls into a trace, with frames --capture-frame N (0) to N + --capture-count M (1)
+ * captured in full. --gl-replay FILE runs such a trace --replay-loops times (100) instead of the scene and writes the
+ * timings to the --report file.
+ * --ao ssao|gtao picks the ambient occlusion the scene starts with, O switches it in a window. Benchmark runs keep
+ * the one picked and report its time as the ao_ssao or ao_gtao pass, compare the modes with one run each. */
+struct Options {
+	bool headless = false;
+	int frames = 0;
+	string outputDirectory;
+	string benchPath;
+	string reportPath = "bench.json";
+	string recordPath;
+	string profilePath;
+	string tracePath;
+	string glCapturePath;
+	int captureFrame = 0;
+	int captureCount = 1;
+	string glReplayPath;
+	int replayLoops = 100;
+	AO_Mode ao = AO_MODE_SSAO;
+};
+
+Options parseOptions(int argc, char **argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--headless") == 0) {
+			options.headless = true;
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			options.frames = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			options.outputDirectory = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+			options.benchPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+			options.reportPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--record-path") == 0 && i + 1 < argc) {
+			options.recordPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			options.profilePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.tracePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--gl-capture") == 0 && i + 1 < argc) {
+			options.glCapturePath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--capture-frame") == 0 && i + 1 < argc) {
+			options.captureFrame = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--capture-count") == 0 && i + 1 < argc) {
+			options.captureCount = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--gl-replay") == 0 && i + 1 < argc) {
+			options.glReplayPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--replay-loops") == 0 && i + 1 < argc) {
+			options.replayLoops = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--ao") == 0 && i + 1 < argc && std::strcmp(argv[i + 1], "ssao") == 0) {
+			options.ao = AO_MODE_SSAO;
+			i++;
+		}
+		else if (std::strcmp(argv[i], "--ao") == 0 && i + 1 < argc && std::strcmp(argv[i + 1], "gtao") == 0) {
+			options.ao = AO_MODE_GTAO;
+			i++;
+		}
+		else {
+			std::cout << "Unknown option " << argv[i] << "\n";
+		}
+	}
+	return options;
+}
+
+/* --gl-replay: runs a recorded GL trace in the current context instead of the scene and reports its timings. */
+int replayGLTrace(const Options &options)
+{
+	GLTraceReplayer replayer;
+	if (!replayer.load(options.glReplayPath)) {
 		return -1;
 	}
+	Benchmark benchmark;
+	benchmark.setEnabled(true);
+	/* One extra loop as warmup, it pays for the first use of everything the frames touch. */
+	benchmark.setWarmupFrames(replayer.capturedFrames());
+	benchmark.setInfo("gl_trace", options.glReplayPath);
+	benchmark.setInfo("renderer", (const char*)glGetString(GL_RENDERER));
+	benchmark.setInfo("version", (const char*)glGetString(GL_VERSION));
+	replayer.run(benchmark, options.replayLoops + 1);
+
+	benchmark.writeReport(options.reportPath);
+	TimingStats cpu = benchmark.cpuStats();
+	TimingStats gpu = benchmark.gpuStats("replay");
+	std::cout << "Replay: " << cpu.count << " frames, cpu avg " << cpu.avg << " ms, gpu avg " << gpu.avg << " ms, report in " << options.reportPath << "\n";
+	replayer.deleteObjects();
+	benchmark.deleteQueries();
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	Options options = parseOptions(argc, argv);
+	aoMode = options.ao;
+	CameraPath cameraPath;
+	if (!options.benchPath.empty()) {
+		if (!cameraPath.load(options.benchPath)) {
+			return -1;
+		}
+		if (options.frames <= 0) {
+			options.frames = cameraPath.lastFrame() + 1;
+		}
+	}
+	if (options.headless && options.frames <= 0) {
+		options.frames = 60;
+	}
+	GLFWwindow* window = NULL;
+	HeadlessContext headlessContext;
+
+	if (options.headless) {
+		/* No window: the frame goes into an OffscreenTarget, time advances by a fixed step per frame. */
+		if (!headlessContext.create(SCR_WIDTH, SCR_HEIGHT) || !headlessContext.loadGL()) {
+			std::cout << "Failed to create a headless context\n";
+			return -1;
+		}
+		std::cout << "Headless rendering through " << HeadlessContext::backendName(headlessContext.getBackend())
+			<< " on " << glGetString(GL_RENDERER) << "\n";
+	}
+	else {
+		window = createWindow();
+		if (!window) {
+			return -1;
+		}
+	}
+
+	if (!options.glReplayPath.empty()) {
+		int result = replayGLTrace(options);
+		if (window) {
+			glfwTerminate();
+		}
+		else {
+			headlessContext.destroy();
+		}
+		return result;
+	}
+	/* Counting is on wherever someone looks at the numbers, and hooked in before a capture so the hooks chain. */
+	GLStats::get().setEnabled(AURORA_PROFILING || !cameraPath.empty());
+	GLResources::get().setEnabled(AURORA_PROFILING || !cameraPath.empty());
+	if (!options.glCapturePath.empty()) {
+		/* Before anything is created, the trace has to contain every object the captured frames use. */
+		int traceWidth = SCR_WIDTH, traceHeight = SCR_HEIGHT;
+		if (window) {
+			glfwGetFramebufferSize(window, &traceWidth, &traceHeight);
+		}
+		GLTraceRecorder::get().start(options.glCapturePath, options.captureFrame, options.captureCount, traceWidth, traceHeight);
+	}
+
+#if AURORA_PROFILING
+	/* Started before anything is loaded, so shader compiles and the IBL bake are on the timeline too. */
+	if (!options.tracePath.empty()) {
+		Profiler::get().setTracing(true);
+	}
+#endif
 
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
@@ -449,24 +642,7 @@ int main()
 	//glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-	Shader pbrShader(pbrVertexPath, pbrFragmentPath);
-	Shader equirectangularToCubemapShader(cubemapVertexPath, equirectangularToCubemapFragmentPath);
-	Shader irradianceShader(cubemapVertexPath, irradianceConvolutionFragmentPath);
-	Shader prefilterShader(cubemapVertexPath, prefilterFragmentPath);
-	Shader brdfShader(brdfVertexPath, brdfFragmentPath);
-	Shader backgroundShader(backgroundVertexPath, backgroundFragmentPath);
-
-	pbrShader.use();
-	pbrShader.setInt("irradianceMap", 0);
-	pbrShader.setInt("prefilterMap", 1);
-	pbrShader.setInt("brdfLUT", 2);
-	float albedo[3] = { 0.0f, 0.0f, 0.0f };
-	pbrShader.setVecN("albedo", albedo, 3);
-	pbrShader.setFloat("ao", 1.0f);
-
-	backgroundShader.use();
-	backgroundShader.setInt("environmentMap", 0);
-
+	/* Scene lights, binned into clusters every frame so the PBR shaders only loop over the ones in reach. */
 	glm::vec3 lightPositions[] = {
 		glm::vec3(-10.0f,  10.0f, 10.0f),
 		glm::vec3(10.0f,  10.0f, 10.0f),
@@ -479,14 +655,60 @@ int main()
 		glm::vec3(300.0f, 300.0f, 300.0f),
 		glm::vec3(300.0f, 300.0f, 300.0f)
 	};
+	const unsigned int nrLights = sizeof(lightPositions) / sizeof(lightPositions[0]);
+	vector<PointLight> sceneLights(nrLights);
+	for (unsigned int i = 0; i < nrLights; ++i)
+	{
+		sceneLights[i].position = lightPositions[i];
+		sceneLights[i].color = lightColors[i];
+		sceneLights[i].radius = lightRadius(sceneLights[i].color, sceneLights[i].attenuation);
+	}
+	ShaderDefines pbrDefines{ { "CLUSTERED", "" }, { "SSAO", "" } };
+
+	Shader pbrShader(pbrVertexPath, pbrFragmentPath, pbrDefines);
+	Shader pbrIndirectShader(pbrIndirectVertexPath, pbrFragmentPath, pbrDefines);
+	Shader equirectangularToCubemapShader(cubemapVertexPath, equirectangularToCubemapFragmentPath);
+	Shader irradianceShader(cubemapVertexPath, irradianceConvolutionFragmentPath);
+	Shader prefilterShader(cubemapVertexPath, prefilterFragmentPath);
+	Shader brdfShader(brdfVertexPath, brdfFragmentPath);
+	Shader backgroundShader(backgroundVertexPath, backgroundFragmentPath);
+	/* View space normals and depth of the scene for the AO, and the passes of SSAORenderer. */
+	Shader aoGeometryShader(ssaoGeometryVertexPath, ssaoGeometryFragmentPath);
+	Shader aoGeometryIndirectShader(ssaoGeometryVertexPath, ssaoGeometryFragmentPath, ssaoGeometryInstancedDefines);
+	Shader ssaoShader(ssaoVertexPath, ssaoFragmentPath);
+	Shader depthPyramidShader(ssaoVertexPath, depthPyramidFragmentPath);
+	Shader gtaoShader(ssaoVertexPath, gtaoFragmentPath);
+	Shader gtaoTemporalShader(ssaoVertexPath, gtaoTemporalFragmentPath);
+	Shader ssaoBlurShader(ssaoVertexPath, ssaoBlurFragmentPath);
+	Shader ssaoUpsampleShader(ssaoVertexPath, ssaoUpsampleFragmentPath);
+	AOShaders aoShaders{ &ssaoShader, &depthPyramidShader, &gtaoShader, &gtaoTemporalShader, &ssaoBlurShader, &ssaoUpsampleShader };
+	Shader* aoGeometryShaders[] = { &aoGeometryShader, &aoGeometryIndirectShader };
+
+	/* Both PBR programs share the fragment shader, the indirect one reads model and material from instance attributes. */
+	Shader* pbrShaders[] = { &pbrShader, &pbrIndirectShader };
+	for (Shader* shader : pbrShaders)
+	{
+		shader->use();
+		shader->setInt("irradianceMap", IBL_TEXTURE_UNIT);
+		shader->setInt("prefilterMap", IBL_TEXTURE_UNIT + 1);
+		shader->setInt("brdfLUT", IBL_TEXTURE_UNIT + 2);
+		float albedo[3] = { 0.0f, 0.0f, 0.0f };
+		shader->setVecN("albedo", albedo, 3);
+	}
+
+	IndirectRenderer indirectRenderer;
+	indirectRenderer.setEnabled(IndirectRenderer::supported());
+	std::cout << "Scene draw path: " << (indirectRenderer.enabled() ? "glMultiDrawElementsIndirect" : "per draw fallback") << std::endl;
+
+	backgroundShader.use();
+	backgroundShader.setInt("environmentMap", 0);
+
 	int nrRows = 7;
 	int nrColumns = 7;
 	float spacing = 2.5;
 
-	unsigned int captureFBO;
-	unsigned int captureRBO;
-	glGenFramebuffers(1, &captureFBO);
-	glGenRenderbuffers(1, &captureRBO);
+	GLFramebuffer captureFBO("ibl capture", GL_SITE);
+	GLRenderbuffer captureRBO("ibl capture depth", GL_SITE);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
 	glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
@@ -497,10 +719,10 @@ int main()
 	stbi_set_flip_vertically_on_load(true);
 	int width, height, nrComponents;
 	float* data = stbi_loadf(circus_hdr, &width, &height, &nrComponents, 0);
-	unsigned int hdrTexture;
+	GLTexture hdrTexture;
 	if (data)
 	{
-		glGenTextures(1, &hdrTexture);
+		hdrTexture.create(circus_hdr, GL_SITE);
 		glBindTexture(GL_TEXTURE_2D, hdrTexture);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
 
@@ -517,8 +739,7 @@ int main()
 	}
 
 	/* Environment cubemap. */
-	unsigned int envCubemap;
-	glGenTextures(1, &envCubemap);
+	GLTexture envCubemap("environment cubemap", GL_SITE);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 	for (unsigned int i = 0; i < 6; ++i)
 	{
@@ -541,6 +762,11 @@ int main()
 		glm::lookAt(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
 	};
 
+#if AURORA_PROFILING
+	/* The bake is not a block of its own, so the scope is opened by hand. It is folded into the statistics with the first frame. */
+	int iblScope = Profiler::get().beginScope("ibl bake", true);
+#endif
+
 	/* Convert HDR equirectangular environment map to cubemap equivalent */
 	equirectangularToCubemapShader.use();
 	equirectangularToCubemapShader.setInt("equirectangularMap", 0);
@@ -566,8 +792,7 @@ int main()
 	glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
 	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-	unsigned int irradianceMap;
-	glGenTextures(1, &irradianceMap);
+	GLTexture irradianceMap("irradiance map", GL_SITE);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
 	for (unsigned int i = 0; i < 6; ++i)
 	{
@@ -604,8 +829,7 @@ int main()
 	}
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-	unsigned int prefilterMap;
-	glGenTextures(1, &prefilterMap);
+	GLTexture prefilterMap("prefilter map", GL_SITE);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
 	for (unsigned int i = 0; i < 6; ++i)
 	{
@@ -650,8 +874,7 @@ int main()
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 	/* Generate a 2D LUT from the BRDF equations used. */
-	unsigned int brdfLUTTexture;
-	glGenTextures(1, &brdfLUTTexture);
+	GLTexture brdfLUTTexture("brdf lut", GL_SITE);
 
 	glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 512, 512, 0, GL_RG, GL_FLOAT, 0);
@@ -671,54 +894,247 @@ int main()
 	renderQuad();
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+#if AURORA_PROFILING
+	Profiler::get().endScope(iblScope);
+#endif
+	/* Only the baked maps are needed from here on. */
+	hdrTexture.reset();
+	captureRBO.reset();
+	captureFBO.reset();
+
+	setupSphere();
+
+	int scrWidth = SCR_WIDTH, scrHeight = SCR_HEIGHT;
+	OffscreenTarget offscreenTarget;
+	FrameWriter frameWriter;
+	if (window) {
+		glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
+	}
+	else {
+		offscreenTarget.create(scrWidth, scrHeight);
+	}
 
-	glm::mat4 projection = glm::perspective(glm::radians(camera.zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-	pbrShader.use();
-	projectionloc = glGetUniformLocation(pbrShader.ID, "projection");
-	glUniformMatrix4fv(projectionloc, 1, GL_FALSE, glm::value_ptr(projection));
-	backgroundShader.use();
-	projectionloc = glGetUniformLocation(backgroundShader.ID, "projection");
-	glUniformMatrix4fv(projectionloc, 1, GL_FALSE, glm::value_ptr(projection));
+	/* Cluster lists go to the units after the IBL maps, the AO inputs and SSAORenderer's own textures after those,
+	 * see material.h. The scene reads the AO result from the first AO unit. */
+	const unsigned int clusterUnit = CLUSTER_TEXTURE_UNIT;
+	const unsigned int aoUnit = AO_TEXTURE_UNIT;
+	LightClusters lightClusters;
+	/* One renderer per mode, so each keeps its own history and timer. */
+	SSAORenderer aoRenderers[AO_MODE_COUNT];
+	aoRenderers[AO_MODE_SSAO].setMode(AO_MODE_SSAO);
+	aoRenderers[AO_MODE_GTAO].setMode(AO_MODE_GTAO);
+	glm::mat4 projection;
+	/* Zoom the projection was built for, camera paths and the scroll wheel change it between frames. */
+	float projectionZoom = camera.zoom;
+	/* Projection and cluster tiles follow the framebuffer and the zoom, set again whenever either changes. */
+	auto setProjection = [&](int width, int height) {
+		float aspect = (float)width / (float)height;
+		projectionZoom = camera.zoom;
+		projection = glm::perspective(glm::radians(camera.zoom), aspect, 0.1f, 100.0f);
+		lightClusters.setProjection(glm::radians(camera.zoom), aspect, 0.1f, 100.0f, width, height);
+		for (Shader* shader : pbrShaders)
+		{
+			shader->use();
+			projectionloc = glGetUniformLocation(shader->ID, "projection");
+			glUniformMatrix4fv(projectionloc, 1, GL_FALSE, glm::value_ptr(projection));
+			lightClusters.setupShader(*shader, clusterUnit);
+			shader->setInt("ssao", aoUnit);
+		}
+		for (Shader* shader : aoGeometryShaders)
+		{
+			shader->use();
+			projectionloc = glGetUniformLocation(shader->ID, "projection");
+			glUniformMatrix4fv(projectionloc, 1, GL_FALSE, glm::value_ptr(projection));
+		}
+		backgroundShader.use();
+		projectionloc = glGetUniformLocation(backgroundShader.ID, "projection");
+		glUniformMatrix4fv(projectionloc, 1, GL_FALSE, glm::value_ptr(projection));
+	};
+	/* The AO targets only follow the framebuffer. */
+	auto setViewportSize = [&](int width, int height) {
+		setProjection(width, height);
+		for (SSAORenderer &aoRenderer : aoRenderers)
+		{
+			aoRenderer.create(width, height);
+		}
+	};
+	setViewportSize(scrWidth, scrHeight);
+
+	/* Edits to the scene shaders are picked up while running, the IBL bake above is not redone. */
+	ShaderWatcher shaderWatcher;
+	shaderWatcher.add(pbrShader);
+	shaderWatcher.add(pbrIndirectShader);
+	shaderWatcher.add(backgroundShader);
+
+	Benchmark benchmark;
+	bool benchmarking = !cameraPath.empty();
+	CameraPath recordedPath;
+	benchmark.setEnabled(benchmarking);
+	if (benchmarking) {
+		benchmark.setInfo("camera_path", options.benchPath);
+		benchmark.setInfo("renderer", (const char*)glGetString(GL_RENDERER));
+		benchmark.setInfo("version", (const char*)glGetString(GL_VERSION));
+		benchmark.setInfo("context", window ? "window" : HeadlessContext::backendName(headlessContext.getBackend()));
+		benchmark.setInfo("ao", aoMode == AO_MODE_GTAO ? "gtao" : "ssao");
+	}
+
+	/* The frame as a render graph: the AO passes draw the spheres' normals and depth and compute the occlusion from
+	 * them, the scene and skybox render into multisampled targets of the framebuffer's size, and present resolves
+	 * them into the window, or the offscreen target when headless. */
+	RenderGraph renderGraph;
+	RenderTargetDesc colorDesc;
+	colorDesc.samples = window ? 4 : 0;
+	RenderTargetDesc depthDesc;
+	depthDesc.internalFormat = GL_DEPTH24_STENCIL8;
+	depthDesc.format = GL_DEPTH_STENCIL;
+	depthDesc.type = GL_UNSIGNED_INT_24_8;
+	depthDesc.samples = colorDesc.samples;
+	RenderResource sceneColor = renderGraph.createTexture("scene color", colorDesc);
+	RenderResource sceneDepth = renderGraph.createTexture("scene depth", depthDesc);
+	RenderResource backbuffer = renderGraph.importFramebuffer("backbuffer", window ? 0 : offscreenTarget.FBO);
+	RenderTargetDesc aoNormalDesc;
+	aoNormalDesc.internalFormat = GL_RG16_SNORM;
+	aoNormalDesc.format = GL_RG;
+	aoNormalDesc.type = GL_FLOAT;
+	aoNormalDesc.filter = GL_NEAREST;
+	RenderTargetDesc aoDepthDesc = depthDesc;
+	aoDepthDesc.samples = 0;
+	aoDepthDesc.filter = GL_NEAREST;
+	RenderResource aoNormal = renderGraph.createTexture("ao normal", aoNormalDesc);
+	RenderResource aoDepth = renderGraph.createTexture("ao depth", aoDepthDesc);
+	RenderResource aoResult = renderGraph.importTexture("ao");
+	glm::mat4 view;
+
+	int aoGeometryPass = renderGraph.addPass("ao gbuffer", [&]() {
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		for (Shader* shader : aoGeometryShaders)
+		{
+			shader->use();
+			int viewloc = glGetUniformLocation(shader->ID, "view");
+			glUniformMatrix4fv(viewloc, 1, GL_FALSE, glm::value_ptr(view));
+		}
+		indirectRenderer.submit(aoGeometryIndirectShader, aoGeometryShader);
+	});
+	renderGraph.write(aoGeometryPass, aoNormal);
+	renderGraph.write(aoGeometryPass, aoDepth);
+
+	/* SSAORenderer times itself, its queries cannot nest in the benchmark's. */
+	int aoPass = renderGraph.addPass("ao", [&]() {
+		glActiveTexture(GL_TEXTURE0 + aoUnit);
+		glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(aoDepth));
+		glActiveTexture(GL_TEXTURE0 + aoUnit + 1);
+		glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(aoNormal));
+		aoRenderers[aoMode].render(aoShaders, projection, view, aoUnit);
+	});
+	renderGraph.read(aoPass, aoNormal);
+	renderGraph.read(aoPass, aoDepth);
+	renderGraph.write(aoPass, aoResult);
+	renderGraph.setBenchmarked(aoPass, false);
+
+	int scenePass = renderGraph.addPass("scene", [&]() {
+		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		/* Bind pre computed IBL data */
+		glActiveTexture(GL_TEXTURE0 + IBL_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
+		glActiveTexture(GL_TEXTURE0 + IBL_TEXTURE_UNIT + 1);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
+		glActiveTexture(GL_TEXTURE0 + IBL_TEXTURE_UNIT + 2);
+		glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+		lightClusters.bind(clusterUnit);
+		glActiveTexture(GL_TEXTURE0 + aoUnit);
+		glBindTexture(GL_TEXTURE_2D, aoRenderers[aoMode].getTexture());
+		indirectRenderer.submit(pbrIndirectShader, pbrShader);
+	});
+	renderGraph.read(scenePass, aoResult);
+	renderGraph.write(scenePass, sceneColor);
+	renderGraph.write(scenePass, sceneDepth);
+
+	int skyboxPass = renderGraph.addPass("skybox", [&]() {
+		backgroundShader.use();
+		int viewloc = glGetUniformLocation(backgroundShader.ID, "view");
+		glUniformMatrix4fv(viewloc, 1, GL_FALSE, glm::value_ptr(view));
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+		renderCube();
+	});
+	renderGraph.write(skyboxPass, sceneColor);
+	renderGraph.write(skyboxPass, sceneDepth);
+
+	int presentPass = renderGraph.addPass("present", [&]() {
+		renderGraph.blit(sceneColor);
+	});
+	renderGraph.read(presentPass, sceneColor);
+	renderGraph.write(presentPass, backbuffer);
+	renderGraph.setOutput(backbuffer);
 
-	int scrWidth, scrHeight;
-	glfwGetFramebufferSize(window, &scrWidth, &scrHeight);
-	glViewport(0, 0, scrWidth, scrHeight);
+	renderGraph.resize(scrWidth, scrHeight);
+	renderGraph.compile();
+	std::cout << "Render graph: " << renderGraph.summary() << "\n";
 
 	/* Render loop */
-	while (!glfwWindowShouldClose(window)) {
+	int frameIndex = 0;
+#if AURORA_PROFILING
+	float lastTitleUpdate = 0.0f;
+#endif
+	while (window ? !glfwWindowShouldClose(window) : frameIndex < options.frames) {
+		benchmark.beginFrame();
+		PROFILE_FRAME_BEGIN();
+		GLTraceRecorder::get().beginFrame();
 
-		float currentFrame = static_cast<float>(glfwGetTime());
+		/* Benchmarks run on a fixed time step too, the frame number alone decides what is drawn. */
+		float currentFrame = window && !benchmarking ? static_cast<float>(glfwGetTime()) : frameIndex / 60.0f;
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		/* Input */
-		processInput(window);
+		if (benchmarking) {
+			cameraPath.apply(frameIndex, camera);
+		}
+		else if (window) {
+			processInput(window);
+		}
+		if (window && framebufferResized) {
+			framebufferResized = false;
+			/* Minimized windows report 0 x 0, the targets stay as they are until the window is back. */
+			if (framebufferWidth > 0 && framebufferHeight > 0) {
+				scrWidth = framebufferWidth;
+				scrHeight = framebufferHeight;
+				renderGraph.resize(scrWidth, scrHeight);
+				setViewportSize(scrWidth, scrHeight);
+			}
+		}
+		if (camera.zoom != projectionZoom) {
+			setProjection(scrWidth, scrHeight);
+		}
+		if (!options.recordPath.empty()) {
+			recordedPath.record(frameIndex, camera);
+		}
 
-		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		shaderWatcher.update(currentFrame);
 
-		pbrShader.use();
-		glm::mat4 view = camera.get_view_matrix();
-		int viewloc = glGetUniformLocation(pbrShader.ID, "view");
-		glUniformMatrix4fv(viewloc, 1, GL_FALSE, glm::value_ptr(view));
+		view = camera.get_view_matrix();
 		float tempcampos[3] = { camera.position.x, camera.position.y, camera.position.z };
-		pbrShader.setVecN("camPos", tempcampos, 3);
-
-		/* Bind pre computed IBL data */
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, brdfLUTTexture);
+		for (Shader* shader : pbrShaders)
+		{
+			shader->use();
+			int viewloc = glGetUniformLocation(shader->ID, "view");
+			glUniformMatrix4fv(viewloc, 1, GL_FALSE, glm::value_ptr(view));
+			shader->setVecN("camPos", tempcampos, 3);
+		}
+		lightClusters.update(view, sceneLights);
 
+		/* Record the sphere grid and the light spheres, then submit them as a single pass. */
+		indirectRenderer.begin();
 		glm::mat4 model = glm::mat4(1.0f);
+		glm::vec4 material = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f);
 		for (int row = 0; row < nrRows; ++row)
 		{
-			pbrShader.setFloat("metallic", (float)row / (float)nrRows);
+			material.x = (float)row / (float)nrRows;
 			for (int col = 0; col < nrColumns; ++col)
 			{
-				pbrShader.setFloat("roughness", glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f));
+				material.y = glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f);
 
 				model = glm::mat4(1.0f);
 				model = glm::translate(model, glm::vec3(
@@ -726,41 +1142,107 @@ int main()
 					(float)(row - (nrRows / 2)) * spacing,
 					-2.0f
 				));
-				int modelloc = glGetUniformLocation(pbrShader.ID, "model");
-				glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(model));
-				renderSphere();
+				indirectRenderer.add(sphereGeometry, model, material);
 			}
 		}
 
-		for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); ++i)
+		for (unsigned int i = 0; i < nrLights; ++i)
 		{
-			glm::vec3 newPos = lightPositions[i] + glm::vec3(sin(glfwGetTime() * 5.0) * 5.0, 0.0, 0.0);
-			newPos = lightPositions[i];
-			float temp1[3] = { newPos.x, newPos.y, newPos.z };
-			pbrShader.setVecN("lightPositions[" + std::to_string(i) + "]", temp1, 3);
-			float temp2[3] = { lightColors[i].x, lightColors[i].y, lightColors[i].z };
-			pbrShader.setVecN("lightColors[" + std::to_string(i) + "]", temp2, 3);
-
 			model = glm::mat4(1.0f);
-			model = glm::translate(model, newPos);
+			model = glm::translate(model, lightPositions[i]);
 			model = glm::scale(model, glm::vec3(0.5f));
-			int modelloc = glGetUniformLocation(pbrShader.ID, "model");
-			glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(model));
-			renderSphere();
+			indirectRenderer.add(sphereGeometry, model, material);
+		}
+		renderGraph.execute(&benchmark);
+		if (benchmarking) {
+			benchmark.addGpuTime(aoMode == AO_MODE_GTAO ? "ao_gtao" : "ao_ssao", aoRenderers[aoMode].getGpuTime(aoMode));
 		}
 
-		/* Render skybox. */
-		backgroundShader.use();
-		viewloc = glGetUniformLocation(backgroundShader.ID, "view");
-		glUniformMatrix4fv(viewloc, 1, GL_FALSE, glm::value_ptr(view));
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-		renderCube();
+		if (!options.outputDirectory.empty()) {
+			char fileName[32];
+			std::snprintf(fileName, sizeof(fileName), "/frame_%04d.ppm", frameIndex);
+			frameWriter.capture(window ? 0 : offscreenTarget.FBO, scrWidth, scrHeight, options.outputDirectory + fileName);
+		}
+		PROFILE_FRAME_END();
+#if AURORA_PROFILING
+		/* No text rendering, the title bar is the overlay. The times are averages, so a refresh twice a second is plenty. */
+		if (window && currentFrame - lastTitleUpdate > 0.5f) {
+			glfwSetWindowTitle(window, ("Aurora  " + Profiler::get().summary(0) + "  |  " + GLStats::get().summary() + "  |  "
+				+ GLResources::get().summary()).c_str());
+			lastTitleUpdate = currentFrame;
+		}
+#endif
+		if (window) {
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+		}
+		GLTraceRecorder::get().endFrame();
+		GLStats::get().endFrame();
+		GLStats::get().addToBenchmark(benchmark);
+		benchmark.endFrame();
+		frameIndex++;
+		if (options.frames > 0 && frameIndex >= options.frames && window) {
+			glfwSetWindowShouldClose(window, true);
+		}
+	}
 
-		glfwSwapBuffers(window);
-		glfwPollEvents();
+	if (benchmarking) {
+		benchmark.writeReport(options.reportPath);
+		TimingStats cpu = benchmark.cpuStats();
+		std::cout << "Benchmark: " << cpu.count << " frames, avg " << cpu.avg << " ms, p99 " << cpu.p99 << " ms, report in " << options.reportPath << "\n";
+	}
+	if (!options.recordPath.empty()) {
+		recordedPath.save(options.recordPath);
 	}
+#if AURORA_PROFILING
+	Profiler::get().flush();
+	if (!options.profilePath.empty()) {
+		Profiler::get().writeReport(options.profilePath);
+	}
+	if (!options.tracePath.empty()) {
+		Profiler::get().writeTrace(options.tracePath);
+	}
+#endif
 
-	glfwTerminate();  
+	if (GLResources::get().isEnabled()) {
+		GLResources::get().report(std::cout, 5);
+	}
+
+	GLTraceRecorder::get().stop();
+	renderGraph.deleteTargets();
+	envCubemap.reset();
+	irradianceMap.reset();
+	prefilterMap.reset();
+	brdfLUTTexture.reset();
+	for (SSAORenderer &aoRenderer : aoRenderers)
+	{
+		aoRenderer.deleteBuffers();
+	}
+	Shader* shaders[] = { &pbrShader, &pbrIndirectShader, &equirectangularToCubemapShader, &irradianceShader, &prefilterShader,
+		&brdfShader, &backgroundShader, &aoGeometryShader, &aoGeometryIndirectShader, &ssaoShader, &depthPyramidShader, &gtaoShader,
+		&gtaoTemporalShader, &ssaoBlurShader, &ssaoUpsampleShader };
+	for (Shader* shader : shaders)
+	{
+		shader->deleteProgram();
+	}
+	indirectRenderer.deleteBuffers();
+	lightClusters.deleteBuffers();
+	MaterialBlockPool::get().deleteBuffer();
+	GeometryArena::get().deleteBuffers();
+	frameWriter.deleteBuffers();
+	offscreenTarget.deleteBuffers();
+	benchmark.deleteQueries();
+	Profiler::get().deleteQueries();
+	/* Whatever is still alive now was never deleted. */
+	if (GLResources::get().isEnabled()) {
+		GLResources::get().checkLeaks();
+	}
+
+	if (window) {
+		glfwTerminate();
+	}
+	else {
+		headlessContext.destroy();
+	}
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,232 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+Benchmark::Benchmark() : enabled(false), warmupFrames(10), frame(0), activePass(-1)
+{
+}
+
+void Benchmark::beginFrame()
+{
+	if (!enabled) {
+		return;
+	}
+	frameStart = std::chrono::steady_clock::now();
+}
+
+void Benchmark::endFrame()
+{
+	if (!enabled) {
+		return;
+	}
+	if (measured()) {
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+	}
+	frame++;
+}
+
+Benchmark::GpuPass& Benchmark::findPass(const string &name)
+{
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		if (passes[i].name == name) {
+			return passes[i];
+		}
+	}
+	GpuPass pass;
+	pass.name = name;
+	for (unsigned int i = 0; i < BENCHMARK_QUERY_LATENCY; i++) {
+		pass.queries[i] = 0;
+		pass.queryFrames[i] = -1;
+	}
+	passes.push_back(pass);
+	return passes.back();
+}
+
+void Benchmark::collect(GpuPass &pass, unsigned int slot)
+{
+	if (pass.queryFrames[slot] < 0) {
+		return;
+	}
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(pass.queries[slot], GL_QUERY_RESULT, &elapsed);
+	if (pass.queryFrames[slot] >= warmupFrames) {
+		pass.samples.push_back(elapsed / 1000000.0);
+	}
+	pass.queryFrames[slot] = -1;
+}
+
+void Benchmark::beginPass(const string &name)
+{
+	if (!enabled) {
+		return;
+	}
+	if (activePass >= 0) {
+		std::cout << "ERROR::BENCHMARK::NESTED_PASS: " << name << std::endl;
+		return;
+	}
+	GpuPass &pass = findPass(name);
+	if (pass.queries[0] == 0) {
+		glGenQueries(BENCHMARK_QUERY_LATENCY, pass.queries);
+	}
+	/* The slot was last used BENCHMARK_QUERY_LATENCY frames ago, its result is ready by now. */
+	unsigned int slot = frame % BENCHMARK_QUERY_LATENCY;
+	collect(pass, slot);
+	glBeginQuery(GL_TIME_ELAPSED, pass.queries[slot]);
+	pass.queryFrames[slot] = frame;
+	activePass = static_cast<int>(&pass - &passes[0]);
+}
+
+void Benchmark::endPass()
+{
+	if (activePass < 0) {
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	activePass = -1;
+}
+
+void Benchmark::addGpuTime(const string &name, float milliseconds)
+{
+	if (!enabled) {
+		return;
+	}
+	GpuPass &pass = findPass(name);
+	if (measured()) {
+		pass.samples.push_back(milliseconds);
+	}
+}
+
+void Benchmark::addCounter(const string &name, double value)
+{
+	if (!enabled || !measured()) {
+		return;
+	}
+	for (unsigned int i = 0; i < counters.size(); i++) {
+		if (counters[i].name == name) {
+			counters[i].samples.push_back(value);
+			return;
+		}
+	}
+	counters.push_back(Counter{ name, vector<double>(1, value) });
+}
+
+TimingStats Benchmark::counterStats(const string &name) const
+{
+	for (unsigned int i = 0; i < counters.size(); i++) {
+		if (counters[i].name == name) {
+			return summarize(counters[i].samples);
+		}
+	}
+	return TimingStats();
+}
+
+TimingStats Benchmark::gpuStats(const string &name) const
+{
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		if (passes[i].name == name) {
+			return summarize(passes[i].samples);
+		}
+	}
+	return TimingStats();
+}
+
+TimingStats Benchmark::summarize(vector<double> samples)
+{
+	TimingStats stats;
+	if (samples.empty()) {
+		return stats;
+	}
+	std::sort(samples.begin(), samples.end());
+	/* Nearest rank percentiles. */
+	auto percentile = [&samples](double p) {
+		size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+		return samples[std::min(std::max(rank, (size_t)1), samples.size()) - 1];
+	};
+	double sum = 0.0;
+	for (double sample : samples) {
+		sum += sample;
+	}
+	stats.count = static_cast<unsigned int>(samples.size());
+	stats.min = samples.front();
+	stats.avg = sum / samples.size();
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.max = samples.back();
+	return stats;
+}
+
+static string jsonString(const string &value)
+{
+	string escaped = "\"";
+	for (char c : value) {
+		if (c == '"' || c == '\\') {
+			escaped += '\\';
+			escaped += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20) {
+			escaped += ' ';
+		}
+		else {
+			escaped += c;
+		}
+	}
+	return escaped + "\"";
+}
+
+static void writeStats(std::ofstream &file, const TimingStats &stats)
+{
+	file << "{ \"count\": " << stats.count << ", \"min\": " << stats.min << ", \"avg\": " << stats.avg
+		<< ", \"p95\": " << stats.p95 << ", \"p99\": " << stats.p99 << ", \"max\": " << stats.max << " }";
+}
+
+bool Benchmark::writeReport(const string &path)
+{
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		for (unsigned int slot = 0; slot < BENCHMARK_QUERY_LATENCY; slot++) {
+			collect(passes[i], slot);
+		}
+	}
+
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::BENCHMARK::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	file << "{\n";
+	for (auto it = info.begin(); it != info.end(); ++it) {
+		file << "  " << jsonString(it->first) << ": " << jsonString(it->second) << ",\n";
+	}
+	file << "  \"frames\": " << frame << ",\n";
+	file << "  \"warmup_frames\": " << warmupFrames << ",\n";
+	file << "  \"cpu_frame_ms\": ";
+	writeStats(file, cpuStats());
+	file << ",\n  \"gpu_pass_ms\": {";
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		file << (i == 0 ? "\n" : ",\n") << "    " << jsonString(passes[i].name) << ": ";
+		writeStats(file, summarize(passes[i].samples));
+	}
+	file << (passes.empty() ? "},\n" : "\n  },\n");
+	file << "  \"counters\": {";
+	for (unsigned int i = 0; i < counters.size(); i++) {
+		file << (i == 0 ? "\n" : ",\n") << "    " << jsonString(counters[i].name) << ": ";
+		writeStats(file, summarize(counters[i].samples));
+	}
+	file << (counters.empty() ? "}\n" : "\n  }\n");
+	file << "}\n";
+	return true;
+}
+
+void Benchmark::deleteQueries()
+{
+	for (unsigned int i = 0; i < passes.size(); i++) {
+		if (passes[i].queries[0] != 0) {
+			glDeleteQueries(BENCHMARK_QUERY_LATENCY, passes[i].queries);
+			passes[i].queries[0] = 0;
+		}
+	}
+	passes.clear();
+	activePass = -1;
+}
@@ -0,0 +1,122 @@
+#include "bloom_renderer.h"
+
+#include "geometry_arena.h"
+#include "profiler.h"
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <iostream>
+
+/* Mips smaller than this add nothing visible but still cost a pass each. */
+const int MinBloomMipSize = 8;
+
+BloomRenderer::BloomRenderer() : width(0), height(0), threshold(1.0f), knee(0.5f), filterRadius(1.0f), FBO(0)
+{
+}
+
+void BloomRenderer::create(int width, int height)
+{
+	deleteBuffers();
+	this->width = width;
+	this->height = height;
+
+	glGenFramebuffers(1, &FBO);
+	int mipWidth = width / 2;
+	int mipHeight = height / 2;
+	while (mips.size() < BLOOM_MAX_MIPS && mipWidth >= MinBloomMipSize && mipHeight >= MinBloomMipSize) {
+		BloomMip mip;
+		mip.width = mipWidth;
+		mip.height = mipHeight;
+		glGenTextures(1, &mip.texture);
+		glBindTexture(GL_TEXTURE_2D, mip.texture);
+		GL_LABEL(RESOURCE_TEXTURE, mip.texture, "bloom mip " + std::to_string(mips.size()));
+		/* Packed float, half the bandwidth of RGBA16F. No alpha and no negative values, neither is needed here. */
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, mipWidth, mipHeight, 0, GL_RGB, GL_FLOAT, NULL);
+		/* The filters place their taps between texels, linear filtering does half of the work. */
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		mips.push_back(mip);
+		mipWidth /= 2;
+		mipHeight /= 2;
+	}
+
+	if (!mips.empty()) {
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		GL_LABEL(RESOURCE_FRAMEBUFFER, FBO, "bloom");
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mips[0].texture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR::BLOOM::FRAMEBUFFER_INCOMPLETE" << std::endl;
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void BloomRenderer::render(Shader &downsampleShader, Shader &upsampleShader, unsigned int hdrTexture)
+{
+	PROFILE_GPU_SCOPE("bloom");
+	if (mips.empty()) {
+		return;
+	}
+	GeometryArena &arena = GeometryArena::get();
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glActiveTexture(GL_TEXTURE0);
+
+	/* Downsample: scene -> mip 0 -> mip 1 ... Only the first pass thresholds. */
+	downsampleShader.use();
+	downsampleShader.setInt("srcTexture", 0);
+	downsampleShader.setFloat("threshold", threshold);
+	downsampleShader.setFloat("knee", knee);
+	int texelSizeLoc = glGetUniformLocation(downsampleShader.ID, "srcTexelSize");
+	int firstPassLoc = glGetUniformLocation(downsampleShader.ID, "firstPass");
+	glUniform2f(texelSizeLoc, 1.0f / width, 1.0f / height);
+	glUniform1i(firstPassLoc, 1);
+	glBindTexture(GL_TEXTURE_2D, hdrTexture);
+	for (unsigned int i = 0; i < mips.size(); i++) {
+		glViewport(0, 0, mips[i].width, mips[i].height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mips[i].texture, 0);
+		arena.drawScreenQuad();
+
+		glUniform2f(texelSizeLoc, 1.0f / mips[i].width, 1.0f / mips[i].height);
+		glUniform1i(firstPassLoc, 0);
+		glBindTexture(GL_TEXTURE_2D, mips[i].texture);
+	}
+
+	/* Upsample: each mip is blurred and added onto the next larger one, which keeps its own downsampled content. */
+	upsampleShader.use();
+	upsampleShader.setInt("srcTexture", 0);
+	upsampleShader.setFloat("filterRadius", filterRadius);
+	texelSizeLoc = glGetUniformLocation(upsampleShader.ID, "srcTexelSize");
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glBlendEquation(GL_FUNC_ADD);
+	for (unsigned int i = static_cast<unsigned int>(mips.size()) - 1; i > 0; i--) {
+		const BloomMip &source = mips[i];
+		const BloomMip &target = mips[i - 1];
+		glUniform2f(texelSizeLoc, 1.0f / source.width, 1.0f / source.height);
+		glBindTexture(GL_TEXTURE_2D, source.texture);
+		glViewport(0, 0, target.width, target.height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+		arena.drawScreenQuad();
+	}
+	glDisable(GL_BLEND);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+}
+
+void BloomRenderer::deleteBuffers()
+{
+	for (unsigned int i = 0; i < mips.size(); i++) {
+		glDeleteTextures(1, &mips[i].texture);
+	}
+	mips.clear();
+	if (FBO != 0) {
+		glDeleteFramebuffers(1, &FBO);
+		FBO = 0;
+	}
+}
@@ -72,6 +72,15 @@ void Camera::process_mouse_scroll(float yOffset)
 	}
 }
 
+void Camera::set_pose(const glm::vec3 &Position, float YAW, float PITCH, float ZOOM)
+{
+	position = Position;
+	yaw = YAW;
+	pitch = PITCH;
+	zoom = ZOOM;
+	update_camera_vectors();
+}
+
 void Camera::update_camera_vectors()
 {
 	glm::vec3 direction;
@@ -0,0 +1,88 @@
+#include "camera_path.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool CameraPath::load(const string &path)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "ERROR::CAMERA_PATH::FILE_NOT_READ: " << path << std::endl;
+		return false;
+	}
+	keys.clear();
+	string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == string::npos || line[start] == '#') {
+			continue;
+		}
+		std::istringstream stream(line);
+		CameraKey key;
+		if (!(stream >> key.frame >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch >> key.zoom)) {
+			std::cout << "ERROR::CAMERA_PATH::BAD_KEY: " << path << ":" << lineNumber << std::endl;
+			return false;
+		}
+		keys.push_back(key);
+	}
+	std::stable_sort(keys.begin(), keys.end(), [](const CameraKey &a, const CameraKey &b) {
+		return a.frame < b.frame;
+	});
+	return !keys.empty();
+}
+
+bool CameraPath::save(const string &path) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::CAMERA_PATH::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	file << "# frame x y z yaw pitch zoom\n";
+	for (unsigned int i = 0; i < keys.size(); i++) {
+		const CameraKey &key = keys[i];
+		file << key.frame << " " << key.position.x << " " << key.position.y << " " << key.position.z << " "
+			<< key.yaw << " " << key.pitch << " " << key.zoom << "\n";
+	}
+	return true;
+}
+
+void CameraPath::record(int frame, const Camera &camera)
+{
+	if (!keys.empty() && frame <= keys.back().frame) {
+		return;
+	}
+	CameraKey key;
+	key.frame = frame;
+	key.position = camera.position;
+	key.yaw = camera.yaw;
+	key.pitch = camera.pitch;
+	key.zoom = camera.zoom;
+	keys.push_back(key);
+}
+
+void CameraPath::apply(int frame, Camera &camera) const
+{
+	if (keys.empty()) {
+		return;
+	}
+	/* First key after the frame. */
+	auto next = std::upper_bound(keys.begin(), keys.end(), frame, [](int f, const CameraKey &key) {
+		return f < key.frame;
+	});
+	if (next == keys.begin() || next == keys.end()) {
+		const CameraKey &key = next == keys.begin() ? keys.front() : keys.back();
+		camera.set_pose(key.position, key.yaw, key.pitch, key.zoom);
+		return;
+	}
+	const CameraKey &a = *(next - 1);
+	const CameraKey &b = *next;
+	float t = static_cast<float>(frame - a.frame) / static_cast<float>(b.frame - a.frame);
+	camera.set_pose(glm::mix(a.position, b.position, t), glm::mix(a.yaw, b.yaw, t), glm::mix(a.pitch, b.pitch, t), glm::mix(a.zoom, b.zoom, t));
+}
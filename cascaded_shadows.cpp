@@ -0,0 +1,243 @@
+#include "cascaded_shadows.h"
+#include "profiler.h"
+#include "gl_resources.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+/* Extra radius of cached cascades, the camera can move this share of the radius before one has to be redrawn. */
+const float CacheMargin = 0.15f;
+
+CascadedShadowMap::CascadedShadowMap() : size(0), cascadeCount(0), firstCached(2), nextCached(0), splitLambda(0.75f),
+	shadowDistance(100.0f), rendered(0), block(), cascades(), FBO(0), depthArray(0), UBO(0)
+{
+	block.params = glm::vec4(0.0f, 0.1f, 1.5f, 0.0005f);
+}
+
+void CascadedShadowMap::create(int size, int cascadeCount)
+{
+	deleteBuffers();
+	this->size = size;
+	this->cascadeCount = std::min(std::max(cascadeCount, 1), MAX_CASCADES);
+	block.params.x = static_cast<float>(this->cascadeCount);
+
+	glGenTextures(1, &depthArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+	GL_LABEL(RESOURCE_TEXTURE, depthArray, "cascaded shadow maps");
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, size, size, this->cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	/* Hardware comparison with linear filtering, every fetch is a 2x2 PCF. */
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	/* Lit outside the map. */
+	float border[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	GL_LABEL(RESOURCE_FRAMEBUFFER, FBO, "cascaded shadows");
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::CASCADED_SHADOWS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenBuffers(1, &UBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	GL_LABEL(RESOURCE_BUFFER, UBO, "cascade block");
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CascadeBlock), &block, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	invalidate();
+}
+
+void CascadedShadowMap::invalidate()
+{
+	for (int i = 0; i < MAX_CASCADES; i++) {
+		cascades[i].valid = false;
+	}
+}
+
+void CascadedShadowMap::begin()
+{
+	casters.clear();
+}
+
+void CascadedShadowMap::addCaster(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec3 &center, float radius)
+{
+	if (!geometry.valid()) {
+		return;
+	}
+	casters.push_back(makeShadowCaster(geometry, model, center, radius));
+}
+
+void CascadedShadowMap::addMesh(const Mesh &mesh, const glm::mat4 &model)
+{
+	addCaster(mesh.geometry, model, mesh.boundsCenter, mesh.boundsRadius);
+}
+
+void CascadedShadowMap::fitSlice(float fovy, float aspect, float nearDepth, float farDepth, glm::vec3 &center, float &radius)
+{
+	/* Squared half diagonal of the frustum per unit of depth. The sphere is centred on the view axis where the
+	 * near and far corners are equally far away, which only depends on the projection, not on the camera
+	 * orientation. Long thin slices put the centre past the far plane, then the far corners alone decide. */
+	float tanHalf = std::tan(fovy * 0.5f);
+	float k = tanHalf * tanHalf * (1.0f + aspect * aspect);
+	float c = std::min((farDepth + nearDepth) * (1.0f + k) * 0.5f, farDepth);
+	center = glm::vec3(0.0f, 0.0f, -c);
+	radius = std::sqrt((farDepth - c) * (farDepth - c) + farDepth * farDepth * k);
+}
+
+glm::mat4 CascadedShadowMap::lightRotation(const glm::vec3 &lightDir)
+{
+	glm::vec3 up = std::abs(lightDir.y) < 0.999f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+	return glm::lookAt(glm::vec3(0.0f), lightDir, up);
+}
+
+void CascadedShadowMap::render(Shader &depthShader, const glm::mat4 &view, float fovy, float aspect, float zNear, const glm::vec3 &lightDir)
+{
+	PROFILE_GPU_SCOPE("cascaded shadows");
+	rendered = 0;
+	if (depthArray == 0) {
+		return;
+	}
+	glm::vec3 direction = glm::normalize(lightDir);
+	glm::mat4 rotation = lightRotation(direction);
+	glm::mat4 inverseView = glm::inverse(view);
+	block.view = view;
+
+	/* The cached cascade whose turn it is to be redrawn this frame. */
+	int turn = -1;
+	if (firstCached < cascadeCount) {
+		if (nextCached < firstCached || nextCached >= cascadeCount) {
+			nextCached = firstCached;
+		}
+		turn = nextCached++;
+	}
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glViewport(0, 0, size, size);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glEnable(GL_DEPTH_TEST);
+	/* Casters in front of the near plane are clamped onto it instead of being clipped. */
+	glEnable(GL_DEPTH_CLAMP);
+	depthShader.use();
+	int modelloc = glGetUniformLocation(depthShader.ID, "model");
+	int matrixloc = glGetUniformLocation(depthShader.ID, "lightSpaceMatrix");
+
+	float farDepth = shadowDistance;
+	float sliceNear = zNear;
+	for (int i = 0; i < cascadeCount; i++) {
+		float p = static_cast<float>(i + 1) / cascadeCount;
+		float logSplit = zNear * std::pow(farDepth / zNear, p);
+		float linearSplit = zNear + (farDepth - zNear) * p;
+		float sliceFar = splitLambda * logSplit + (1.0f - splitLambda) * linearSplit;
+		block.splits[i] = sliceFar;
+
+		glm::vec3 viewCenter;
+		float radius;
+		fitSlice(fovy, aspect, sliceNear, sliceFar, viewCenter, radius);
+		sliceNear = sliceFar;
+		glm::vec3 center = glm::vec3(inverseView * glm::vec4(viewCenter, 1.0f));
+
+		Cascade &cascade = cascades[i];
+		bool cached = i >= firstCached;
+		if (cached && cascade.valid && i != turn && glm::dot(cascade.lightDir, direction) > 0.99999f
+			&& glm::length(center - cascade.center) + radius <= cascade.radius) {
+			continue;
+		}
+		if (cached) {
+			radius *= 1.0f + CacheMargin;
+		}
+		/* Round up so float noise in the fit never changes the texel size. */
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		/* Snap the centre to whole texels in light space, so the map only ever moves by full texels. */
+		float texelSize = 2.0f * radius / size;
+		glm::vec3 lightCenter = glm::vec3(rotation * glm::vec4(center, 1.0f));
+		lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+		lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+		glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+			-(lightCenter.z + radius), -(lightCenter.z - radius));
+
+		block.matrices[i] = projection * rotation;
+		block.texelSizes[i] = texelSize;
+		cascade.center = center;
+		cascade.radius = radius;
+		cascade.lightDir = direction;
+		cascade.valid = true;
+		renderCascade(i, modelloc, matrixloc);
+	}
+
+	glDisable(GL_DEPTH_CLAMP);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CascadeBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void CascadedShadowMap::renderCascade(int index, int modelloc, int matrixloc)
+{
+	const glm::mat4 &matrix = block.matrices[index];
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0, index);
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glUniformMatrix4fv(matrixloc, 1, GL_FALSE, glm::value_ptr(matrix));
+
+	GeometryArena &arena = GeometryArena::get();
+	/* The projection is orthographic with the same scale on every axis, so a sphere stays a sphere in clip space. */
+	float scale = 1.0f / cascades[index].radius;
+	for (unsigned int i = 0; i < casters.size(); i++) {
+		glm::vec4 clip = matrix * glm::vec4(casters[i].center, 1.0f);
+		float r = casters[i].radius * scale;
+		/* Outside the square, or entirely behind the cascade. Anything towards the light is clamped and kept. */
+		if (std::abs(clip.x) > 1.0f + r || std::abs(clip.y) > 1.0f + r || clip.z - r > 1.0f) {
+			continue;
+		}
+		glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(casters[i].model));
+		arena.draw(casters[i].geometry);
+	}
+	rendered++;
+}
+
+void CascadedShadowMap::setupShader(Shader &shader, unsigned int unit)
+{
+	shader.use();
+	shader.setInt("cascadeShadowMap", unit);
+	unsigned int blockIndex = glGetUniformBlockIndex(shader.ID, "ShadowCascades");
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(shader.ID, blockIndex, SHADOW_CASCADES_BINDING);
+	}
+}
+
+void CascadedShadowMap::bind(unsigned int unit)
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+	glActiveTexture(GL_TEXTURE0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, SHADOW_CASCADES_BINDING, UBO);
+}
+
+void CascadedShadowMap::deleteBuffers()
+{
+	if (FBO != 0) {
+		glDeleteFramebuffers(1, &FBO);
+		glDeleteTextures(1, &depthArray);
+		glDeleteBuffers(1, &UBO);
+		FBO = 0;
+		depthArray = 0;
+		UBO = 0;
+	}
+	invalidate();
+}
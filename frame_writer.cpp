@@ -0,0 +1,121 @@
+#include "frame_writer.h"
+#include "gl_resources.h"
+
+#include <cstdio>
+#include <iostream>
+
+FrameWriter::FrameWriter() : PBOs(), PBOSizes(), pending(), first(0), count(0), written(0)
+{
+}
+
+void FrameWriter::capture(unsigned int fbo, int width, int height, const string &path)
+{
+	if (PBOs[0] == 0) {
+		glGenBuffers(FRAME_WRITER_BUFFERS, PBOs);
+		for (unsigned int i = 0; i < FRAME_WRITER_BUFFERS; i++) {
+			GL_LABEL(RESOURCE_BUFFER, PBOs[i], "frame readback " + std::to_string(i));
+		}
+	}
+	/* Keep one readback in flight per buffer at most. */
+	poll();
+	if (count == FRAME_WRITER_BUFFERS) {
+		retire(true);
+	}
+
+	unsigned int slot = (first + count) % FRAME_WRITER_BUFFERS;
+	unsigned int size = (unsigned int)width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[slot]);
+	if (PBOSizes[slot] != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		PBOSizes[slot] = size;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+	glReadBuffer(fbo == 0 ? GL_BACK : GL_COLOR_ATTACHMENT0);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	/* With a pack buffer bound the last argument is an offset, the call returns as soon as the copy is queued. */
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	pending[slot].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	pending[slot].width = width;
+	pending[slot].height = height;
+	pending[slot].path = path;
+	count++;
+}
+
+void FrameWriter::poll()
+{
+	while (count > 0 && retire(false)) {
+	}
+}
+
+void FrameWriter::finish()
+{
+	while (count > 0) {
+		retire(true);
+	}
+}
+
+bool FrameWriter::retire(bool wait)
+{
+	PendingFrame &frame = pending[first];
+	/* The first wait has to flush, otherwise the fence may never reach the GPU. */
+	GLenum status = glClientWaitSync(frame.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		return false;
+	}
+	glDeleteSync(frame.fence);
+	frame.fence = 0;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[first]);
+	const unsigned char *pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, PBOSizes[first], GL_MAP_READ_BIT);
+	if (pixels != NULL) {
+		if (writePPM(frame.path, pixels, frame.width, frame.height)) {
+			written++;
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	else {
+		std::cout << "ERROR::FRAME_WRITER::MAP_FAILED" << std::endl;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	first = (first + 1) % FRAME_WRITER_BUFFERS;
+	count--;
+	return true;
+}
+
+bool FrameWriter::writePPM(const string &path, const unsigned char *pixels, int width, int height)
+{
+	FILE *file = std::fopen(path.c_str(), "wb");
+	if (file == NULL) {
+		std::cout << "ERROR::FRAME_WRITER::FILE_NOT_WRITABLE: " << path << std::endl;
+		return false;
+	}
+	std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+	/* GL rows start at the bottom, and PPM has no alpha. */
+	rows.resize((size_t)width * 3);
+	for (int y = height - 1; y >= 0; y--) {
+		const unsigned char *row = pixels + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++) {
+			rows[x * 3 + 0] = row[x * 4 + 0];
+			rows[x * 3 + 1] = row[x * 4 + 1];
+			rows[x * 3 + 2] = row[x * 4 + 2];
+		}
+		std::fwrite(rows.data(), 1, rows.size(), file);
+	}
+	std::fclose(file);
+	return true;
+}
+
+void FrameWriter::deleteBuffers()
+{
+	finish();
+	if (PBOs[0] != 0) {
+		glDeleteBuffers(FRAME_WRITER_BUFFERS, PBOs);
+		for (unsigned int i = 0; i < FRAME_WRITER_BUFFERS; i++) {
+			PBOs[i] = 0;
+			PBOSizes[i] = 0;
+		}
+	}
+}
@@ -0,0 +1,91 @@
+#include "gbuffer.h"
+#include "gl_resources.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iostream>
+
+GBuffer::GBuffer() : FBO(0), depthTexture(0), normalTexture(0), albedoSpecTexture(0), width(0), height(0)
+{
+}
+
+static unsigned int createTarget(const char *label, GLenum internalFormat, GLenum format, GLenum type, int width, int height)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	GL_LABEL(RESOURCE_TEXTURE, texture, label);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+	/* Read one texel per pixel, filtering across edges would mix unrelated surfaces. */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	return texture;
+}
+
+void GBuffer::create(int width, int height)
+{
+	deleteBuffers();
+	this->width = width;
+	this->height = height;
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	GL_LABEL(RESOURCE_FRAMEBUFFER, FBO, "gbuffer");
+
+	normalTexture = createTarget("gbuffer normal", GL_RG16_SNORM, GL_RG, GL_FLOAT, width, height);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normalTexture, 0);
+	albedoSpecTexture = createTarget("gbuffer albedo spec", GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, albedoSpecTexture, 0);
+	depthTexture = createTarget("gbuffer depth", GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, width, height);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+	unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::GBUFFER::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glViewport(0, 0, width, height);
+}
+
+void GBuffer::bindTextures(unsigned int firstUnit)
+{
+	unsigned int textures[] = { depthTexture, normalTexture, albedoSpecTexture };
+	for (unsigned int i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::setupShader(Shader &shader, unsigned int firstUnit)
+{
+	shader.use();
+	shader.setInt("gDepth", firstUnit);
+	shader.setInt("gNormal", firstUnit + 1);
+	shader.setInt("gAlbedoSpec", firstUnit + 2);
+}
+
+void GBuffer::setMatrices(Shader &shader, const glm::mat4 &projection, const glm::mat4 &view)
+{
+	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "inverseProjection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+	glUniformMatrix4fv(glGetUniformLocation(shader.ID, "inverseView"), 1, GL_FALSE, glm::value_ptr(glm::inverse(view)));
+}
+
+void GBuffer::deleteBuffers()
+{
+	if (FBO != 0) {
+		unsigned int textures[] = { depthTexture, normalTexture, albedoSpecTexture };
+		glDeleteTextures(3, textures);
+		glDeleteFramebuffers(1, &FBO);
+		FBO = depthTexture = normalTexture = albedoSpecTexture = 0;
+	}
+}
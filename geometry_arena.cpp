@@ -0,0 +1,333 @@
+#include "geometry_arena.h"
+#include "mesh.h"
+#include "gl_resources.h"
+
+/* Initial sizes, in elements. The buffers double whenever an allocation doesn't fit. */
+const unsigned int InitialVertexCapacity = 1 << 16;
+const unsigned int InitialIndexCapacity = 1 << 18;
+
+/* Object labels, per Vertex_Format. */
+static const char *const FormatLabels[VERTEX_FORMAT_COUNT] = { "mesh", "p3n3t2", "p3t2" };
+
+RangeAllocator::RangeAllocator(unsigned int capacity) : capacity(0)
+{
+	grow(capacity);
+}
+
+bool RangeAllocator::allocate(unsigned int size, unsigned int &offset)
+{
+	for (unsigned int i = 0; i < freeBlocks.size(); i++) {
+		if (freeBlocks[i].size < size) {
+			continue;
+		}
+		offset = freeBlocks[i].offset;
+		freeBlocks[i].offset += size;
+		freeBlocks[i].size -= size;
+		if (freeBlocks[i].size == 0) {
+			freeBlocks.erase(freeBlocks.begin() + i);
+		}
+		return true;
+	}
+	return false;
+}
+
+void RangeAllocator::free(unsigned int offset, unsigned int size)
+{
+	if (size == 0) {
+		return;
+	}
+
+	/* Find the first block after the freed range, then merge with the neighbours on either side. */
+	unsigned int i = 0;
+	while (i < freeBlocks.size() && freeBlocks[i].offset < offset) {
+		i++;
+	}
+	freeBlocks.insert(freeBlocks.begin() + i, ArenaBlock{ offset, size });
+
+	if (i + 1 < freeBlocks.size() && freeBlocks[i].offset + freeBlocks[i].size == freeBlocks[i + 1].offset) {
+		freeBlocks[i].size += freeBlocks[i + 1].size;
+		freeBlocks.erase(freeBlocks.begin() + i + 1);
+	}
+	if (i > 0 && freeBlocks[i - 1].offset + freeBlocks[i - 1].size == freeBlocks[i].offset) {
+		freeBlocks[i - 1].size += freeBlocks[i].size;
+		freeBlocks.erase(freeBlocks.begin() + i);
+	}
+}
+
+void RangeAllocator::grow(unsigned int newCapacity)
+{
+	if (newCapacity <= capacity) {
+		return;
+	}
+	unsigned int oldCapacity = capacity;
+	capacity = newCapacity;
+	free(oldCapacity, newCapacity - oldCapacity);
+}
+
+GeometryArena& GeometryArena::get()
+{
+	static GeometryArena arena;
+	return arena;
+}
+
+unsigned int GeometryArena::getStride(Vertex_Format format)
+{
+	switch (format) {
+	case VERTEX_FORMAT_MESH:
+		return sizeof(Vertex);
+	case VERTEX_FORMAT_P3N3T2:
+		return (3 + 3 + 2) * sizeof(float);
+	case VERTEX_FORMAT_P3T2:
+		return (3 + 2) * sizeof(float);
+	default:
+		return 0;
+	}
+}
+
+void GeometryArena::setupFormat(Vertex_Format format)
+{
+	if (EBO == 0) {
+		glGenBuffers(1, &EBO);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+		GL_LABEL(RESOURCE_BUFFER, EBO, "arena indices");
+		glBufferData(GL_COPY_WRITE_BUFFER, InitialIndexCapacity * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+		indexAllocator.grow(InitialIndexCapacity);
+	}
+
+	glGenVertexArrays(1, &VAOs[format]);
+	glGenBuffers(1, &VBOs[format]);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, VBOs[format]);
+	GL_LABEL(RESOURCE_BUFFER, VBOs[format], string("arena vertices ") + FormatLabels[format]);
+	glBufferData(GL_COPY_WRITE_BUFFER, InitialVertexCapacity * getStride(format), NULL, GL_STATIC_DRAW);
+	vertexAllocators[format].grow(InitialVertexCapacity);
+
+	setupAttributes(format);
+}
+
+void GeometryArena::setupAttributes(Vertex_Format format)
+{
+	unsigned int stride = getStride(format);
+
+	glBindVertexArray(VAOs[format]);
+	boundVAO = VAOs[format];
+	GL_LABEL(RESOURCE_VERTEX_ARRAY, VAOs[format], string("arena ") + FormatLabels[format]);
+	glBindBuffer(GL_ARRAY_BUFFER, VBOs[format]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+	/* Attribute locations match the ones used by the vertex shaders for each layout. */
+	if (format == VERTEX_FORMAT_MESH) {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, TexCoords));
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Tangent));
+		glEnableVertexAttribArray(4);
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Bitangent));
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 4, GL_INT, stride, (void*)offsetof(Vertex, m_BoneIDs));
+		glEnableVertexAttribArray(6);
+		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, m_Weights));
+	}
+	else if (format == VERTEX_FORMAT_P3N3T2) {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(6 * sizeof(float)));
+	}
+	else if (format == VERTEX_FORMAT_P3T2) {
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+	}
+}
+
+unsigned int GeometryArena::growBuffer(unsigned int buffer, unsigned int oldBytes, unsigned int newBytes, const string &label)
+{
+	unsigned int newBuffer;
+	glGenBuffers(1, &newBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+	GL_LABEL(RESOURCE_BUFFER, newBuffer, label);
+	glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+	glDeleteBuffers(1, &buffer);
+	return newBuffer;
+}
+
+void GeometryArena::growVertices(Vertex_Format format, unsigned int minFree)
+{
+	RangeAllocator &allocator = vertexAllocators[format];
+	unsigned int newCapacity = allocator.capacity * 2;
+	while (newCapacity - allocator.capacity < minFree) {
+		newCapacity *= 2;
+	}
+
+	unsigned int stride = getStride(format);
+	VBOs[format] = growBuffer(VBOs[format], allocator.capacity * stride, newCapacity * stride, string("arena vertices ") + FormatLabels[format]);
+	allocator.grow(newCapacity);
+
+	/* Attribute pointers captured the old buffer name, so they need to be specified again. */
+	setupAttributes(format);
+}
+
+void GeometryArena::growIndices(unsigned int minFree)
+{
+	unsigned int newCapacity = indexAllocator.capacity * 2;
+	while (newCapacity - indexAllocator.capacity < minFree) {
+		newCapacity *= 2;
+	}
+
+	EBO = growBuffer(EBO, indexAllocator.capacity * sizeof(unsigned int), newCapacity * sizeof(unsigned int), "arena indices");
+	indexAllocator.grow(newCapacity);
+
+	/* The element buffer binding is part of every VAO. */
+	for (unsigned int i = 0; i < VERTEX_FORMAT_COUNT; i++) {
+		if (VAOs[i] != 0) {
+			glBindVertexArray(VAOs[i]);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		}
+	}
+	glBindVertexArray(boundVAO);
+}
+
+GeometryHandle GeometryArena::allocate(Vertex_Format format, const void *vertexData, unsigned int vertexCount,
+	const unsigned int *indices, unsigned int indexCount, GLenum mode)
+{
+	GeometryHandle handle;
+	if (vertexCount == 0 || indexCount == 0) {
+		return handle;
+	}
+
+	if (VAOs[format] == 0) {
+		setupFormat(format);
+	}
+
+	unsigned int baseVertex;
+	if (!vertexAllocators[format].allocate(vertexCount, baseVertex)) {
+		growVertices(format, vertexCount);
+		vertexAllocators[format].allocate(vertexCount, baseVertex);
+	}
+	unsigned int firstIndex;
+	if (!indexAllocator.allocate(indexCount, firstIndex)) {
+		growIndices(indexCount);
+		indexAllocator.allocate(indexCount, firstIndex);
+	}
+
+	/* Upload through the copy target so no VAO state is touched. */
+	unsigned int stride = getStride(format);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, VBOs[format]);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)baseVertex * stride, (GLsizeiptr)vertexCount * stride, vertexData);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)firstIndex * sizeof(unsigned int), (GLsizeiptr)indexCount * sizeof(unsigned int), indices);
+
+	handle.format = format;
+	handle.mode = mode;
+	handle.baseVertex = baseVertex;
+	handle.vertexCount = vertexCount;
+	handle.firstIndex = firstIndex;
+	handle.indexCount = indexCount;
+	return handle;
+}
+
+void GeometryArena::free(GeometryHandle &handle)
+{
+	if (!handle.valid()) {
+		return;
+	}
+	vertexAllocators[handle.format].free(handle.baseVertex, handle.vertexCount);
+	indexAllocator.free(handle.firstIndex, handle.indexCount);
+	handle = GeometryHandle();
+}
+
+void GeometryArena::bind(Vertex_Format format)
+{
+	if (boundVAO != VAOs[format]) {
+		glBindVertexArray(VAOs[format]);
+		boundVAO = VAOs[format];
+	}
+}
+
+void GeometryArena::resetBindingCache()
+{
+	boundVAO = 0;
+	glBindVertexArray(0);
+}
+
+void GeometryArena::draw(const GeometryHandle &handle)
+{
+	if (!handle.valid()) {
+		return;
+	}
+	bind(handle.format);
+	glDrawElementsBaseVertex(handle.mode, handle.indexCount, GL_UNSIGNED_INT,
+		(void*)((size_t)handle.firstIndex * sizeof(unsigned int)), handle.baseVertex);
+}
+
+void GeometryArena::drawBatch(const vector<const GeometryHandle*> &handles)
+{
+	unsigned int i = 0;
+	while (i < handles.size()) {
+		const GeometryHandle &first = *handles[i];
+
+		batchCounts.clear();
+		batchOffsets.clear();
+		batchBaseVertices.clear();
+		while (i < handles.size() && handles[i]->format == first.format && handles[i]->mode == first.mode) {
+			if (handles[i]->valid()) {
+				batchCounts.push_back(handles[i]->indexCount);
+				batchOffsets.push_back((void*)((size_t)handles[i]->firstIndex * sizeof(unsigned int)));
+				batchBaseVertices.push_back(handles[i]->baseVertex);
+			}
+			i++;
+		}
+		if (batchCounts.empty()) {
+			continue;
+		}
+
+		bind(first.format);
+		glMultiDrawElementsBaseVertex(first.mode, batchCounts.data(), GL_UNSIGNED_INT,
+			batchOffsets.data(), (GLsizei)batchCounts.size(), batchBaseVertices.data());
+	}
+}
+
+void GeometryArena::drawScreenQuad()
+{
+	if (!screenQuad.valid()) {
+		float vertices[] = {
+			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
+			-1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+			 1.0f,  1.0f, 0.0f, 1.0f, 1.0f,
+			 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+		};
+		unsigned int indices[] = { 0, 1, 2, 3 };
+		screenQuad = allocate(VERTEX_FORMAT_P3T2, vertices, 4, indices, 4, GL_TRIANGLE_STRIP);
+	}
+	draw(screenQuad);
+}
+
+void GeometryArena::deleteBuffers()
+{
+	screenQuad = GeometryHandle();
+	glBindVertexArray(0);
+	boundVAO = 0;
+	for (unsigned int i = 0; i < VERTEX_FORMAT_COUNT; i++) {
+		if (VAOs[i] != 0) {
+			glDeleteVertexArrays(1, &VAOs[i]);
+			glDeleteBuffers(1, &VBOs[i]);
+			VAOs[i] = 0;
+			VBOs[i] = 0;
+			vertexAllocators[i] = RangeAllocator();
+		}
+	}
+	if (EBO != 0) {
+		glDeleteBuffers(1, &EBO);
+		EBO = 0;
+		indexAllocator = RangeAllocator();
+	}
+}
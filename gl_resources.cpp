@@ -0,0 +1,606 @@
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+/* The hooks are plain functions, this is how they reach the registry. */
+static GLResources &resources = GLResources::get();
+
+/* Bindings the allocating calls act on, tracked from the hooked binds. */
+static unsigned int activeUnit = 0;
+static std::map<std::pair<unsigned int, GLenum>, unsigned int> boundTextures;
+static std::map<GLenum, unsigned int> boundBuffers;
+/* GL_ELEMENT_ARRAY_BUFFER is vertex array state, vertex array -> element buffer. */
+static std::map<unsigned int, unsigned int> elementBuffers;
+static unsigned int boundVertexArray = 0;
+static unsigned int boundRenderbuffer = 0;
+
+static const GLenum labelIdentifiers[RESOURCE_TYPES] = { GL_TEXTURE, GL_BUFFER, GL_RENDERBUFFER, GL_FRAMEBUFFER, GL_VERTEX_ARRAY, GL_PROGRAM };
+
+/* Pending label of an object that did not exist yet when it was labelled, glGen* only reserves names and GL
+ * creates the object on its first bind. */
+static void applyLabel(GL_Resource_Type type, unsigned int name)
+{
+	GLResource *resource = resources.find(type, name);
+	if (resource && resource->labelPending && glObjectLabel) {
+		glObjectLabel(labelIdentifiers[type], name, static_cast<GLsizei>(resource->label.size()), resource->label.c_str());
+		resource->labelPending = false;
+	}
+}
+
+static bool isCubeFace(GLenum target)
+{
+	return target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+}
+
+static GLResource* boundTexture(GLenum target)
+{
+	auto bound = boundTextures.find({ activeUnit, isCubeFace(target) ? GL_TEXTURE_CUBE_MAP : target });
+	return bound == boundTextures.end() ? nullptr : resources.find(RESOURCE_TEXTURE, bound->second);
+}
+
+static GLResource* boundBuffer(GLenum target)
+{
+	unsigned int buffer;
+	if (target == GL_ELEMENT_ARRAY_BUFFER) {
+		auto bound = elementBuffers.find(boundVertexArray);
+		buffer = bound == elementBuffers.end() ? 0 : bound->second;
+	}
+	else {
+		auto bound = boundBuffers.find(target);
+		buffer = bound == boundBuffers.end() ? 0 : bound->second;
+	}
+	return resources.find(RESOURCE_BUFFER, buffer);
+}
+
+/* Records level 0 and sizes every image from level to level + levels - 1, each level half the one before. Cube
+ * maps have an image per face, array textures keep their layer count on every level. */
+static void setTextureLevels(GLResource &texture, GLenum target, int level, int levels, GLenum internalFormat, int width, int height, int depth)
+{
+	if (level == 0) {
+		texture.format = internalFormat;
+		texture.width = width;
+		texture.height = height;
+		texture.depth = depth;
+	}
+	size_t texel = GLResources::texelSize(internalFormat);
+	int firstFace = isCubeFace(target) ? target - GL_TEXTURE_CUBE_MAP_POSITIVE_X : 0;
+	int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+	for (int i = 0; i < levels; i++) {
+		for (int face = firstFace; face < firstFace + faces; face++) {
+			resources.setImage(RESOURCE_TEXTURE, texture, (level + i) * 6 + face, texel * width * height * depth);
+		}
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+		if (target == GL_TEXTURE_3D) {
+			depth = std::max(depth / 2, 1);
+		}
+	}
+}
+
+/* Tracked entry points: the driver's function is kept in real<Name> while glad's pointer points at track<Name>. */
+#define GL_RESOURCES_HOOKS(HOOK) \
+	HOOK(GenTextures, GENTEXTURES) HOOK(DeleteTextures, DELETETEXTURES) HOOK(GenBuffers, GENBUFFERS) \
+	HOOK(DeleteBuffers, DELETEBUFFERS) HOOK(GenRenderbuffers, GENRENDERBUFFERS) HOOK(DeleteRenderbuffers, DELETERENDERBUFFERS) \
+	HOOK(GenFramebuffers, GENFRAMEBUFFERS) HOOK(DeleteFramebuffers, DELETEFRAMEBUFFERS) \
+	HOOK(GenVertexArrays, GENVERTEXARRAYS) HOOK(DeleteVertexArrays, DELETEVERTEXARRAYS) \
+	HOOK(CreateProgram, CREATEPROGRAM) HOOK(DeleteProgram, DELETEPROGRAM) \
+	HOOK(ActiveTexture, ACTIVETEXTURE) HOOK(BindTexture, BINDTEXTURE) HOOK(BindBuffer, BINDBUFFER) \
+	HOOK(BindBufferBase, BINDBUFFERBASE) HOOK(BindBufferRange, BINDBUFFERRANGE) HOOK(BindVertexArray, BINDVERTEXARRAY) \
+	HOOK(BindRenderbuffer, BINDRENDERBUFFER) HOOK(BindFramebuffer, BINDFRAMEBUFFER) \
+	HOOK(TexImage2D, TEXIMAGE2D) HOOK(TexImage2DMultisample, TEXIMAGE2DMULTISAMPLE) HOOK(TexImage3D, TEXIMAGE3D) \
+	HOOK(TexStorage2D, TEXSTORAGE2D) HOOK(TexStorage3D, TEXSTORAGE3D) HOOK(GenerateMipmap, GENERATEMIPMAP) \
+	HOOK(TexBuffer, TEXBUFFER) \
+	HOOK(BufferData, BUFFERDATA) HOOK(RenderbufferStorage, RENDERBUFFERSTORAGE) \
+	HOOK(RenderbufferStorageMultisample, RENDERBUFFERSTORAGEMULTISAMPLE)
+
+#define GL_RESOURCES_DECLARE(name, type) static PFNGL##type##PROC real##name = nullptr;
+GL_RESOURCES_HOOKS(GL_RESOURCES_DECLARE)
+#undef GL_RESOURCES_DECLARE
+
+/* glGen* and glDelete* of each type. */
+#define GL_RESOURCES_NAMES(name, type) \
+	static void APIENTRY trackGen##name(GLsizei n, GLuint *names) \
+	{ \
+		realGen##name(n, names); \
+		for (GLsizei i = 0; i < n; i++) { \
+			resources.created(type, names[i]); \
+		} \
+	} \
+	static void APIENTRY trackDelete##name(GLsizei n, const GLuint *names) \
+	{ \
+		for (GLsizei i = 0; i < n; i++) { \
+			resources.deleted(type, names[i]); \
+		} \
+		realDelete##name(n, names); \
+	}
+GL_RESOURCES_NAMES(Textures, RESOURCE_TEXTURE)
+GL_RESOURCES_NAMES(Buffers, RESOURCE_BUFFER)
+GL_RESOURCES_NAMES(Renderbuffers, RESOURCE_RENDERBUFFER)
+GL_RESOURCES_NAMES(Framebuffers, RESOURCE_FRAMEBUFFER)
+GL_RESOURCES_NAMES(VertexArrays, RESOURCE_VERTEX_ARRAY)
+#undef GL_RESOURCES_NAMES
+
+static GLuint APIENTRY trackCreateProgram()
+{
+	GLuint program = realCreateProgram();
+	resources.created(RESOURCE_PROGRAM, program);
+	return program;
+}
+static void APIENTRY trackDeleteProgram(GLuint program)
+{
+	resources.deleted(RESOURCE_PROGRAM, program);
+	realDeleteProgram(program);
+}
+
+static void APIENTRY trackActiveTexture(GLenum texture)
+{
+	activeUnit = texture - GL_TEXTURE0;
+	realActiveTexture(texture);
+}
+static void APIENTRY trackBindTexture(GLenum target, GLuint texture)
+{
+	realBindTexture(target, texture);
+	boundTextures[{ activeUnit, target }] = texture;
+	GLResource *resource = resources.find(RESOURCE_TEXTURE, texture);
+	if (resource && resource->target == 0) {
+		/* The first bind decides what kind of texture it is. */
+		resource->target = target;
+		applyLabel(RESOURCE_TEXTURE, texture);
+	}
+}
+static void APIENTRY trackBindBuffer(GLenum target, GLuint buffer)
+{
+	realBindBuffer(target, buffer);
+	if (target == GL_ELEMENT_ARRAY_BUFFER) {
+		elementBuffers[boundVertexArray] = buffer;
+	}
+	else {
+		boundBuffers[target] = buffer;
+	}
+	applyLabel(RESOURCE_BUFFER, buffer);
+}
+/* Indexed binds set the generic binding point too. */
+static void APIENTRY trackBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	realBindBufferBase(target, index, buffer);
+	boundBuffers[target] = buffer;
+	applyLabel(RESOURCE_BUFFER, buffer);
+}
+static void APIENTRY trackBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	realBindBufferRange(target, index, buffer, offset, size);
+	boundBuffers[target] = buffer;
+	applyLabel(RESOURCE_BUFFER, buffer);
+}
+static void APIENTRY trackBindVertexArray(GLuint array)
+{
+	realBindVertexArray(array);
+	boundVertexArray = array;
+	applyLabel(RESOURCE_VERTEX_ARRAY, array);
+}
+static void APIENTRY trackBindRenderbuffer(GLenum target, GLuint renderbuffer)
+{
+	realBindRenderbuffer(target, renderbuffer);
+	boundRenderbuffer = renderbuffer;
+	applyLabel(RESOURCE_RENDERBUFFER, renderbuffer);
+}
+static void APIENTRY trackBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	realBindFramebuffer(target, framebuffer);
+	applyLabel(RESOURCE_FRAMEBUFFER, framebuffer);
+}
+
+static void APIENTRY trackTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+	GLenum format, GLenum type, const void *pixels)
+{
+	realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	GLResource *texture = boundTexture(target);
+	if (texture) {
+		setTextureLevels(*texture, target, level, 1, internalformat, width, height, 1);
+	}
+}
+static void APIENTRY trackTexImage2DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height,
+	GLboolean fixedsamplelocations)
+{
+	realTexImage2DMultisample(target, samples, internalformat, width, height, fixedsamplelocations);
+	/* Every sample takes a texel, like multisampled renderbuffers. */
+	GLResource *texture = boundTexture(target);
+	if (texture) {
+		setTextureLevels(*texture, target, 0, 1, internalformat, width, height, std::max(samples, 1));
+	}
+}
+static void APIENTRY trackTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+	GLint border, GLenum format, GLenum type, const void *pixels)
+{
+	realTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	GLResource *texture = boundTexture(target);
+	if (texture) {
+		setTextureLevels(*texture, target, level, 1, internalformat, width, height, depth);
+	}
+}
+static void APIENTRY trackTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	realTexStorage2D(target, levels, internalformat, width, height);
+	GLResource *texture = boundTexture(target);
+	if (texture) {
+		setTextureLevels(*texture, target, 0, levels, internalformat, width, height, 1);
+	}
+}
+static void APIENTRY trackTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)
+{
+	realTexStorage3D(target, levels, internalformat, width, height, depth);
+	GLResource *texture = boundTexture(target);
+	if (texture) {
+		setTextureLevels(*texture, target, 0, levels, internalformat, width, height, depth);
+	}
+}
+static void APIENTRY trackGenerateMipmap(GLenum target)
+{
+	realGenerateMipmap(target);
+	GLResource *texture = boundTexture(target);
+	if (texture && texture->width > 0) {
+		int largest = std::max(texture->width, texture->height);
+		if (target == GL_TEXTURE_3D) {
+			largest = std::max(largest, texture->depth);
+		}
+		int levels = 1;
+		while (largest >>= 1) {
+			levels++;
+		}
+		setTextureLevels(*texture, target, 0, levels, texture->format, texture->width, texture->height, texture->depth);
+	}
+}
+static void APIENTRY trackTexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
+{
+	realTexBuffer(target, internalformat, buffer);
+	/* The storage is the buffer's, the texture is only a view of it. */
+	GLResource *texture = boundTexture(target);
+	if (texture) {
+		texture->format = internalformat;
+	}
+}
+
+static void APIENTRY trackBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+	realBufferData(target, size, data, usage);
+	GLResource *buffer = boundBuffer(target);
+	if (buffer) {
+		resources.setImage(RESOURCE_BUFFER, *buffer, 0, size);
+	}
+}
+static void APIENTRY trackRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	realRenderbufferStorageMultisample(target, samples, internalformat, width, height);
+	GLResource *renderbuffer = resources.find(RESOURCE_RENDERBUFFER, boundRenderbuffer);
+	if (renderbuffer) {
+		renderbuffer->format = internalformat;
+		renderbuffer->width = width;
+		renderbuffer->height = height;
+		renderbuffer->depth = std::max(samples, 1);
+		resources.setImage(RESOURCE_RENDERBUFFER, *renderbuffer, 0, GLResources::texelSize(internalformat) * width * height * std::max(samples, 1));
+	}
+}
+static void APIENTRY trackRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	realRenderbufferStorage(target, internalformat, width, height);
+	GLResource *renderbuffer = resources.find(RESOURCE_RENDERBUFFER, boundRenderbuffer);
+	if (renderbuffer) {
+		renderbuffer->format = internalformat;
+		renderbuffer->width = width;
+		renderbuffer->height = height;
+		renderbuffer->depth = 1;
+		resources.setImage(RESOURCE_RENDERBUFFER, *renderbuffer, 0, GLResources::texelSize(internalformat) * width * height);
+	}
+}
+
+GLResources& GLResources::get()
+{
+	static GLResources glResources;
+	return glResources;
+}
+
+void GLResources::setEnabled(bool enable)
+{
+	if (enable == enabled) {
+		return;
+	}
+	if (enable) {
+#define GL_RESOURCES_INSTALL(name, type) real##name = glad_gl##name; glad_gl##name = track##name;
+		GL_RESOURCES_HOOKS(GL_RESOURCES_INSTALL)
+#undef GL_RESOURCES_INSTALL
+	}
+	else {
+#define GL_RESOURCES_REMOVE(name, type) glad_gl##name = real##name;
+		GL_RESOURCES_HOOKS(GL_RESOURCES_REMOVE)
+#undef GL_RESOURCES_REMOVE
+	}
+	enabled = enable;
+}
+
+void GLResources::label(GL_Resource_Type type, unsigned int name, const string &label, GLSite site)
+{
+	if (name == 0) {
+		return;
+	}
+	static bool (*const exists[RESOURCE_TYPES])(unsigned int) = {
+		[](unsigned int name) { return glIsTexture(name) == GL_TRUE; },
+		[](unsigned int name) { return glIsBuffer(name) == GL_TRUE; },
+		[](unsigned int name) { return glIsRenderbuffer(name) == GL_TRUE; },
+		[](unsigned int name) { return glIsFramebuffer(name) == GL_TRUE; },
+		[](unsigned int name) { return glIsVertexArray(name) == GL_TRUE; },
+		[](unsigned int name) { return glIsProgram(name) == GL_TRUE; }
+	};
+	bool labelled = false;
+	if (glObjectLabel && exists[type](name)) {
+		glObjectLabel(labelIdentifiers[type], name, static_cast<GLsizei>(label.size()), label.c_str());
+		labelled = true;
+	}
+	if (!enabled) {
+		return;
+	}
+	GLResource *resource = find(type, name);
+	if (!resource) {
+		/* Created before the registry was enabled. */
+		created(type, name);
+		resource = find(type, name);
+	}
+	resource->label = label;
+	resource->site = site;
+	resource->labelPending = !labelled;
+}
+
+size_t GLResources::totalBytes() const
+{
+	size_t total = 0;
+	for (int type = 0; type < RESOURCE_TYPES; type++) {
+		total += bytes[type];
+	}
+	return total;
+}
+
+string GLResources::memorySize(size_t bytes)
+{
+	char buffer[32];
+	if (bytes < 1024 * 1024) {
+		std::snprintf(buffer, sizeof(buffer), "%.1f KB", bytes / 1024.0);
+	}
+	else {
+		std::snprintf(buffer, sizeof(buffer), "%.1f MB", bytes / (1024.0 * 1024.0));
+	}
+	return buffer;
+}
+
+static string formatName(GLenum format)
+{
+	switch (format) {
+	case GL_RED: return "GL_RED";
+	case GL_RG: return "GL_RG";
+	case GL_RGB: return "GL_RGB";
+	case GL_RGBA: return "GL_RGBA";
+	case GL_R8: return "GL_R8";
+	case GL_RG8: return "GL_RG8";
+	case GL_RGB8: return "GL_RGB8";
+	case GL_RGBA8: return "GL_RGBA8";
+	case GL_SRGB8: return "GL_SRGB8";
+	case GL_SRGB8_ALPHA8: return "GL_SRGB8_ALPHA8";
+	case GL_RG16_SNORM: return "GL_RG16_SNORM";
+	case GL_R16F: return "GL_R16F";
+	case GL_RG16F: return "GL_RG16F";
+	case GL_RGB16F: return "GL_RGB16F";
+	case GL_RGBA16F: return "GL_RGBA16F";
+	case GL_R32F: return "GL_R32F";
+	case GL_RG32F: return "GL_RG32F";
+	case GL_RGB32F: return "GL_RGB32F";
+	case GL_RGBA32F: return "GL_RGBA32F";
+	case GL_R11F_G11F_B10F: return "GL_R11F_G11F_B10F";
+	case GL_R32UI: return "GL_R32UI";
+	case GL_RG32UI: return "GL_RG32UI";
+	case GL_RGBA32UI: return "GL_RGBA32UI";
+	case GL_DEPTH_COMPONENT: return "GL_DEPTH_COMPONENT";
+	case GL_DEPTH_COMPONENT16: return "GL_DEPTH_COMPONENT16";
+	case GL_DEPTH_COMPONENT24: return "GL_DEPTH_COMPONENT24";
+	case GL_DEPTH_COMPONENT32F: return "GL_DEPTH_COMPONENT32F";
+	case GL_DEPTH24_STENCIL8: return "GL_DEPTH24_STENCIL8";
+	case GL_DEPTH32F_STENCIL8: return "GL_DEPTH32F_STENCIL8";
+	}
+	char buffer[16];
+	std::snprintf(buffer, sizeof(buffer), "0x%04X", format);
+	return buffer;
+}
+
+/* "\"env cubemap\" 512x512x1 GL_RGB16F, created at Aurora.cpp:704" */
+static string describe(const GLResource &resource)
+{
+	string text = resource.label.empty() ? "(unlabelled)" : "\"" + resource.label + "\"";
+	if (resource.width > 0 && resource.format != 0) {
+		text += " " + std::to_string(resource.width) + "x" + std::to_string(resource.height) + "x" + std::to_string(resource.depth)
+			+ " " + formatName(resource.format);
+	}
+	if (resource.site.file) {
+		text += ", created at " + string(resource.site.file) + ":" + std::to_string(resource.site.line);
+	}
+	return text;
+}
+
+void GLResources::report(std::ostream &out, unsigned int largest) const
+{
+	out << "GPU memory: " << memorySize(totalBytes()) << " live, " << memorySize(peak) << " peak\n";
+	for (int type = 0; type < RESOURCE_TYPES; type++) {
+		char line[64];
+		std::snprintf(line, sizeof(line), "  %-14s %5u  %10s\n", typeName(static_cast<GL_Resource_Type>(type)),
+			static_cast<unsigned int>(live[type].size()), memorySize(bytes[type]).c_str());
+		out << line;
+	}
+	if (largest == 0) {
+		return;
+	}
+	std::vector<std::pair<size_t, std::pair<int, unsigned int>>> objects;
+	for (int type = 0; type < RESOURCE_TYPES; type++) {
+		for (const auto &object : live[type]) {
+			if (object.second.bytes > 0) {
+				objects.push_back({ object.second.bytes, { type, object.first } });
+			}
+		}
+	}
+	std::sort(objects.rbegin(), objects.rend());
+	for (unsigned int i = 0; i < objects.size() && i < largest; i++) {
+		GL_Resource_Type type = static_cast<GL_Resource_Type>(objects[i].second.first);
+		unsigned int name = objects[i].second.second;
+		out << "  " << memorySize(objects[i].first) << "  " << typeName(type) << " " << name << " " << describe(live[type].at(name)) << "\n";
+	}
+}
+
+string GLResources::summary() const
+{
+	return "GPU " + memorySize(totalBytes());
+}
+
+unsigned int GLResources::checkLeaks() const
+{
+	unsigned int leaks = 0;
+	for (int type = 0; type < RESOURCE_TYPES; type++) {
+		for (const auto &object : live[type]) {
+			std::cout << "ERROR::GL_RESOURCES::LEAK: " << typeName(static_cast<GL_Resource_Type>(type)) << " " << object.first << " "
+				<< describe(object.second) << ", " << memorySize(object.second.bytes) << std::endl;
+			leaks++;
+		}
+	}
+	return leaks;
+}
+
+const char* GLResources::typeName(GL_Resource_Type type)
+{
+	switch (type) {
+	case RESOURCE_TEXTURE: return "texture";
+	case RESOURCE_BUFFER: return "buffer";
+	case RESOURCE_RENDERBUFFER: return "renderbuffer";
+	case RESOURCE_FRAMEBUFFER: return "framebuffer";
+	case RESOURCE_VERTEX_ARRAY: return "vertex array";
+	case RESOURCE_PROGRAM: return "program";
+	default: return "unknown";
+	}
+}
+
+size_t GLResources::texelSize(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_RED: case GL_R8: case GL_R8I: case GL_R8UI: case GL_STENCIL_INDEX8:
+		return 1;
+	case GL_RG: case GL_RG8: case GL_R16F: case GL_R16I: case GL_R16UI: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGB: case GL_RGB8: case GL_SRGB8:
+		return 3;
+	case GL_RGBA: case GL_RGBA8: case GL_SRGB8_ALPHA8: case GL_RG16F: case GL_RG16: case GL_RG16_SNORM: case GL_R32F:
+	case GL_R32I: case GL_R32UI: case GL_R11F_G11F_B10F: case GL_RGB10_A2: case GL_RGB9_E5:
+	case GL_DEPTH_COMPONENT: case GL_DEPTH_COMPONENT24: case GL_DEPTH_COMPONENT32: case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH_STENCIL: case GL_DEPTH24_STENCIL8:
+		return 4;
+	case GL_RGB16F: case GL_RGB16:
+		return 6;
+	case GL_RGBA16F: case GL_RGBA16: case GL_RG32F: case GL_RG32I: case GL_RG32UI: case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB32F: case GL_RGB32I: case GL_RGB32UI:
+		return 12;
+	case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI:
+		return 16;
+	}
+	return 4;
+}
+
+unsigned int GLResources::generate(GL_Resource_Type type)
+{
+	unsigned int name = 0;
+	switch (type) {
+	case RESOURCE_TEXTURE: glGenTextures(1, &name); break;
+	case RESOURCE_BUFFER: glGenBuffers(1, &name); break;
+	case RESOURCE_RENDERBUFFER: glGenRenderbuffers(1, &name); break;
+	case RESOURCE_FRAMEBUFFER: glGenFramebuffers(1, &name); break;
+	case RESOURCE_VERTEX_ARRAY: glGenVertexArrays(1, &name); break;
+	case RESOURCE_PROGRAM: name = glCreateProgram(); break;
+	default: break;
+	}
+	return name;
+}
+
+void GLResources::destroy(GL_Resource_Type type, unsigned int name)
+{
+	switch (type) {
+	case RESOURCE_TEXTURE: glDeleteTextures(1, &name); break;
+	case RESOURCE_BUFFER: glDeleteBuffers(1, &name); break;
+	case RESOURCE_RENDERBUFFER: glDeleteRenderbuffers(1, &name); break;
+	case RESOURCE_FRAMEBUFFER: glDeleteFramebuffers(1, &name); break;
+	case RESOURCE_VERTEX_ARRAY: glDeleteVertexArrays(1, &name); break;
+	case RESOURCE_PROGRAM: glDeleteProgram(name); break;
+	default: break;
+	}
+}
+
+void GLResources::created(GL_Resource_Type type, unsigned int name)
+{
+	if (name == 0) {
+		return;
+	}
+	deleted(type, name);
+	live[type][name] = GLResource();
+}
+
+void GLResources::deleted(GL_Resource_Type type, unsigned int name)
+{
+	auto object = live[type].find(name);
+	if (object == live[type].end()) {
+		return;
+	}
+	bytes[type] -= object->second.bytes;
+	live[type].erase(object);
+
+	/* GL unbinds deleted objects, so a reused name does not inherit a binding. */
+	if (type == RESOURCE_TEXTURE) {
+		for (auto &bound : boundTextures) {
+			if (bound.second == name) {
+				bound.second = 0;
+			}
+		}
+	}
+	else if (type == RESOURCE_BUFFER) {
+		for (auto &bound : boundBuffers) {
+			if (bound.second == name) {
+				bound.second = 0;
+			}
+		}
+		for (auto &bound : elementBuffers) {
+			if (bound.second == name) {
+				bound.second = 0;
+			}
+		}
+	}
+	else if (type == RESOURCE_VERTEX_ARRAY) {
+		elementBuffers.erase(name);
+		if (boundVertexArray == name) {
+			boundVertexArray = 0;
+		}
+	}
+	else if (type == RESOURCE_RENDERBUFFER && boundRenderbuffer == name) {
+		boundRenderbuffer = 0;
+	}
+}
+
+GLResource* GLResources::find(GL_Resource_Type type, unsigned int name)
+{
+	if (name == 0) {
+		return nullptr;
+	}
+	auto object = live[type].find(name);
+	return object == live[type].end() ? nullptr : &object->second;
+}
+
+void GLResources::setImage(GL_Resource_Type type, GLResource &resource, int image, size_t imageBytes)
+{
+	size_t &current = resource.images[image];
+	resource.bytes = resource.bytes - current + imageBytes;
+	bytes[type] = bytes[type] - current + imageBytes;
+	current = imageBytes;
+	peak = std::max(peak, totalBytes());
+}
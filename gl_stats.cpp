@@ -0,0 +1,316 @@
+#include "gl_stats.h"
+
+#include <cstdio>
+
+/* The hooks are plain functions, this is how they reach the counters. */
+static GLStats &stats = GLStats::get();
+
+/* Texture bound per unit and target, to tell redundant binds apart. Other units and targets are not tracked. */
+const unsigned int TrackedTextureUnits = 32;
+static unsigned int boundTextures[TrackedTextureUnits][5];
+
+static int trackedTarget(GLenum target)
+{
+	switch (target) {
+	case GL_TEXTURE_2D: return 0;
+	case GL_TEXTURE_CUBE_MAP: return 1;
+	case GL_TEXTURE_2D_ARRAY: return 2;
+	case GL_TEXTURE_3D: return 3;
+	case GL_TEXTURE_BUFFER: return 4;
+	}
+	return -1;
+}
+
+static void countDraw(GLenum mode, long long count, long long instances)
+{
+	stats.current.draws++;
+	stats.current.instances += instances;
+	stats.current.primitives += GLStats::primitiveCount(mode, count) * instances;
+}
+
+/* Counted entry points: the driver's function is kept in real<Name> while glad's pointer points at count<Name>. */
+#define GL_STATS_HOOKS(HOOK) \
+	HOOK(DrawArrays, DRAWARRAYS) HOOK(DrawArraysInstanced, DRAWARRAYSINSTANCED) HOOK(DrawElements, DRAWELEMENTS) \
+	HOOK(DrawElementsInstanced, DRAWELEMENTSINSTANCED) HOOK(DrawElementsBaseVertex, DRAWELEMENTSBASEVERTEX) \
+	HOOK(DrawElementsInstancedBaseVertex, DRAWELEMENTSINSTANCEDBASEVERTEX) \
+	HOOK(MultiDrawElementsBaseVertex, MULTIDRAWELEMENTSBASEVERTEX) HOOK(MultiDrawElementsIndirect, MULTIDRAWELEMENTSINDIRECT) \
+	HOOK(UseProgram, USEPROGRAM) HOOK(ActiveTexture, ACTIVETEXTURE) HOOK(BindTexture, BINDTEXTURE) \
+	HOOK(BindFramebuffer, BINDFRAMEBUFFER) HOOK(BufferData, BUFFERDATA) HOOK(BufferSubData, BUFFERSUBDATA) \
+	HOOK(MapBufferRange, MAPBUFFERRANGE) HOOK(TexImage2D, TEXIMAGE2D) HOOK(TexImage3D, TEXIMAGE3D) \
+	HOOK(TexSubImage2D, TEXSUBIMAGE2D) HOOK(TexSubImage3D, TEXSUBIMAGE3D)
+
+#define GL_STATS_DECLARE(name, type) static PFNGL##type##PROC real##name = nullptr;
+GL_STATS_HOOKS(GL_STATS_DECLARE)
+#undef GL_STATS_DECLARE
+
+static void APIENTRY countDrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	stats.current.drawCalls++;
+	countDraw(mode, count, 1);
+	realDrawArrays(mode, first, count);
+}
+static void APIENTRY countDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+{
+	stats.current.drawCalls++;
+	countDraw(mode, count, instancecount);
+	realDrawArraysInstanced(mode, first, count, instancecount);
+}
+static void APIENTRY countDrawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+	stats.current.drawCalls++;
+	countDraw(mode, count, 1);
+	realDrawElements(mode, count, type, indices);
+}
+static void APIENTRY countDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount)
+{
+	stats.current.drawCalls++;
+	countDraw(mode, count, instancecount);
+	realDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
+static void APIENTRY countDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex)
+{
+	stats.current.drawCalls++;
+	countDraw(mode, count, 1);
+	realDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+}
+static void APIENTRY countDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLint basevertex)
+{
+	stats.current.drawCalls++;
+	countDraw(mode, count, instancecount);
+	realDrawElementsInstancedBaseVertex(mode, count, type, indices, instancecount, basevertex);
+}
+static void APIENTRY countMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount, const GLint *basevertex)
+{
+	stats.current.drawCalls++;
+	for (GLsizei i = 0; i < drawcount; i++) {
+		countDraw(mode, count[i], 1);
+	}
+	realMultiDrawElementsBaseVertex(mode, count, type, indices, drawcount, basevertex);
+}
+static void APIENTRY countMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride)
+{
+	/* Instances and primitives are in the buffer, see addIndirectWork(). */
+	stats.current.drawCalls++;
+	stats.current.draws += drawcount;
+	realMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+}
+
+static void APIENTRY countUseProgram(GLuint program)
+{
+	if (program != stats.program) {
+		stats.current.programSwitches++;
+		stats.program = program;
+	}
+	realUseProgram(program);
+}
+static void APIENTRY countActiveTexture(GLenum texture)
+{
+	stats.activeTexture = texture - GL_TEXTURE0;
+	realActiveTexture(texture);
+}
+static void APIENTRY countBindTexture(GLenum target, GLuint texture)
+{
+	stats.current.textureBinds++;
+	int tracked = trackedTarget(target);
+	if (tracked >= 0 && stats.activeTexture < TrackedTextureUnits) {
+		unsigned int &bound = boundTextures[stats.activeTexture][tracked];
+		if (bound == texture) {
+			stats.current.redundantTextureBinds++;
+		}
+		bound = texture;
+	}
+	realBindTexture(target, texture);
+}
+static void APIENTRY countBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	if (target != GL_READ_FRAMEBUFFER && framebuffer != stats.drawFramebuffer) {
+		stats.current.framebufferSwitches++;
+		stats.drawFramebuffer = framebuffer;
+	}
+	realBindFramebuffer(target, framebuffer);
+}
+
+static void APIENTRY countBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+	if (data) {
+		stats.current.bufferBytes += size;
+	}
+	realBufferData(target, size, data, usage);
+}
+static void APIENTRY countBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	stats.current.bufferBytes += size;
+	realBufferSubData(target, offset, size, data);
+}
+static void* APIENTRY countMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	if (access & GL_MAP_WRITE_BIT) {
+		stats.current.bufferBytes += length;
+	}
+	return realMapBufferRange(target, offset, length, access);
+}
+static void APIENTRY countTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+	GLenum format, GLenum type, const void *pixels)
+{
+	if (pixels) {
+		stats.current.textureBytes += GLStats::imageSize(width, height, 1, format, type);
+	}
+	realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+static void APIENTRY countTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+	GLint border, GLenum format, GLenum type, const void *pixels)
+{
+	if (pixels) {
+		stats.current.textureBytes += GLStats::imageSize(width, height, depth, format, type);
+	}
+	realTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+}
+static void APIENTRY countTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, const void *pixels)
+{
+	stats.current.textureBytes += GLStats::imageSize(width, height, 1, format, type);
+	realTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+static void APIENTRY countTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+	GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+{
+	stats.current.textureBytes += GLStats::imageSize(width, height, depth, format, type);
+	realTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+}
+
+GLStats& GLStats::get()
+{
+	static GLStats glStats;
+	return glStats;
+}
+
+void GLStats::setEnabled(bool enable)
+{
+	if (enable == enabled) {
+		return;
+	}
+	if (enable) {
+#define GL_STATS_INSTALL(name, type) real##name = glad_gl##name; glad_gl##name = count##name;
+		GL_STATS_HOOKS(GL_STATS_INSTALL)
+#undef GL_STATS_INSTALL
+	}
+	else {
+#define GL_STATS_REMOVE(name, type) glad_gl##name = real##name;
+		GL_STATS_HOOKS(GL_STATS_REMOVE)
+#undef GL_STATS_REMOVE
+	}
+	enabled = enable;
+}
+
+void GLStats::endFrame()
+{
+	last = current;
+	totals.drawCalls += current.drawCalls;
+	totals.draws += current.draws;
+	totals.instances += current.instances;
+	totals.primitives += current.primitives;
+	totals.programSwitches += current.programSwitches;
+	totals.textureBinds += current.textureBinds;
+	totals.redundantTextureBinds += current.redundantTextureBinds;
+	totals.framebufferSwitches += current.framebufferSwitches;
+	totals.bufferBytes += current.bufferBytes;
+	totals.textureBytes += current.textureBytes;
+	frameCount++;
+	current = GLFrameStats();
+}
+
+void GLStats::addIndirectWork(unsigned long long instances, unsigned long long primitives)
+{
+	current.instances += instances;
+	current.primitives += primitives;
+}
+
+void GLStats::addToBenchmark(Benchmark &benchmark) const
+{
+	benchmark.addCounter("draw_calls", last.drawCalls);
+	benchmark.addCounter("draws", last.draws);
+	benchmark.addCounter("instances", static_cast<double>(last.instances));
+	benchmark.addCounter("primitives", static_cast<double>(last.primitives));
+	benchmark.addCounter("program_switches", last.programSwitches);
+	benchmark.addCounter("texture_binds", last.textureBinds);
+	benchmark.addCounter("redundant_texture_binds", last.redundantTextureBinds);
+	benchmark.addCounter("framebuffer_switches", last.framebufferSwitches);
+	benchmark.addCounter("buffer_bytes", static_cast<double>(last.bufferBytes));
+	benchmark.addCounter("texture_bytes", static_cast<double>(last.textureBytes));
+}
+
+string GLStats::summary() const
+{
+	char buffer[64];
+	if (last.primitives >= 1000000) {
+		std::snprintf(buffer, sizeof(buffer), "%u draws, %.1fM tris", last.draws, last.primitives / 1000000.0);
+	}
+	else if (last.primitives >= 1000) {
+		std::snprintf(buffer, sizeof(buffer), "%u draws, %.1fK tris", last.draws, last.primitives / 1000.0);
+	}
+	else {
+		std::snprintf(buffer, sizeof(buffer), "%u draws, %llu tris", last.draws, last.primitives);
+	}
+	return buffer;
+}
+
+unsigned long long GLStats::primitiveCount(GLenum mode, long long count)
+{
+	switch (mode) {
+	case GL_POINTS: return count;
+	case GL_LINES: return count / 2;
+	case GL_LINE_STRIP: return count > 1 ? count - 1 : 0;
+	case GL_LINE_LOOP: return count > 1 ? count : 0;
+	case GL_TRIANGLES: return count / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN: return count > 2 ? count - 2 : 0;
+	}
+	return 0;
+}
+
+size_t GLStats::imageSize(int width, int height, int depth, GLenum format, GLenum type, int alignment, int rowLength)
+{
+	if (width <= 0 || height <= 0 || depth <= 0) {
+		return 0;
+	}
+	size_t pixel;
+	switch (type) {
+	case GL_UNSIGNED_INT_24_8:
+	case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV:
+	case GL_UNSIGNED_INT_2_10_10_10_REV:
+		pixel = 4;
+		break;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+		pixel = 8;
+		break;
+	default: {
+		size_t components = 4;
+		switch (format) {
+		case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX:
+			components = 1;
+			break;
+		case GL_RG: case GL_RG_INTEGER:
+			components = 2;
+			break;
+		case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+			components = 3;
+			break;
+		}
+		size_t bytes = 4;
+		switch (type) {
+		case GL_UNSIGNED_BYTE: case GL_BYTE:
+			bytes = 1;
+			break;
+		case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT:
+			bytes = 2;
+			break;
+		}
+		pixel = components * bytes;
+		break;
+	}
+	}
+	size_t row = (rowLength > 0 ? rowLength : width) * pixel;
+	row = (row + alignment - 1) / alignment * alignment;
+	return row * (static_cast<size_t>(height) * depth - 1) + width * pixel;
+}
@@ -0,0 +1,1431 @@
+#include "gl_trace.h"
+#include "gl_stats.h"
+
+#include <iostream>
+
+/* The recorder is a singleton and the hooks are plain functions, this is how they reach it. */
+static GLTraceRecorder &recorder = GLTraceRecorder::get();
+
+/* Client side state the hooks need to size and classify their arguments, tracked from the hooked calls. */
+static unsigned int packBuffer = 0, unpackBuffer = 0;
+static int packAlignment = 4, unpackAlignment = 4, packRowLength = 0, unpackRowLength = 0;
+struct MappedRange {
+	void *pointer;
+	GLsizeiptr length;
+	GLbitfield access;
+};
+static std::map<GLenum, MappedRange> mappedRanges;
+
+/* Records a command whose arguments are all plain values. */
+template <typename... Args>
+static void record(GL_Trace_Command command, const Args&... args)
+{
+	recorder.beginCommand(command);
+	(recorder.put(args), ...);
+	recorder.endCommand();
+}
+
+static void recordNames(GL_Trace_Command command, GL_Trace_Object type, GLsizei n, const GLuint *names)
+{
+	recorder.beginCommand(command);
+	recorder.put(static_cast<uint32_t>(type));
+	recorder.putBlob(names, n * sizeof(GLuint));
+	recorder.endCommand();
+}
+
+static void recordUniform(GL_Trace_Uniform kind, GLint location, GLsizei count, GLboolean transpose, const void *values, size_t size)
+{
+	recorder.beginCommand(TRACE_UNIFORM);
+	recorder.put(static_cast<uint32_t>(kind));
+	recorder.put(location);
+	recorder.put(count);
+	recorder.put(transpose);
+	recorder.putBlob(values, size);
+	recorder.endCommand();
+}
+
+/* Hooked entry points: the driver's function is kept in real<Name> while glad's pointer points at trace<Name>. */
+#define GL_TRACE_HOOKS(HOOK) \
+	HOOK(ActiveTexture, ACTIVETEXTURE) HOOK(BlendEquation, BLENDEQUATION) HOOK(BlendFunc, BLENDFUNC) \
+	HOOK(ClearColor, CLEARCOLOR) HOOK(ColorMask, COLORMASK) HOOK(CullFace, CULLFACE) HOOK(DepthFunc, DEPTHFUNC) \
+	HOOK(DepthMask, DEPTHMASK) HOOK(Enable, ENABLE) HOOK(Disable, DISABLE) HOOK(DrawBuffer, DRAWBUFFER) \
+	HOOK(DrawBuffers, DRAWBUFFERS) HOOK(ReadBuffer, READBUFFER) HOOK(PixelStorei, PIXELSTOREI) \
+	HOOK(PolygonMode, POLYGONMODE) HOOK(StencilFunc, STENCILFUNC) HOOK(StencilOp, STENCILOP) \
+	HOOK(StencilOpSeparate, STENCILOPSEPARATE) HOOK(Viewport, VIEWPORT) \
+	HOOK(GenBuffers, GENBUFFERS) HOOK(GenTextures, GENTEXTURES) HOOK(GenFramebuffers, GENFRAMEBUFFERS) \
+	HOOK(GenRenderbuffers, GENRENDERBUFFERS) HOOK(GenVertexArrays, GENVERTEXARRAYS) HOOK(GenQueries, GENQUERIES) \
+	HOOK(DeleteBuffers, DELETEBUFFERS) HOOK(DeleteTextures, DELETETEXTURES) HOOK(DeleteFramebuffers, DELETEFRAMEBUFFERS) \
+	HOOK(DeleteRenderbuffers, DELETERENDERBUFFERS) HOOK(DeleteVertexArrays, DELETEVERTEXARRAYS) HOOK(DeleteQueries, DELETEQUERIES) \
+	HOOK(BindBuffer, BINDBUFFER) HOOK(BindBufferBase, BINDBUFFERBASE) HOOK(BindBufferRange, BINDBUFFERRANGE) \
+	HOOK(BindFramebuffer, BINDFRAMEBUFFER) HOOK(BindRenderbuffer, BINDRENDERBUFFER) HOOK(BindTexture, BINDTEXTURE) \
+	HOOK(BindVertexArray, BINDVERTEXARRAY) \
+	HOOK(BufferData, BUFFERDATA) HOOK(BufferSubData, BUFFERSUBDATA) HOOK(CopyBufferSubData, COPYBUFFERSUBDATA) \
+	HOOK(MapBufferRange, MAPBUFFERRANGE) HOOK(UnmapBuffer, UNMAPBUFFER) HOOK(TexBuffer, TEXBUFFER) \
+	HOOK(TexImage2D, TEXIMAGE2D) HOOK(TexImage2DMultisample, TEXIMAGE2DMULTISAMPLE) HOOK(TexImage3D, TEXIMAGE3D) \
+	HOOK(TexSubImage3D, TEXSUBIMAGE3D) \
+	HOOK(TexParameteri, TEXPARAMETERI) HOOK(TexParameterfv, TEXPARAMETERFV) HOOK(GenerateMipmap, GENERATEMIPMAP) \
+	HOOK(FramebufferRenderbuffer, FRAMEBUFFERRENDERBUFFER) HOOK(FramebufferTexture, FRAMEBUFFERTEXTURE) \
+	HOOK(FramebufferTexture2D, FRAMEBUFFERTEXTURE2D) HOOK(FramebufferTextureLayer, FRAMEBUFFERTEXTURELAYER) \
+	HOOK(RenderbufferStorage, RENDERBUFFERSTORAGE) \
+	HOOK(EnableVertexAttribArray, ENABLEVERTEXATTRIBARRAY) HOOK(VertexAttribPointer, VERTEXATTRIBPOINTER) \
+	HOOK(VertexAttribIPointer, VERTEXATTRIBIPOINTER) HOOK(VertexAttribDivisor, VERTEXATTRIBDIVISOR) \
+	HOOK(CreateShader, CREATESHADER) HOOK(ShaderSource, SHADERSOURCE) HOOK(CompileShader, COMPILESHADER) \
+	HOOK(DeleteShader, DELETESHADER) HOOK(CreateProgram, CREATEPROGRAM) HOOK(AttachShader, ATTACHSHADER) \
+	HOOK(LinkProgram, LINKPROGRAM) HOOK(DeleteProgram, DELETEPROGRAM) HOOK(UseProgram, USEPROGRAM) \
+	HOOK(GetUniformLocation, GETUNIFORMLOCATION) HOOK(GetUniformBlockIndex, GETUNIFORMBLOCKINDEX) \
+	HOOK(UniformBlockBinding, UNIFORMBLOCKBINDING) \
+	HOOK(Uniform1f, UNIFORM1F) HOOK(Uniform1fv, UNIFORM1FV) HOOK(Uniform1i, UNIFORM1I) HOOK(Uniform1ui, UNIFORM1UI) \
+	HOOK(Uniform2f, UNIFORM2F) HOOK(Uniform2fv, UNIFORM2FV) HOOK(Uniform2iv, UNIFORM2IV) HOOK(Uniform3f, UNIFORM3F) \
+	HOOK(Uniform3fv, UNIFORM3FV) HOOK(Uniform3i, UNIFORM3I) HOOK(Uniform3iv, UNIFORM3IV) HOOK(Uniform4f, UNIFORM4F) \
+	HOOK(Uniform4fv, UNIFORM4FV) HOOK(Uniform4iv, UNIFORM4IV) HOOK(UniformMatrix2fv, UNIFORMMATRIX2FV) \
+	HOOK(UniformMatrix3fv, UNIFORMMATRIX3FV) HOOK(UniformMatrix4fv, UNIFORMMATRIX4FV) \
+	HOOK(BeginQuery, BEGINQUERY) HOOK(EndQuery, ENDQUERY) HOOK(QueryCounter, QUERYCOUNTER) \
+	HOOK(GetQueryObjectiv, GETQUERYOBJECTIV) HOOK(GetQueryObjectui64v, GETQUERYOBJECTUI64V) \
+	HOOK(FenceSync, FENCESYNC) HOOK(ClientWaitSync, CLIENTWAITSYNC) HOOK(DeleteSync, DELETESYNC) \
+	HOOK(Clear, CLEAR) HOOK(DrawElementsBaseVertex, DRAWELEMENTSBASEVERTEX) \
+	HOOK(DrawElementsInstancedBaseVertex, DRAWELEMENTSINSTANCEDBASEVERTEX) \
+	HOOK(MultiDrawElementsBaseVertex, MULTIDRAWELEMENTSBASEVERTEX) HOOK(MultiDrawElementsIndirect, MULTIDRAWELEMENTSINDIRECT) \
+	HOOK(BlitFramebuffer, BLITFRAMEBUFFER) HOOK(ReadPixels, READPIXELS)
+
+#define GL_TRACE_DECLARE(name, type) static PFNGL##type##PROC real##name = nullptr;
+GL_TRACE_HOOKS(GL_TRACE_DECLARE)
+#undef GL_TRACE_DECLARE
+
+/* Fixed function state */
+
+static void APIENTRY traceActiveTexture(GLenum texture) { record(TRACE_ACTIVE_TEXTURE, texture); realActiveTexture(texture); }
+static void APIENTRY traceBlendEquation(GLenum mode) { record(TRACE_BLEND_EQUATION, mode); realBlendEquation(mode); }
+static void APIENTRY traceBlendFunc(GLenum sfactor, GLenum dfactor) { record(TRACE_BLEND_FUNC, sfactor, dfactor); realBlendFunc(sfactor, dfactor); }
+static void APIENTRY traceClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	record(TRACE_CLEAR_COLOR, red, green, blue, alpha);
+	realClearColor(red, green, blue, alpha);
+}
+static void APIENTRY traceColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
+{
+	record(TRACE_COLOR_MASK, red, green, blue, alpha);
+	realColorMask(red, green, blue, alpha);
+}
+static void APIENTRY traceCullFace(GLenum mode) { record(TRACE_CULL_FACE, mode); realCullFace(mode); }
+static void APIENTRY traceDepthFunc(GLenum func) { record(TRACE_DEPTH_FUNC, func); realDepthFunc(func); }
+static void APIENTRY traceDepthMask(GLboolean flag) { record(TRACE_DEPTH_MASK, flag); realDepthMask(flag); }
+static void APIENTRY traceEnable(GLenum cap) { record(TRACE_ENABLE, cap); realEnable(cap); }
+static void APIENTRY traceDisable(GLenum cap) { record(TRACE_DISABLE, cap); realDisable(cap); }
+static void APIENTRY traceDrawBuffer(GLenum buf) { record(TRACE_DRAW_BUFFER, buf); realDrawBuffer(buf); }
+static void APIENTRY traceDrawBuffers(GLsizei n, const GLenum *bufs)
+{
+	recorder.beginCommand(TRACE_DRAW_BUFFERS);
+	recorder.putBlob(bufs, n * sizeof(GLenum));
+	recorder.endCommand();
+	realDrawBuffers(n, bufs);
+}
+static void APIENTRY traceReadBuffer(GLenum src) { record(TRACE_READ_BUFFER, src); realReadBuffer(src); }
+static void APIENTRY tracePixelStorei(GLenum pname, GLint param)
+{
+	switch (pname) {
+	case GL_PACK_ALIGNMENT: packAlignment = param; break;
+	case GL_UNPACK_ALIGNMENT: unpackAlignment = param; break;
+	case GL_PACK_ROW_LENGTH: packRowLength = param; break;
+	case GL_UNPACK_ROW_LENGTH: unpackRowLength = param; break;
+	}
+	record(TRACE_PIXEL_STORE, pname, param);
+	realPixelStorei(pname, param);
+}
+static void APIENTRY tracePolygonMode(GLenum face, GLenum mode) { record(TRACE_POLYGON_MODE, face, mode); realPolygonMode(face, mode); }
+static void APIENTRY traceStencilFunc(GLenum func, GLint ref, GLuint mask) { record(TRACE_STENCIL_FUNC, func, ref, mask); realStencilFunc(func, ref, mask); }
+static void APIENTRY traceStencilOp(GLenum fail, GLenum zfail, GLenum zpass) { record(TRACE_STENCIL_OP, fail, zfail, zpass); realStencilOp(fail, zfail, zpass); }
+static void APIENTRY traceStencilOpSeparate(GLenum face, GLenum sfail, GLenum dpfail, GLenum dppass)
+{
+	record(TRACE_STENCIL_OP_SEPARATE, face, sfail, dpfail, dppass);
+	realStencilOpSeparate(face, sfail, dpfail, dppass);
+}
+static void APIENTRY traceViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	record(TRACE_VIEWPORT, x, y, width, height);
+	realViewport(x, y, width, height);
+}
+
+/* Object names, recorded after the call so the generated names are known. */
+
+static void APIENTRY traceGenBuffers(GLsizei n, GLuint *names) { realGenBuffers(n, names); recordNames(TRACE_GEN_NAMES, TRACE_BUFFER, n, names); }
+static void APIENTRY traceGenTextures(GLsizei n, GLuint *names) { realGenTextures(n, names); recordNames(TRACE_GEN_NAMES, TRACE_TEXTURE, n, names); }
+static void APIENTRY traceGenFramebuffers(GLsizei n, GLuint *names) { realGenFramebuffers(n, names); recordNames(TRACE_GEN_NAMES, TRACE_FRAMEBUFFER, n, names); }
+static void APIENTRY traceGenRenderbuffers(GLsizei n, GLuint *names) { realGenRenderbuffers(n, names); recordNames(TRACE_GEN_NAMES, TRACE_RENDERBUFFER, n, names); }
+static void APIENTRY traceGenVertexArrays(GLsizei n, GLuint *names) { realGenVertexArrays(n, names); recordNames(TRACE_GEN_NAMES, TRACE_VERTEX_ARRAY, n, names); }
+static void APIENTRY traceGenQueries(GLsizei n, GLuint *names) { realGenQueries(n, names); recordNames(TRACE_GEN_NAMES, TRACE_QUERY, n, names); }
+static void APIENTRY traceDeleteBuffers(GLsizei n, const GLuint *names) { recordNames(TRACE_DELETE_NAMES, TRACE_BUFFER, n, names); realDeleteBuffers(n, names); }
+static void APIENTRY traceDeleteTextures(GLsizei n, const GLuint *names) { recordNames(TRACE_DELETE_NAMES, TRACE_TEXTURE, n, names); realDeleteTextures(n, names); }
+static void APIENTRY traceDeleteFramebuffers(GLsizei n, const GLuint *names) { recordNames(TRACE_DELETE_NAMES, TRACE_FRAMEBUFFER, n, names); realDeleteFramebuffers(n, names); }
+static void APIENTRY traceDeleteRenderbuffers(GLsizei n, const GLuint *names) { recordNames(TRACE_DELETE_NAMES, TRACE_RENDERBUFFER, n, names); realDeleteRenderbuffers(n, names); }
+static void APIENTRY traceDeleteVertexArrays(GLsizei n, const GLuint *names) { recordNames(TRACE_DELETE_NAMES, TRACE_VERTEX_ARRAY, n, names); realDeleteVertexArrays(n, names); }
+static void APIENTRY traceDeleteQueries(GLsizei n, const GLuint *names) { recordNames(TRACE_DELETE_NAMES, TRACE_QUERY, n, names); realDeleteQueries(n, names); }
+
+static void APIENTRY traceBindBuffer(GLenum target, GLuint buffer)
+{
+	if (target == GL_PIXEL_PACK_BUFFER) {
+		packBuffer = buffer;
+	}
+	else if (target == GL_PIXEL_UNPACK_BUFFER) {
+		unpackBuffer = buffer;
+	}
+	record(TRACE_BIND_BUFFER, target, buffer);
+	realBindBuffer(target, buffer);
+}
+static void APIENTRY traceBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	record(TRACE_BIND_BUFFER_BASE, target, index, buffer);
+	realBindBufferBase(target, index, buffer);
+}
+static void APIENTRY traceBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	record(TRACE_BIND_BUFFER_RANGE, target, index, buffer, offset, size);
+	realBindBufferRange(target, index, buffer, offset, size);
+}
+static void APIENTRY traceBindFramebuffer(GLenum target, GLuint framebuffer) { record(TRACE_BIND_FRAMEBUFFER, target, framebuffer); realBindFramebuffer(target, framebuffer); }
+static void APIENTRY traceBindRenderbuffer(GLenum target, GLuint renderbuffer) { record(TRACE_BIND_RENDERBUFFER, target, renderbuffer); realBindRenderbuffer(target, renderbuffer); }
+static void APIENTRY traceBindTexture(GLenum target, GLuint texture) { record(TRACE_BIND_TEXTURE, target, texture); realBindTexture(target, texture); }
+static void APIENTRY traceBindVertexArray(GLuint array) { record(TRACE_BIND_VERTEX_ARRAY, array); realBindVertexArray(array); }
+
+/* Buffers */
+
+static void APIENTRY traceBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage)
+{
+	recorder.beginCommand(TRACE_BUFFER_DATA);
+	recorder.put(target);
+	recorder.put(size);
+	recorder.put(usage);
+	recorder.putBlob(data, data ? size : 0);
+	recorder.endCommand();
+	realBufferData(target, size, data, usage);
+}
+static void APIENTRY traceBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data)
+{
+	recorder.beginCommand(TRACE_BUFFER_SUB_DATA);
+	recorder.put(target);
+	recorder.put(offset);
+	recorder.putBlob(data, size);
+	recorder.endCommand();
+	realBufferSubData(target, offset, size, data);
+}
+static void APIENTRY traceCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+	record(TRACE_COPY_BUFFER_SUB_DATA, readTarget, writeTarget, readOffset, writeOffset, size);
+	realCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+}
+static void* APIENTRY traceMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	record(TRACE_MAP_BUFFER_RANGE, target, offset, length, access);
+	void *pointer = realMapBufferRange(target, offset, length, access);
+	mappedRanges[target] = MappedRange{ pointer, length, access };
+	return pointer;
+}
+static GLboolean APIENTRY traceUnmapBuffer(GLenum target)
+{
+	/* Whatever the application wrote through the mapping is only known now. */
+	MappedRange range = { nullptr, 0, 0 };
+	auto found = mappedRanges.find(target);
+	if (found != mappedRanges.end()) {
+		range = found->second;
+		mappedRanges.erase(found);
+	}
+	bool written = range.pointer && (range.access & GL_MAP_WRITE_BIT);
+	recorder.beginCommand(TRACE_UNMAP_BUFFER);
+	recorder.put(target);
+	recorder.putBlob(range.pointer, written ? range.length : 0);
+	recorder.endCommand();
+	return realUnmapBuffer(target);
+}
+static void APIENTRY traceTexBuffer(GLenum target, GLenum internalformat, GLuint buffer)
+{
+	record(TRACE_TEX_BUFFER, target, internalformat, buffer);
+	realTexBuffer(target, internalformat, buffer);
+}
+
+/* Textures and framebuffers. Pixels come either from client memory, recorded as a blob, or from the bound unpack
+ * buffer, recorded as the offset. */
+
+static void putPixels(const void *pixels, int width, int height, int depth, GLenum format, GLenum type)
+{
+	if (unpackBuffer != 0) {
+		recorder.put(static_cast<uint8_t>(1));
+		recorder.put(reinterpret_cast<uint64_t>(pixels));
+	}
+	else {
+		recorder.put(static_cast<uint8_t>(0));
+		recorder.putBlob(pixels, pixels ? GLStats::imageSize(width, height, depth, format, type, unpackAlignment, unpackRowLength) : 0);
+	}
+}
+static void APIENTRY traceTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+	GLenum format, GLenum type, const void *pixels)
+{
+	recorder.beginCommand(TRACE_TEX_IMAGE_2D);
+	recorder.put(target);
+	recorder.put(level);
+	recorder.put(internalformat);
+	recorder.put(width);
+	recorder.put(height);
+	recorder.put(border);
+	recorder.put(format);
+	recorder.put(type);
+	putPixels(pixels, width, height, 1, format, type);
+	recorder.endCommand();
+	realTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+static void APIENTRY traceTexImage2DMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height,
+	GLboolean fixedsamplelocations)
+{
+	record(TRACE_TEX_IMAGE_2D_MULTISAMPLE, target, samples, internalformat, width, height, fixedsamplelocations);
+	realTexImage2DMultisample(target, samples, internalformat, width, height, fixedsamplelocations);
+}
+static void APIENTRY traceTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth,
+	GLint border, GLenum format, GLenum type, const void *pixels)
+{
+	recorder.beginCommand(TRACE_TEX_IMAGE_3D);
+	recorder.put(target);
+	recorder.put(level);
+	recorder.put(internalformat);
+	recorder.put(width);
+	recorder.put(height);
+	recorder.put(depth);
+	recorder.put(border);
+	recorder.put(format);
+	recorder.put(type);
+	putPixels(pixels, width, height, depth, format, type);
+	recorder.endCommand();
+	realTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+}
+static void APIENTRY traceTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width,
+	GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
+{
+	recorder.beginCommand(TRACE_TEX_SUB_IMAGE_3D);
+	recorder.put(target);
+	recorder.put(level);
+	recorder.put(xoffset);
+	recorder.put(yoffset);
+	recorder.put(zoffset);
+	recorder.put(width);
+	recorder.put(height);
+	recorder.put(depth);
+	recorder.put(format);
+	recorder.put(type);
+	putPixels(pixels, width, height, depth, format, type);
+	recorder.endCommand();
+	realTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+}
+static void APIENTRY traceTexParameteri(GLenum target, GLenum pname, GLint param) { record(TRACE_TEX_PARAMETER_I, target, pname, param); realTexParameteri(target, pname, param); }
+static void APIENTRY traceTexParameterfv(GLenum target, GLenum pname, const GLfloat *params)
+{
+	recorder.beginCommand(TRACE_TEX_PARAMETER_FV);
+	recorder.put(target);
+	recorder.put(pname);
+	recorder.putBlob(params, (pname == GL_TEXTURE_BORDER_COLOR ? 4 : 1) * sizeof(GLfloat));
+	recorder.endCommand();
+	realTexParameterfv(target, pname, params);
+}
+static void APIENTRY traceGenerateMipmap(GLenum target) { record(TRACE_GENERATE_MIPMAP, target); realGenerateMipmap(target); }
+static void APIENTRY traceFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
+{
+	record(TRACE_FRAMEBUFFER_RENDERBUFFER, target, attachment, renderbuffertarget, renderbuffer);
+	realFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+}
+static void APIENTRY traceFramebufferTexture(GLenum target, GLenum attachment, GLuint texture, GLint level)
+{
+	record(TRACE_FRAMEBUFFER_TEXTURE, target, attachment, texture, level);
+	realFramebufferTexture(target, attachment, texture, level);
+}
+static void APIENTRY traceFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
+{
+	record(TRACE_FRAMEBUFFER_TEXTURE_2D, target, attachment, textarget, texture, level);
+	realFramebufferTexture2D(target, attachment, textarget, texture, level);
+}
+static void APIENTRY traceFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer)
+{
+	record(TRACE_FRAMEBUFFER_TEXTURE_LAYER, target, attachment, texture, level, layer);
+	realFramebufferTextureLayer(target, attachment, texture, level, layer);
+}
+static void APIENTRY traceRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+{
+	record(TRACE_RENDERBUFFER_STORAGE, target, internalformat, width, height);
+	realRenderbufferStorage(target, internalformat, width, height);
+}
+
+/* Vertex arrays, attribute pointers are always offsets into the bound array buffer. */
+
+static void APIENTRY traceEnableVertexAttribArray(GLuint index) { record(TRACE_ENABLE_VERTEX_ATTRIB_ARRAY, index); realEnableVertexAttribArray(index); }
+static void APIENTRY traceVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer)
+{
+	record(TRACE_VERTEX_ATTRIB_POINTER, index, size, type, normalized, stride, reinterpret_cast<uint64_t>(pointer));
+	realVertexAttribPointer(index, size, type, normalized, stride, pointer);
+}
+static void APIENTRY traceVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer)
+{
+	record(TRACE_VERTEX_ATTRIB_I_POINTER, index, size, type, stride, reinterpret_cast<uint64_t>(pointer));
+	realVertexAttribIPointer(index, size, type, stride, pointer);
+}
+static void APIENTRY traceVertexAttribDivisor(GLuint index, GLuint divisor) { record(TRACE_VERTEX_ATTRIB_DIVISOR, index, divisor); realVertexAttribDivisor(index, divisor); }
+
+/* Programs */
+
+static GLuint APIENTRY traceCreateShader(GLenum type)
+{
+	GLuint shader = realCreateShader(type);
+	record(TRACE_CREATE_SHADER, type, shader);
+	return shader;
+}
+static void APIENTRY traceShaderSource(GLuint shader, GLsizei count, const GLchar *const *strings, const GLint *lengths)
+{
+	/* The pieces are joined, the replay passes them as one string. */
+	string source;
+	for (GLsizei i = 0; i < count; i++) {
+		if (lengths && lengths[i] >= 0) {
+			source.append(strings[i], lengths[i]);
+		}
+		else {
+			source.append(strings[i]);
+		}
+	}
+	recorder.beginCommand(TRACE_SHADER_SOURCE);
+	recorder.put(shader);
+	recorder.putBlob(source.data(), source.size());
+	recorder.endCommand();
+	realShaderSource(shader, count, strings, lengths);
+}
+static void APIENTRY traceCompileShader(GLuint shader) { record(TRACE_COMPILE_SHADER, shader); realCompileShader(shader); }
+static void APIENTRY traceDeleteShader(GLuint shader) { record(TRACE_DELETE_SHADER, shader); realDeleteShader(shader); }
+static GLuint APIENTRY traceCreateProgram()
+{
+	GLuint program = realCreateProgram();
+	record(TRACE_CREATE_PROGRAM, program);
+	return program;
+}
+static void APIENTRY traceAttachShader(GLuint program, GLuint shader) { record(TRACE_ATTACH_SHADER, program, shader); realAttachShader(program, shader); }
+static void APIENTRY traceLinkProgram(GLuint program) { record(TRACE_LINK_PROGRAM, program); realLinkProgram(program); }
+static void APIENTRY traceDeleteProgram(GLuint program) { record(TRACE_DELETE_PROGRAM, program); realDeleteProgram(program); }
+static void APIENTRY traceUseProgram(GLuint program) { record(TRACE_USE_PROGRAM, program); realUseProgram(program); }
+static GLint APIENTRY traceGetUniformLocation(GLuint program, const GLchar *name)
+{
+	GLint location = realGetUniformLocation(program, name);
+	recorder.beginCommand(TRACE_GET_UNIFORM_LOCATION);
+	recorder.put(program);
+	recorder.put(location);
+	recorder.putString(name);
+	recorder.endCommand();
+	return location;
+}
+static GLuint APIENTRY traceGetUniformBlockIndex(GLuint program, const GLchar *name)
+{
+	GLuint index = realGetUniformBlockIndex(program, name);
+	recorder.beginCommand(TRACE_GET_UNIFORM_BLOCK_INDEX);
+	recorder.put(program);
+	recorder.put(index);
+	recorder.putString(name);
+	recorder.endCommand();
+	return index;
+}
+static void APIENTRY traceUniformBlockBinding(GLuint program, GLuint index, GLuint binding)
+{
+	record(TRACE_UNIFORM_BLOCK_BINDING, program, index, binding);
+	realUniformBlockBinding(program, index, binding);
+}
+
+static void APIENTRY traceUniform1f(GLint location, GLfloat v0)
+{
+	recordUniform(TRACE_UNIFORM_1FV, location, 1, GL_FALSE, &v0, sizeof(GLfloat));
+	realUniform1f(location, v0);
+}
+static void APIENTRY traceUniform1fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_1FV, location, count, GL_FALSE, value, count * sizeof(GLfloat));
+	realUniform1fv(location, count, value);
+}
+static void APIENTRY traceUniform1i(GLint location, GLint v0)
+{
+	recordUniform(TRACE_UNIFORM_1IV, location, 1, GL_FALSE, &v0, sizeof(GLint));
+	realUniform1i(location, v0);
+}
+static void APIENTRY traceUniform1ui(GLint location, GLuint v0)
+{
+	recordUniform(TRACE_UNIFORM_1UIV, location, 1, GL_FALSE, &v0, sizeof(GLuint));
+	realUniform1ui(location, v0);
+}
+static void APIENTRY traceUniform2f(GLint location, GLfloat v0, GLfloat v1)
+{
+	GLfloat values[] = { v0, v1 };
+	recordUniform(TRACE_UNIFORM_2FV, location, 1, GL_FALSE, values, sizeof(values));
+	realUniform2f(location, v0, v1);
+}
+static void APIENTRY traceUniform2fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_2FV, location, count, GL_FALSE, value, count * 2 * sizeof(GLfloat));
+	realUniform2fv(location, count, value);
+}
+static void APIENTRY traceUniform2iv(GLint location, GLsizei count, const GLint *value)
+{
+	recordUniform(TRACE_UNIFORM_2IV, location, count, GL_FALSE, value, count * 2 * sizeof(GLint));
+	realUniform2iv(location, count, value);
+}
+static void APIENTRY traceUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	GLfloat values[] = { v0, v1, v2 };
+	recordUniform(TRACE_UNIFORM_3FV, location, 1, GL_FALSE, values, sizeof(values));
+	realUniform3f(location, v0, v1, v2);
+}
+static void APIENTRY traceUniform3fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_3FV, location, count, GL_FALSE, value, count * 3 * sizeof(GLfloat));
+	realUniform3fv(location, count, value);
+}
+static void APIENTRY traceUniform3i(GLint location, GLint v0, GLint v1, GLint v2)
+{
+	GLint values[] = { v0, v1, v2 };
+	recordUniform(TRACE_UNIFORM_3IV, location, 1, GL_FALSE, values, sizeof(values));
+	realUniform3i(location, v0, v1, v2);
+}
+static void APIENTRY traceUniform3iv(GLint location, GLsizei count, const GLint *value)
+{
+	recordUniform(TRACE_UNIFORM_3IV, location, count, GL_FALSE, value, count * 3 * sizeof(GLint));
+	realUniform3iv(location, count, value);
+}
+static void APIENTRY traceUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+	GLfloat values[] = { v0, v1, v2, v3 };
+	recordUniform(TRACE_UNIFORM_4FV, location, 1, GL_FALSE, values, sizeof(values));
+	realUniform4f(location, v0, v1, v2, v3);
+}
+static void APIENTRY traceUniform4fv(GLint location, GLsizei count, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_4FV, location, count, GL_FALSE, value, count * 4 * sizeof(GLfloat));
+	realUniform4fv(location, count, value);
+}
+static void APIENTRY traceUniform4iv(GLint location, GLsizei count, const GLint *value)
+{
+	recordUniform(TRACE_UNIFORM_4IV, location, count, GL_FALSE, value, count * 4 * sizeof(GLint));
+	realUniform4iv(location, count, value);
+}
+static void APIENTRY traceUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_MATRIX_2FV, location, count, transpose, value, count * 4 * sizeof(GLfloat));
+	realUniformMatrix2fv(location, count, transpose, value);
+}
+static void APIENTRY traceUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_MATRIX_3FV, location, count, transpose, value, count * 9 * sizeof(GLfloat));
+	realUniformMatrix3fv(location, count, transpose, value);
+}
+static void APIENTRY traceUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
+{
+	recordUniform(TRACE_UNIFORM_MATRIX_4FV, location, count, transpose, value, count * 16 * sizeof(GLfloat));
+	realUniformMatrix4fv(location, count, transpose, value);
+}
+
+/* Queries and syncs. Reading a result or waiting on a fence is kept like output: outside the captured frames it
+ * only costs replay time. Syncs are recorded by their pointer value. */
+
+static void APIENTRY traceBeginQuery(GLenum target, GLuint id) { record(TRACE_BEGIN_QUERY, target, id); realBeginQuery(target, id); }
+static void APIENTRY traceEndQuery(GLenum target) { record(TRACE_END_QUERY, target); realEndQuery(target); }
+static void APIENTRY traceQueryCounter(GLuint id, GLenum target) { record(TRACE_QUERY_COUNTER, id, target); realQueryCounter(id, target); }
+static void APIENTRY traceGetQueryObjectiv(GLuint id, GLenum pname, GLint *params)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_GET_QUERY_OBJECT, id, pname, static_cast<uint8_t>(0));
+	}
+	realGetQueryObjectiv(id, pname, params);
+}
+static void APIENTRY traceGetQueryObjectui64v(GLuint id, GLenum pname, GLuint64 *params)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_GET_QUERY_OBJECT, id, pname, static_cast<uint8_t>(1));
+	}
+	realGetQueryObjectui64v(id, pname, params);
+}
+static GLsync APIENTRY traceFenceSync(GLenum condition, GLbitfield flags)
+{
+	GLsync sync = realFenceSync(condition, flags);
+	record(TRACE_FENCE_SYNC, condition, flags, reinterpret_cast<uint64_t>(sync));
+	return sync;
+}
+static GLenum APIENTRY traceClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_CLIENT_WAIT_SYNC, reinterpret_cast<uint64_t>(sync), flags, timeout);
+	}
+	return realClientWaitSync(sync, flags, timeout);
+}
+static void APIENTRY traceDeleteSync(GLsync sync) { record(TRACE_DELETE_SYNC, reinterpret_cast<uint64_t>(sync)); realDeleteSync(sync); }
+
+/* Output */
+
+static void APIENTRY traceClear(GLbitfield mask)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_CLEAR, mask);
+	}
+	realClear(mask);
+}
+static void APIENTRY traceDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLint basevertex)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_DRAW_ELEMENTS_BASE_VERTEX, mode, count, type, reinterpret_cast<uint64_t>(indices), basevertex);
+	}
+	realDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+}
+static void APIENTRY traceDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount, GLint basevertex)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_DRAW_ELEMENTS_INSTANCED_BASE_VERTEX, mode, count, type, reinterpret_cast<uint64_t>(indices), instancecount, basevertex);
+	}
+	realDrawElementsInstancedBaseVertex(mode, count, type, indices, instancecount, basevertex);
+}
+static void APIENTRY traceMultiDrawElementsBaseVertex(GLenum mode, const GLsizei *count, GLenum type, const void *const *indices, GLsizei drawcount, const GLint *basevertex)
+{
+	if (recorder.keepOutput()) {
+		vector<uint64_t> offsets(drawcount);
+		for (GLsizei i = 0; i < drawcount; i++) {
+			offsets[i] = reinterpret_cast<uint64_t>(indices[i]);
+		}
+		recorder.beginCommand(TRACE_MULTI_DRAW_ELEMENTS_BASE_VERTEX);
+		recorder.put(mode);
+		recorder.put(type);
+		recorder.putBlob(count, drawcount * sizeof(GLsizei));
+		recorder.putBlob(offsets.data(), drawcount * sizeof(uint64_t));
+		recorder.putBlob(basevertex, drawcount * sizeof(GLint));
+		recorder.endCommand();
+	}
+	realMultiDrawElementsBaseVertex(mode, count, type, indices, drawcount, basevertex);
+}
+static void APIENTRY traceMultiDrawElementsIndirect(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_MULTI_DRAW_ELEMENTS_INDIRECT, mode, type, reinterpret_cast<uint64_t>(indirect), drawcount, stride);
+	}
+	realMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+}
+static void APIENTRY traceBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1,
+	GLbitfield mask, GLenum filter)
+{
+	if (recorder.keepOutput()) {
+		record(TRACE_BLIT_FRAMEBUFFER, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	}
+	realBlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+}
+static void APIENTRY traceReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, void *pixels)
+{
+	if (recorder.keepOutput()) {
+		/* Into the pack buffer the offset is replayed, into client memory a scratch buffer of the same size is used. */
+		uint64_t target = packBuffer != 0 ? reinterpret_cast<uint64_t>(pixels) : GLStats::imageSize(width, height, 1, format, type, packAlignment, packRowLength);
+		record(TRACE_READ_PIXELS, x, y, width, height, format, type, static_cast<uint8_t>(packBuffer != 0), target);
+	}
+	realReadPixels(x, y, width, height, format, type, pixels);
+}
+
+GLTraceRecorder& GLTraceRecorder::get()
+{
+	static GLTraceRecorder traceRecorder;
+	return traceRecorder;
+}
+
+bool GLTraceRecorder::start(const string &path, int firstFrame, int frameCount, int width, int height)
+{
+	if (recording) {
+		return false;
+	}
+	file.open(path, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::GL_TRACE::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	GLTraceHeader header = { GL_TRACE_MAGIC, GL_TRACE_VERSION, width, height };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	this->firstFrame = firstFrame;
+	this->frameCount = frameCount > 0 ? frameCount : 1;
+	frame = 0;
+	inFrames = false;
+	recording = true;
+
+#define GL_TRACE_INSTALL(name, type) real##name = glad_gl##name; glad_gl##name = trace##name;
+	GL_TRACE_HOOKS(GL_TRACE_INSTALL)
+#undef GL_TRACE_INSTALL
+	return true;
+}
+
+void GLTraceRecorder::beginFrame()
+{
+	if (!recording) {
+		return;
+	}
+	inFrames = true;
+	if (frame == firstFrame) {
+		record(TRACE_CAPTURE_BEGIN);
+	}
+}
+
+void GLTraceRecorder::endFrame()
+{
+	if (!recording) {
+		return;
+	}
+	if (frame >= firstFrame) {
+		record(TRACE_FRAME_END);
+	}
+	frame++;
+	if (frame >= firstFrame + frameCount) {
+		stop();
+	}
+}
+
+void GLTraceRecorder::stop()
+{
+	if (!recording) {
+		return;
+	}
+#define GL_TRACE_REMOVE(name, type) glad_gl##name = real##name;
+	GL_TRACE_HOOKS(GL_TRACE_REMOVE)
+#undef GL_TRACE_REMOVE
+	recording = false;
+	file.close();
+	if (frame < firstFrame + frameCount) {
+		std::cout << "ERROR::GL_TRACE::INCOMPLETE: stopped after " << frame << " frames, " << firstFrame + frameCount << " were asked for" << std::endl;
+	}
+}
+
+void GLTraceRecorder::beginCommand(GL_Trace_Command commandType)
+{
+	command.clear();
+	put(static_cast<uint32_t>(commandType));
+	put(static_cast<uint32_t>(0));
+}
+
+void GLTraceRecorder::putBlob(const void *data, size_t size)
+{
+	put(static_cast<uint64_t>(size));
+	/* Commands start 8 byte aligned, so aligning within the command aligns in the file. */
+	command.resize((command.size() + 7) & ~size_t(7));
+	if (size > 0) {
+		const unsigned char *bytes = static_cast<const unsigned char*>(data);
+		command.insert(command.end(), bytes, bytes + size);
+	}
+}
+
+void GLTraceRecorder::endCommand()
+{
+	command.resize((command.size() + 7) & ~size_t(7));
+	uint32_t size = static_cast<uint32_t>(command.size() - 2 * sizeof(uint32_t));
+	std::memcpy(command.data() + sizeof(uint32_t), &size, sizeof(size));
+	file.write(reinterpret_cast<const char*>(command.data()), command.size());
+}
+
+/* Decodes the arguments of one command, in the order the hooks put them. */
+struct TraceReader {
+	const unsigned char *position;
+
+	template <typename T>
+	T get()
+	{
+		T value;
+		std::memcpy(&value, position, sizeof(T));
+		position += sizeof(T);
+		return value;
+	}
+
+	const void* blob(uint64_t &size)
+	{
+		size = get<uint64_t>();
+		position = reinterpret_cast<const unsigned char*>((reinterpret_cast<uintptr_t>(position) + 7) & ~uintptr_t(7));
+		const void *data = position;
+		position += size;
+		return size > 0 ? data : nullptr;
+	}
+
+	const void* blob()
+	{
+		uint64_t size;
+		return blob(size);
+	}
+};
+
+static const void* offsetPointer(uint64_t offset)
+{
+	return reinterpret_cast<const void*>(static_cast<uintptr_t>(offset));
+}
+
+GLTraceReplayer::GLTraceReplayer() : byteSize(0), captureOffset(0), frames(0), header(), drawDefault(true), readDefault(true), currentProgram(0)
+{
+}
+
+bool GLTraceReplayer::load(const string &path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		std::cout << "ERROR::GL_TRACE::FILE_NOT_FOUND: " << path << std::endl;
+		return false;
+	}
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	file.seekg(0);
+	if (fileSize < sizeof(GLTraceHeader) || !file.read(reinterpret_cast<char*>(&header), sizeof(header))
+		|| header.magic != GL_TRACE_MAGIC || header.version != GL_TRACE_VERSION) {
+		std::cout << "ERROR::GL_TRACE::NOT_A_TRACE: " << path << std::endl;
+		return false;
+	}
+	byteSize = fileSize - sizeof(GLTraceHeader);
+	words.assign((byteSize + 7) / 8, 0);
+	file.read(reinterpret_cast<char*>(words.data()), byteSize);
+
+	/* Find where the captured frames start and count them. */
+	captureOffset = byteSize;
+	frames = 0;
+	size_t offset = 0;
+	while (offset + 2 * sizeof(uint32_t) <= byteSize) {
+		uint32_t command, size;
+		std::memcpy(&command, bytes() + offset, sizeof(command));
+		std::memcpy(&size, bytes() + offset + sizeof(command), sizeof(size));
+		if (command == TRACE_CAPTURE_BEGIN && captureOffset == byteSize) {
+			captureOffset = offset;
+		}
+		else if (command == TRACE_FRAME_END) {
+			frames++;
+		}
+		offset += 2 * sizeof(uint32_t) + size;
+	}
+	if (captureOffset == byteSize || frames == 0) {
+		std::cout << "ERROR::GL_TRACE::NO_CAPTURED_FRAMES: " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+unsigned int GLTraceReplayer::translate(GL_Trace_Object type, unsigned int name) const
+{
+	/* Names the trace never created are not passed on, they could be some other object of the replay. */
+	auto found = names[type].find(name);
+	return found != names[type].end() ? found->second : 0;
+}
+
+int GLTraceReplayer::translateLocation(int location) const
+{
+	auto program = uniformLocations.find(currentProgram);
+	if (location < 0 || program == uniformLocations.end()) {
+		return location;
+	}
+	auto found = program->second.find(location);
+	return found != program->second.end() ? found->second : location;
+}
+
+GLenum GLTraceReplayer::translateBuffer(GLenum buffer, bool draw) const
+{
+	/* The window's buffers are the offscreen target's only color attachment. */
+	bool isDefault = draw ? drawDefault : readDefault;
+	if (isDefault && (buffer == GL_BACK || buffer == GL_FRONT || buffer == GL_BACK_LEFT || buffer == GL_FRONT_LEFT)) {
+		return GL_COLOR_ATTACHMENT0;
+	}
+	return buffer;
+}
+
+void GLTraceReplayer::run(Benchmark &benchmark, int loops)
+{
+	defaultTarget.create(header.width, header.height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glViewport(0, 0, header.width, header.height);
+	drawDefault = readDefault = true;
+
+	execute(0, captureOffset, nullptr);
+	for (int i = 0; i < loops; i++) {
+		execute(captureOffset, byteSize, &benchmark);
+	}
+	glFinish();
+}
+
+void GLTraceReplayer::execute(size_t begin, size_t end, Benchmark *benchmark)
+{
+	bool frameOpen = false;
+	size_t offset = begin;
+	while (offset + 2 * sizeof(uint32_t) <= end) {
+		uint32_t command, size;
+		std::memcpy(&command, bytes() + offset, sizeof(command));
+		std::memcpy(&size, bytes() + offset + sizeof(command), sizeof(size));
+		TraceReader in = { bytes() + offset + 2 * sizeof(uint32_t) };
+		offset += 2 * sizeof(uint32_t) + size;
+
+		if (benchmark && !frameOpen && command != TRACE_FRAME_END) {
+			benchmark->beginFrame();
+			benchmark->beginPass("replay");
+			frameOpen = true;
+		}
+
+		switch (command) {
+		case TRACE_CAPTURE_BEGIN:
+			break;
+		case TRACE_FRAME_END:
+			if (benchmark && frameOpen) {
+				benchmark->endPass();
+				benchmark->endFrame();
+				frameOpen = false;
+			}
+			break;
+
+		case TRACE_ACTIVE_TEXTURE: glActiveTexture(in.get<GLenum>()); break;
+		case TRACE_BLEND_EQUATION: glBlendEquation(in.get<GLenum>()); break;
+		case TRACE_BLEND_FUNC: {
+			GLenum sfactor = in.get<GLenum>();
+			glBlendFunc(sfactor, in.get<GLenum>());
+			break;
+		}
+		case TRACE_CLEAR_COLOR: {
+			GLfloat color[4];
+			for (GLfloat &c : color) {
+				c = in.get<GLfloat>();
+			}
+			glClearColor(color[0], color[1], color[2], color[3]);
+			break;
+		}
+		case TRACE_COLOR_MASK: {
+			GLboolean mask[4];
+			for (GLboolean &m : mask) {
+				m = in.get<GLboolean>();
+			}
+			glColorMask(mask[0], mask[1], mask[2], mask[3]);
+			break;
+		}
+		case TRACE_CULL_FACE: glCullFace(in.get<GLenum>()); break;
+		case TRACE_DEPTH_FUNC: glDepthFunc(in.get<GLenum>()); break;
+		case TRACE_DEPTH_MASK: glDepthMask(in.get<GLboolean>()); break;
+		case TRACE_ENABLE: glEnable(in.get<GLenum>()); break;
+		case TRACE_DISABLE: glDisable(in.get<GLenum>()); break;
+		case TRACE_DRAW_BUFFER: glDrawBuffer(translateBuffer(in.get<GLenum>(), true)); break;
+		case TRACE_DRAW_BUFFERS: {
+			uint64_t bufferSize;
+			const GLenum *buffers = static_cast<const GLenum*>(in.blob(bufferSize));
+			vector<GLenum> translated(buffers, buffers + bufferSize / sizeof(GLenum));
+			for (GLenum &buffer : translated) {
+				buffer = translateBuffer(buffer, true);
+			}
+			glDrawBuffers(static_cast<GLsizei>(translated.size()), translated.data());
+			break;
+		}
+		case TRACE_READ_BUFFER: glReadBuffer(translateBuffer(in.get<GLenum>(), false)); break;
+		case TRACE_PIXEL_STORE: {
+			GLenum pname = in.get<GLenum>();
+			glPixelStorei(pname, in.get<GLint>());
+			break;
+		}
+		case TRACE_POLYGON_MODE: {
+			GLenum face = in.get<GLenum>();
+			glPolygonMode(face, in.get<GLenum>());
+			break;
+		}
+		case TRACE_STENCIL_FUNC: {
+			GLenum func = in.get<GLenum>();
+			GLint ref = in.get<GLint>();
+			glStencilFunc(func, ref, in.get<GLuint>());
+			break;
+		}
+		case TRACE_STENCIL_OP: {
+			GLenum fail = in.get<GLenum>();
+			GLenum zfail = in.get<GLenum>();
+			glStencilOp(fail, zfail, in.get<GLenum>());
+			break;
+		}
+		case TRACE_STENCIL_OP_SEPARATE: {
+			GLenum face = in.get<GLenum>();
+			GLenum sfail = in.get<GLenum>();
+			GLenum dpfail = in.get<GLenum>();
+			glStencilOpSeparate(face, sfail, dpfail, in.get<GLenum>());
+			break;
+		}
+		case TRACE_VIEWPORT: {
+			GLint x = in.get<GLint>();
+			GLint y = in.get<GLint>();
+			GLsizei width = in.get<GLsizei>();
+			glViewport(x, y, width, in.get<GLsizei>());
+			break;
+		}
+
+		case TRACE_GEN_NAMES:
+		case TRACE_DELETE_NAMES: {
+			GL_Trace_Object type = static_cast<GL_Trace_Object>(in.get<uint32_t>());
+			uint64_t nameSize;
+			const GLuint *recorded = static_cast<const GLuint*>(in.blob(nameSize));
+			GLsizei n = static_cast<GLsizei>(nameSize / sizeof(GLuint));
+			vector<GLuint> replayed(n);
+			if (command == TRACE_DELETE_NAMES) {
+				for (GLsizei i = 0; i < n; i++) {
+					replayed[i] = translate(type, recorded[i]);
+					names[type].erase(recorded[i]);
+				}
+			}
+			switch (type) {
+			case TRACE_BUFFER: command == TRACE_GEN_NAMES ? glGenBuffers(n, replayed.data()) : glDeleteBuffers(n, replayed.data()); break;
+			case TRACE_TEXTURE: command == TRACE_GEN_NAMES ? glGenTextures(n, replayed.data()) : glDeleteTextures(n, replayed.data()); break;
+			case TRACE_FRAMEBUFFER: command == TRACE_GEN_NAMES ? glGenFramebuffers(n, replayed.data()) : glDeleteFramebuffers(n, replayed.data()); break;
+			case TRACE_RENDERBUFFER: command == TRACE_GEN_NAMES ? glGenRenderbuffers(n, replayed.data()) : glDeleteRenderbuffers(n, replayed.data()); break;
+			case TRACE_VERTEX_ARRAY: command == TRACE_GEN_NAMES ? glGenVertexArrays(n, replayed.data()) : glDeleteVertexArrays(n, replayed.data()); break;
+			case TRACE_QUERY: command == TRACE_GEN_NAMES ? glGenQueries(n, replayed.data()) : glDeleteQueries(n, replayed.data()); break;
+			default: break;
+			}
+			if (command == TRACE_GEN_NAMES) {
+				for (GLsizei i = 0; i < n; i++) {
+					names[type][recorded[i]] = replayed[i];
+				}
+			}
+			break;
+		}
+		case TRACE_BIND_BUFFER: {
+			GLenum target = in.get<GLenum>();
+			glBindBuffer(target, translate(TRACE_BUFFER, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_BIND_BUFFER_BASE: {
+			GLenum target = in.get<GLenum>();
+			GLuint index = in.get<GLuint>();
+			glBindBufferBase(target, index, translate(TRACE_BUFFER, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_BIND_BUFFER_RANGE: {
+			GLenum target = in.get<GLenum>();
+			GLuint index = in.get<GLuint>();
+			GLuint buffer = translate(TRACE_BUFFER, in.get<GLuint>());
+			GLintptr rangeOffset = in.get<GLintptr>();
+			glBindBufferRange(target, index, buffer, rangeOffset, in.get<GLsizeiptr>());
+			break;
+		}
+		case TRACE_BIND_FRAMEBUFFER: {
+			GLenum target = in.get<GLenum>();
+			GLuint framebuffer = in.get<GLuint>();
+			bool isDefault = framebuffer == 0;
+			if (target != GL_READ_FRAMEBUFFER) {
+				drawDefault = isDefault;
+			}
+			if (target != GL_DRAW_FRAMEBUFFER) {
+				readDefault = isDefault;
+			}
+			glBindFramebuffer(target, isDefault ? defaultTarget.FBO : translate(TRACE_FRAMEBUFFER, framebuffer));
+			break;
+		}
+		case TRACE_BIND_RENDERBUFFER: {
+			GLenum target = in.get<GLenum>();
+			glBindRenderbuffer(target, translate(TRACE_RENDERBUFFER, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_BIND_TEXTURE: {
+			GLenum target = in.get<GLenum>();
+			glBindTexture(target, translate(TRACE_TEXTURE, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_BIND_VERTEX_ARRAY: glBindVertexArray(translate(TRACE_VERTEX_ARRAY, in.get<GLuint>())); break;
+
+		case TRACE_BUFFER_DATA: {
+			GLenum target = in.get<GLenum>();
+			GLsizeiptr dataSize = in.get<GLsizeiptr>();
+			GLenum usage = in.get<GLenum>();
+			glBufferData(target, dataSize, in.blob(), usage);
+			break;
+		}
+		case TRACE_BUFFER_SUB_DATA: {
+			GLenum target = in.get<GLenum>();
+			GLintptr dataOffset = in.get<GLintptr>();
+			uint64_t dataSize;
+			const void *data = in.blob(dataSize);
+			glBufferSubData(target, dataOffset, static_cast<GLsizeiptr>(dataSize), data);
+			break;
+		}
+		case TRACE_COPY_BUFFER_SUB_DATA: {
+			GLenum readTarget = in.get<GLenum>();
+			GLenum writeTarget = in.get<GLenum>();
+			GLintptr readOffset = in.get<GLintptr>();
+			GLintptr writeOffset = in.get<GLintptr>();
+			glCopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, in.get<GLsizeiptr>());
+			break;
+		}
+		case TRACE_MAP_BUFFER_RANGE: {
+			GLenum target = in.get<GLenum>();
+			GLintptr mapOffset = in.get<GLintptr>();
+			GLsizeiptr length = in.get<GLsizeiptr>();
+			mappedBuffers[target] = glMapBufferRange(target, mapOffset, length, in.get<GLbitfield>());
+			break;
+		}
+		case TRACE_UNMAP_BUFFER: {
+			GLenum target = in.get<GLenum>();
+			uint64_t dataSize;
+			const void *data = in.blob(dataSize);
+			void *pointer = mappedBuffers[target];
+			if (pointer && data) {
+				std::memcpy(pointer, data, dataSize);
+			}
+			mappedBuffers.erase(target);
+			glUnmapBuffer(target);
+			break;
+		}
+		case TRACE_TEX_BUFFER: {
+			GLenum target = in.get<GLenum>();
+			GLenum internalformat = in.get<GLenum>();
+			glTexBuffer(target, internalformat, translate(TRACE_BUFFER, in.get<GLuint>()));
+			break;
+		}
+
+		case TRACE_TEX_IMAGE_2D:
+		case TRACE_TEX_IMAGE_3D:
+		case TRACE_TEX_SUB_IMAGE_3D: {
+			GLenum target = in.get<GLenum>();
+			GLint level = in.get<GLint>();
+			GLint internalformat = 0, x = 0, y = 0, z = 0;
+			if (command == TRACE_TEX_SUB_IMAGE_3D) {
+				x = in.get<GLint>();
+				y = in.get<GLint>();
+				z = in.get<GLint>();
+			}
+			else {
+				internalformat = in.get<GLint>();
+			}
+			GLsizei width = in.get<GLsizei>();
+			GLsizei height = in.get<GLsizei>();
+			GLsizei depth = command == TRACE_TEX_IMAGE_2D ? 1 : in.get<GLsizei>();
+			GLint border = command == TRACE_TEX_SUB_IMAGE_3D ? 0 : in.get<GLint>();
+			GLenum format = in.get<GLenum>();
+			GLenum type = in.get<GLenum>();
+			const void *pixels = in.get<uint8_t>() ? offsetPointer(in.get<uint64_t>()) : in.blob();
+			if (command == TRACE_TEX_IMAGE_2D) {
+				glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+			}
+			else if (command == TRACE_TEX_IMAGE_3D) {
+				glTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+			}
+			else {
+				glTexSubImage3D(target, level, x, y, z, width, height, depth, format, type, pixels);
+			}
+			break;
+		}
+		case TRACE_TEX_IMAGE_2D_MULTISAMPLE: {
+			GLenum target = in.get<GLenum>();
+			GLsizei samples = in.get<GLsizei>();
+			GLenum internalformat = in.get<GLenum>();
+			GLsizei width = in.get<GLsizei>();
+			GLsizei height = in.get<GLsizei>();
+			glTexImage2DMultisample(target, samples, internalformat, width, height, in.get<GLboolean>());
+			break;
+		}
+		case TRACE_TEX_PARAMETER_I: {
+			GLenum target = in.get<GLenum>();
+			GLenum pname = in.get<GLenum>();
+			glTexParameteri(target, pname, in.get<GLint>());
+			break;
+		}
+		case TRACE_TEX_PARAMETER_FV: {
+			GLenum target = in.get<GLenum>();
+			GLenum pname = in.get<GLenum>();
+			glTexParameterfv(target, pname, static_cast<const GLfloat*>(in.blob()));
+			break;
+		}
+		case TRACE_GENERATE_MIPMAP: glGenerateMipmap(in.get<GLenum>()); break;
+		case TRACE_FRAMEBUFFER_RENDERBUFFER: {
+			GLenum target = in.get<GLenum>();
+			GLenum attachment = in.get<GLenum>();
+			GLenum renderbuffertarget = in.get<GLenum>();
+			glFramebufferRenderbuffer(target, attachment, renderbuffertarget, translate(TRACE_RENDERBUFFER, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_FRAMEBUFFER_TEXTURE: {
+			GLenum target = in.get<GLenum>();
+			GLenum attachment = in.get<GLenum>();
+			GLuint texture = translate(TRACE_TEXTURE, in.get<GLuint>());
+			glFramebufferTexture(target, attachment, texture, in.get<GLint>());
+			break;
+		}
+		case TRACE_FRAMEBUFFER_TEXTURE_2D: {
+			GLenum target = in.get<GLenum>();
+			GLenum attachment = in.get<GLenum>();
+			GLenum textarget = in.get<GLenum>();
+			GLuint texture = translate(TRACE_TEXTURE, in.get<GLuint>());
+			glFramebufferTexture2D(target, attachment, textarget, texture, in.get<GLint>());
+			break;
+		}
+		case TRACE_FRAMEBUFFER_TEXTURE_LAYER: {
+			GLenum target = in.get<GLenum>();
+			GLenum attachment = in.get<GLenum>();
+			GLuint texture = translate(TRACE_TEXTURE, in.get<GLuint>());
+			GLint level = in.get<GLint>();
+			glFramebufferTextureLayer(target, attachment, texture, level, in.get<GLint>());
+			break;
+		}
+		case TRACE_RENDERBUFFER_STORAGE: {
+			GLenum target = in.get<GLenum>();
+			GLenum internalformat = in.get<GLenum>();
+			GLsizei width = in.get<GLsizei>();
+			glRenderbufferStorage(target, internalformat, width, in.get<GLsizei>());
+			break;
+		}
+
+		case TRACE_ENABLE_VERTEX_ATTRIB_ARRAY: glEnableVertexAttribArray(in.get<GLuint>()); break;
+		case TRACE_VERTEX_ATTRIB_POINTER: {
+			GLuint index = in.get<GLuint>();
+			GLint components = in.get<GLint>();
+			GLenum type = in.get<GLenum>();
+			GLboolean normalized = in.get<GLboolean>();
+			GLsizei stride = in.get<GLsizei>();
+			glVertexAttribPointer(index, components, type, normalized, stride, offsetPointer(in.get<uint64_t>()));
+			break;
+		}
+		case TRACE_VERTEX_ATTRIB_I_POINTER: {
+			GLuint index = in.get<GLuint>();
+			GLint components = in.get<GLint>();
+			GLenum type = in.get<GLenum>();
+			GLsizei stride = in.get<GLsizei>();
+			glVertexAttribIPointer(index, components, type, stride, offsetPointer(in.get<uint64_t>()));
+			break;
+		}
+		case TRACE_VERTEX_ATTRIB_DIVISOR: {
+			GLuint index = in.get<GLuint>();
+			glVertexAttribDivisor(index, in.get<GLuint>());
+			break;
+		}
+
+		case TRACE_CREATE_SHADER: {
+			GLenum type = in.get<GLenum>();
+			names[TRACE_PROGRAM][in.get<GLuint>()] = glCreateShader(type);
+			break;
+		}
+		case TRACE_SHADER_SOURCE: {
+			GLuint shader = translate(TRACE_PROGRAM, in.get<GLuint>());
+			uint64_t sourceSize;
+			const GLchar *source = static_cast<const GLchar*>(in.blob(sourceSize));
+			GLint length = static_cast<GLint>(sourceSize);
+			glShaderSource(shader, 1, &source, &length);
+			break;
+		}
+		case TRACE_COMPILE_SHADER: glCompileShader(translate(TRACE_PROGRAM, in.get<GLuint>())); break;
+		case TRACE_DELETE_SHADER:
+		case TRACE_DELETE_PROGRAM: {
+			GLuint recorded = in.get<GLuint>();
+			GLuint object = translate(TRACE_PROGRAM, recorded);
+			names[TRACE_PROGRAM].erase(recorded);
+			if (command == TRACE_DELETE_SHADER) {
+				glDeleteShader(object);
+			}
+			else {
+				uniformLocations.erase(object);
+				blockIndices.erase(object);
+				glDeleteProgram(object);
+			}
+			break;
+		}
+		case TRACE_CREATE_PROGRAM: names[TRACE_PROGRAM][in.get<GLuint>()] = glCreateProgram(); break;
+		case TRACE_ATTACH_SHADER: {
+			GLuint program = translate(TRACE_PROGRAM, in.get<GLuint>());
+			glAttachShader(program, translate(TRACE_PROGRAM, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_LINK_PROGRAM: glLinkProgram(translate(TRACE_PROGRAM, in.get<GLuint>())); break;
+		case TRACE_USE_PROGRAM:
+			currentProgram = translate(TRACE_PROGRAM, in.get<GLuint>());
+			glUseProgram(currentProgram);
+			break;
+		case TRACE_GET_UNIFORM_LOCATION: {
+			GLuint program = translate(TRACE_PROGRAM, in.get<GLuint>());
+			GLint recorded = in.get<GLint>();
+			GLint location = glGetUniformLocation(program, static_cast<const GLchar*>(in.blob()));
+			if (recorded >= 0) {
+				uniformLocations[program][recorded] = location;
+			}
+			break;
+		}
+		case TRACE_GET_UNIFORM_BLOCK_INDEX: {
+			GLuint program = translate(TRACE_PROGRAM, in.get<GLuint>());
+			GLuint recorded = in.get<GLuint>();
+			GLuint index = glGetUniformBlockIndex(program, static_cast<const GLchar*>(in.blob()));
+			if (recorded != GL_INVALID_INDEX) {
+				blockIndices[program][recorded] = index;
+			}
+			break;
+		}
+		case TRACE_UNIFORM_BLOCK_BINDING: {
+			GLuint program = translate(TRACE_PROGRAM, in.get<GLuint>());
+			GLuint index = in.get<GLuint>();
+			auto found = blockIndices[program].find(index);
+			glUniformBlockBinding(program, found != blockIndices[program].end() ? found->second : index, in.get<GLuint>());
+			break;
+		}
+		case TRACE_UNIFORM: {
+			GL_Trace_Uniform kind = static_cast<GL_Trace_Uniform>(in.get<uint32_t>());
+			GLint location = translateLocation(in.get<GLint>());
+			GLsizei count = in.get<GLsizei>();
+			GLboolean transpose = in.get<GLboolean>();
+			const void *values = in.blob();
+			if (location < 0) {
+				break;
+			}
+			const GLfloat *f = static_cast<const GLfloat*>(values);
+			const GLint *i = static_cast<const GLint*>(values);
+			switch (kind) {
+			case TRACE_UNIFORM_1FV: glUniform1fv(location, count, f); break;
+			case TRACE_UNIFORM_2FV: glUniform2fv(location, count, f); break;
+			case TRACE_UNIFORM_3FV: glUniform3fv(location, count, f); break;
+			case TRACE_UNIFORM_4FV: glUniform4fv(location, count, f); break;
+			case TRACE_UNIFORM_1IV: glUniform1iv(location, count, i); break;
+			case TRACE_UNIFORM_2IV: glUniform2iv(location, count, i); break;
+			case TRACE_UNIFORM_3IV: glUniform3iv(location, count, i); break;
+			case TRACE_UNIFORM_4IV: glUniform4iv(location, count, i); break;
+			case TRACE_UNIFORM_1UIV: glUniform1uiv(location, count, static_cast<const GLuint*>(values)); break;
+			case TRACE_UNIFORM_MATRIX_2FV: glUniformMatrix2fv(location, count, transpose, f); break;
+			case TRACE_UNIFORM_MATRIX_3FV: glUniformMatrix3fv(location, count, transpose, f); break;
+			case TRACE_UNIFORM_MATRIX_4FV: glUniformMatrix4fv(location, count, transpose, f); break;
+			}
+			break;
+		}
+
+		case TRACE_BEGIN_QUERY: {
+			GLenum target = in.get<GLenum>();
+			glBeginQuery(target, translate(TRACE_QUERY, in.get<GLuint>()));
+			break;
+		}
+		case TRACE_END_QUERY: glEndQuery(in.get<GLenum>()); break;
+		case TRACE_QUERY_COUNTER: {
+			GLuint query = translate(TRACE_QUERY, in.get<GLuint>());
+			glQueryCounter(query, in.get<GLenum>());
+			break;
+		}
+		case TRACE_GET_QUERY_OBJECT: {
+			GLuint query = translate(TRACE_QUERY, in.get<GLuint>());
+			GLenum pname = in.get<GLenum>();
+			if (in.get<uint8_t>()) {
+				GLuint64 result;
+				glGetQueryObjectui64v(query, pname, &result);
+			}
+			else {
+				GLint result;
+				glGetQueryObjectiv(query, pname, &result);
+			}
+			break;
+		}
+		case TRACE_FENCE_SYNC: {
+			GLenum condition = in.get<GLenum>();
+			GLbitfield flags = in.get<GLbitfield>();
+			syncs[in.get<uint64_t>()] = glFenceSync(condition, flags);
+			break;
+		}
+		case TRACE_CLIENT_WAIT_SYNC: {
+			auto found = syncs.find(in.get<uint64_t>());
+			GLbitfield flags = in.get<GLbitfield>();
+			GLuint64 timeout = in.get<GLuint64>();
+			if (found != syncs.end()) {
+				glClientWaitSync(found->second, flags, timeout);
+			}
+			break;
+		}
+		case TRACE_DELETE_SYNC: {
+			auto found = syncs.find(in.get<uint64_t>());
+			if (found != syncs.end()) {
+				glDeleteSync(found->second);
+				syncs.erase(found);
+			}
+			break;
+		}
+
+		case TRACE_CLEAR: glClear(in.get<GLbitfield>()); break;
+		case TRACE_DRAW_ELEMENTS_BASE_VERTEX: {
+			GLenum mode = in.get<GLenum>();
+			GLsizei count = in.get<GLsizei>();
+			GLenum type = in.get<GLenum>();
+			const void *indices = offsetPointer(in.get<uint64_t>());
+			glDrawElementsBaseVertex(mode, count, type, indices, in.get<GLint>());
+			break;
+		}
+		case TRACE_DRAW_ELEMENTS_INSTANCED_BASE_VERTEX: {
+			GLenum mode = in.get<GLenum>();
+			GLsizei count = in.get<GLsizei>();
+			GLenum type = in.get<GLenum>();
+			const void *indices = offsetPointer(in.get<uint64_t>());
+			GLsizei instances = in.get<GLsizei>();
+			glDrawElementsInstancedBaseVertex(mode, count, type, indices, instances, in.get<GLint>());
+			break;
+		}
+		case TRACE_MULTI_DRAW_ELEMENTS_BASE_VERTEX: {
+			GLenum mode = in.get<GLenum>();
+			GLenum type = in.get<GLenum>();
+			uint64_t countSize;
+			const GLsizei *counts = static_cast<const GLsizei*>(in.blob(countSize));
+			const uint64_t *offsets = static_cast<const uint64_t*>(in.blob());
+			const GLint *baseVertices = static_cast<const GLint*>(in.blob());
+			GLsizei drawCount = static_cast<GLsizei>(countSize / sizeof(GLsizei));
+			vector<const void*> indices(drawCount);
+			for (GLsizei d = 0; d < drawCount; d++) {
+				indices[d] = offsetPointer(offsets[d]);
+			}
+			glMultiDrawElementsBaseVertex(mode, counts, type, indices.data(), drawCount, baseVertices);
+			break;
+		}
+		case TRACE_MULTI_DRAW_ELEMENTS_INDIRECT: {
+			GLenum mode = in.get<GLenum>();
+			GLenum type = in.get<GLenum>();
+			const void *indirect = offsetPointer(in.get<uint64_t>());
+			GLsizei drawCount = in.get<GLsizei>();
+			glMultiDrawElementsIndirect(mode, type, indirect, drawCount, in.get<GLsizei>());
+			break;
+		}
+		case TRACE_BLIT_FRAMEBUFFER: {
+			GLint coordinates[8];
+			for (GLint &c : coordinates) {
+				c = in.get<GLint>();
+			}
+			GLbitfield mask = in.get<GLbitfield>();
+			glBlitFramebuffer(coordinates[0], coordinates[1], coordinates[2], coordinates[3], coordinates[4], coordinates[5],
+				coordinates[6], coordinates[7], mask, in.get<GLenum>());
+			break;
+		}
+		case TRACE_READ_PIXELS: {
+			GLint x = in.get<GLint>();
+			GLint y = in.get<GLint>();
+			GLsizei width = in.get<GLsizei>();
+			GLsizei height = in.get<GLsizei>();
+			GLenum format = in.get<GLenum>();
+			GLenum type = in.get<GLenum>();
+			bool intoBuffer = in.get<uint8_t>() != 0;
+			uint64_t target = in.get<uint64_t>();
+			if (!intoBuffer && scratch.size() < target) {
+				scratch.resize(target);
+			}
+			glReadPixels(x, y, width, height, format, type, intoBuffer ? const_cast<void*>(offsetPointer(target)) : scratch.data());
+			break;
+		}
+
+		default:
+			std::cout << "ERROR::GL_TRACE::UNKNOWN_COMMAND: " << command << std::endl;
+			break;
+		}
+	}
+	if (benchmark && frameOpen) {
+		benchmark->endPass();
+		benchmark->endFrame();
+	}
+}
+
+void GLTraceReplayer::deleteObjects()
+{
+	for (int type = 0; type < TRACE_OBJECT_TYPES; type++) {
+		for (const auto &name : names[type]) {
+			GLuint object = name.second;
+			switch (type) {
+			case TRACE_BUFFER: glDeleteBuffers(1, &object); break;
+			case TRACE_TEXTURE: glDeleteTextures(1, &object); break;
+			case TRACE_FRAMEBUFFER: glDeleteFramebuffers(1, &object); break;
+			case TRACE_RENDERBUFFER: glDeleteRenderbuffers(1, &object); break;
+			case TRACE_VERTEX_ARRAY: glDeleteVertexArrays(1, &object); break;
+			case TRACE_QUERY: glDeleteQueries(1, &object); break;
+			case TRACE_PROGRAM:
+				if (glIsProgram(object)) {
+					glDeleteProgram(object);
+				}
+				else {
+					glDeleteShader(object);
+				}
+				break;
+			}
+		}
+		names[type].clear();
+	}
+	for (const auto &sync : syncs) {
+		glDeleteSync(sync.second);
+	}
+	syncs.clear();
+	uniformLocations.clear();
+	blockIndices.clear();
+	defaultTarget.deleteBuffers();
+}
@@ -0,0 +1,90 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* Frames a GPU timer query result is read after. Late enough that reading it never waits on the GPU. */
+#define BENCHMARK_QUERY_LATENCY 3
+
+/* Summary of a series of timings, in milliseconds. */
+struct TimingStats {
+	unsigned int count = 0;
+	double min = 0.0, avg = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+/* Collects CPU frame times and GPU pass times over a run and writes them out as JSON, so runs of different builds
+ * over the same camera path can be compared.
+ *
+ * The CPU frame time is the wall clock time from beginFrame() to endFrame(). Called around the whole loop body,
+ * buffer swap included, it covers everything the frame costs, including waits on the GPU. GPU passes are timed with GL_TIME_ELAPSED queries between beginPass() and
+ * endPass(); those cannot nest or overlap, and they cannot be used while another GL_TIME_ELAPSED query is active.
+ * Times measured elsewhere (SSAORenderer::getGpuTime) can be added with addGpuTime(). Per frame counts, such as
+ * the draw calls from GLStats, go in with addCounter() and are summarized the same way. The first warmup frames are
+ * left out of the statistics, they pay for shader compiles and first uploads. */
+class Benchmark {
+public:
+	Benchmark();
+
+	/* A disabled benchmark ignores every call, so the timing calls can stay in the render loop. Off by default. */
+	void setEnabled(bool enable) { enabled = enable; }
+	bool isEnabled() const { return enabled; }
+	void setWarmupFrames(int frames) { warmupFrames = frames; }
+	/* Extra "key": "value" pairs for the report, e.g. the GL renderer string. */
+	void setInfo(const string &key, const string &value) { info[key] = value; }
+
+	void beginFrame();
+	void endFrame();
+
+	void beginPass(const string &name);
+	void endPass();
+	void addGpuTime(const string &name, float milliseconds);
+	/* One sample of a per frame count, add each counter once per frame. */
+	void addCounter(const string &name, double value);
+
+	TimingStats cpuStats() const { return summarize(frameTimes); }
+	TimingStats gpuStats(const string &name) const;
+	TimingStats counterStats(const string &name) const;
+
+	/* Waits for the outstanding queries and writes the report. */
+	bool writeReport(const string &path);
+
+	void deleteQueries();
+
+private:
+	struct GpuPass {
+		string name;
+		unsigned int queries[BENCHMARK_QUERY_LATENCY];
+		/* Frame each query was issued in, -1 if it has no result pending. */
+		int queryFrames[BENCHMARK_QUERY_LATENCY];
+		vector<double> samples;
+	};
+
+	bool enabled;
+	int warmupFrames;
+	int frame;
+	std::chrono::steady_clock::time_point frameStart;
+	vector<double> frameTimes;
+	vector<GpuPass> passes;
+	struct Counter {
+		string name;
+		vector<double> samples;
+	};
+	vector<Counter> counters;
+	int activePass;
+	std::map<string, string> info;
+
+	GpuPass& findPass(const string &name);
+	void collect(GpuPass &pass, unsigned int slot);
+	bool measured() const { return frame >= warmupFrames; }
+	static TimingStats summarize(vector<double> samples);
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef BLOOM_RENDERER_H
+#define BLOOM_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+#include "shader.h"
+
+using std::vector;
+
+/* Upper bound on the mips of the chain, fewer are made when the smallest would go under MinBloomMipSize. */
+#define BLOOM_MAX_MIPS 6
+
+/* Physically based bloom over a mip chain instead of a ping-pong gaussian at full resolution.
+ *
+ * The HDR scene is downsampled with a 13 tap filter into a chain of R11F_G11F_B10F textures starting at half
+ * resolution (bloom_downsample.fs). The first pass applies a soft threshold and a Karis average against fireflies.
+ * The chain is then walked back up with a 3x3 tent filter (bloom_upsample.fs), each level added onto the next
+ * larger one, so mip 0 ends up holding the sum of every blur radius. bloom_final.fs mixes it into the scene by
+ * bloomStrength.
+ *
+ * Every pass touches a quarter of the pixels of the one before, which makes the whole chain cheaper than a single
+ * full resolution blur pass while reaching a much wider radius. */
+class BloomRenderer {
+public:
+	BloomRenderer();
+
+	/* (Re)creates the mip chain for a framebuffer of the given size. */
+	void create(int width, int height);
+
+	/* Knee of the soft threshold, see bloom_downsample.fs. */
+	void setThreshold(float newThreshold, float newKnee) { threshold = newThreshold; knee = newKnee; }
+	/* Radius of the upsample tent in texels of the smaller mip. */
+	void setFilterRadius(float radius) { filterRadius = radius; }
+
+	/* Runs the downsample and upsample passes on hdrTexture, which must have linear filtering. Restores the
+	 * viewport to the framebuffer size and leaves blending disabled. */
+	void render(Shader &downsampleShader, Shader &upsampleShader, unsigned int hdrTexture);
+
+	/* The bloom at half resolution, sampled by bloom_final.fs. */
+	unsigned int getTexture() const { return mips.empty() ? 0 : mips[0].texture; }
+	unsigned int mipCount() const { return static_cast<unsigned int>(mips.size()); }
+
+	void deleteBuffers();
+
+private:
+	struct BloomMip {
+		unsigned int texture;
+		int width, height;
+	};
+
+	int width, height;
+	float threshold, knee;
+	float filterRadius;
+	/* One framebuffer, each mip texture is attached in turn. */
+	unsigned int FBO;
+	vector<BloomMip> mips;
+};
+
+#endif
@@ -49,6 +49,9 @@ public:
 
 	void process_mouse_scroll(float yOffset);
 
+	/* Places the camera directly, used to replay recorded camera paths. */
+	void set_pose(const glm::vec3 &Position, float YAW, float PITCH, float ZOOM);
+
 private:
 	void update_camera_vectors();
 };
@@ -0,0 +1,44 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "camera.h"
+
+using std::string;
+using std::vector;
+
+/* Camera pose at one frame of a path. */
+struct CameraKey {
+	int frame;
+	glm::vec3 position;
+	float yaw, pitch, zoom;
+};
+
+/* Camera poses keyed by frame number, so a benchmark sees exactly the same views on every run regardless of how
+ * long the frames took. Paths are text files with one key per line, "frame x y z yaw pitch zoom", lines starting
+ * with # are comments. They can be written by hand or recorded from an interactive session. */
+class CameraPath {
+public:
+	bool load(const string &path);
+	bool save(const string &path) const;
+
+	/* Appends the camera's current pose as the key of frame, which must be later than the last key. */
+	void record(int frame, const Camera &camera);
+
+	/* Moves the camera to the pose at frame, interpolated linearly between the keys around it and held at the
+	 * first and last key outside the path. */
+	void apply(int frame, Camera &camera) const;
+
+	bool empty() const { return keys.empty(); }
+	int lastFrame() const { return keys.empty() ? 0 : keys.back().frame; }
+
+private:
+	/* Sorted by frame. */
+	vector<CameraKey> keys;
+};
+
+#endif
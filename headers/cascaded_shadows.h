@@ -0,0 +1,116 @@
+#ifndef CASCADED_SHADOWS_H
+#define CASCADED_SHADOWS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "mesh.h"
+#include "shader.h"
+#include "shadow_caster.h"
+
+using std::vector;
+
+/* Must match MAX_CASCADES in common/cascades.glsl. */
+#define MAX_CASCADES 4
+/* Uniform buffer binding point of the "ShadowCascades" block. */
+#define SHADOW_CASCADES_BINDING 4
+
+/* CPU copy of the "ShadowCascades" std140 block, vec4 and mat4 members only. */
+struct CascadeBlock {
+	glm::mat4 view;							// camera view, picks the cascade by view depth
+	glm::mat4 matrices[MAX_CASCADES];		// world -> light clip space of every cascade
+	glm::vec4 splits;						// far view depth of every cascade
+	glm::vec4 texelSizes;					// world size of one shadow texel in every cascade
+	glm::vec4 params;						// cascade count, blend width, normal offset, depth bias
+};
+
+/* Shadows of a directional light over a large view distance. The view frustum is split into up to MAX_CASCADES
+ * ranges, placed between a logarithmic and a linear distribution by the split lambda, and every range gets its own
+ * layer of one depth array texture, so close to the camera a texel covers little ground and far away a lot.
+ *
+ * Each cascade is fitted to the bounding sphere of its slice of the frustum. The sphere does not change size when
+ * the camera turns, and its centre is snapped to whole shadow texels in light space, so moving the camera never
+ * moves the shadow edges by a fraction of a texel (no shimmering). Casters between the light and the cascade are
+ * flattened onto its near plane with depth clamping instead of extending the depth range.
+ *
+ * Cascades from setCachedCascades() on are cached: they are fitted with some margin, and only one of them is
+ * redrawn per frame in turn, or earlier if the camera left the margin or the light turned. Moving casters show up
+ * in the far cascades a few frames late, which is hard to see at that distance.
+ *
+ * The depth pass is cascade_depth.vs/cascade_depth.fs, receivers include common/cascades.glsl. */
+class CascadedShadowMap {
+public:
+	CascadedShadowMap();
+
+	/* (Re)creates the depth array with size x size texels per cascade. */
+	void create(int size, int cascadeCount);
+
+	/* 0 gives linear splits, 1 logarithmic ones. */
+	void setSplitLambda(float lambda) { splitLambda = lambda; }
+	/* View distance shadows end at, usually well before the camera far plane. */
+	void setShadowDistance(float distance) { shadowDistance = distance; }
+	/* Fraction of each cascade faded into the next one. */
+	void setBlendWidth(float width) { block.params.y = width; }
+	void setBias(float normalOffset, float depthBias) { block.params.z = normalOffset; block.params.w = depthBias; }
+	/* Cascades with this index and above are cached, cascadeCount disables caching. */
+	void setCachedCascades(int first) { firstCached = first; invalidate(); }
+	/* Forces every cascade to be redrawn on the next render(), e.g. after static geometry moved. */
+	void invalidate();
+
+	/* Clears the caster list. */
+	void begin();
+	/* Adds a caster by its bounding sphere in model space. */
+	void addCaster(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec3 &center, float radius);
+	void addMesh(const Mesh &mesh, const glm::mat4 &model);
+
+	/* Fits the cascades to the camera and redraws the ones that are due. lightDir points from the light into the
+	 * scene. Restores the framebuffer binding to 0 and the previous viewport. */
+	void render(Shader &depthShader, const glm::mat4 &view, float fovy, float aspect, float zNear, const glm::vec3 &lightDir);
+
+	/* Points the shader's cascadeShadowMap sampler at unit and its ShadowCascades block at the binding. */
+	static void setupShader(Shader &shader, unsigned int unit);
+	void bind(unsigned int unit);
+
+	unsigned int getTexture() const { return depthArray; }
+	float getSplit(int cascade) const { return block.splits[cascade]; }
+	/* Cascades redrawn by the last render(). */
+	unsigned int cascadesRendered() const { return rendered; }
+
+	void deleteBuffers();
+
+private:
+	/* What a cascade was last drawn with. */
+	struct Cascade {
+		glm::vec3 center;		// world space centre of the fitted sphere
+		float radius;
+		glm::vec3 lightDir;
+		bool valid;
+	};
+
+	int size;
+	int cascadeCount;
+	int firstCached;
+	int nextCached;
+	float splitLambda;
+	float shadowDistance;
+	unsigned int rendered;
+
+	CascadeBlock block;
+	Cascade cascades[MAX_CASCADES];
+	vector<ShadowCaster> casters;
+
+	unsigned int FBO;
+	unsigned int depthArray;
+	unsigned int UBO;
+
+	/* Sphere around the slice of the view frustum between the two view depths, in view space. */
+	static void fitSlice(float fovy, float aspect, float nearDepth, float farDepth, glm::vec3 &center, float &radius);
+	/* Light space rotation shared by all cascades, the cascade origin is applied in the projection. */
+	static glm::mat4 lightRotation(const glm::vec3 &lightDir);
+	void renderCascade(int index, int modelloc, int matrixloc);
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* Pixel pack buffers in flight. A frame is read back this many frames after it was captured at the latest. */
+#define FRAME_WRITER_BUFFERS 3
+
+/* Writes rendered frames to disk without stalling the pipeline. capture() only queues a glReadPixels into a pixel
+ * pack buffer and a fence; the pixels are mapped and written out by a later capture() or poll() once the GPU is
+ * done with them, so the copy overlaps with rendering the next frames. Files are binary PPM, top row first. */
+class FrameWriter {
+public:
+	FrameWriter();
+
+	/* Queues a readback of the color attachment 0 of fbo. If every buffer is still in flight the oldest one is
+	 * waited for and written first. */
+	void capture(unsigned int fbo, int width, int height, const string &path);
+	/* Writes out finished readbacks without blocking. */
+	void poll();
+	/* Waits for and writes every pending readback. */
+	void finish();
+
+	unsigned int framesWritten() const { return written; }
+
+	void deleteBuffers();
+
+private:
+	struct PendingFrame {
+		GLsync fence;
+		int width, height;
+		string path;
+	};
+
+	unsigned int PBOs[FRAME_WRITER_BUFFERS];
+	unsigned int PBOSizes[FRAME_WRITER_BUFFERS];
+	PendingFrame pending[FRAME_WRITER_BUFFERS];
+	/* Ring of pending readbacks: the oldest is at first, count are in flight. */
+	unsigned int first, count;
+	unsigned int written;
+	/* Scratch row buffer for flipping, kept to avoid an allocation per frame. */
+	vector<unsigned char> rows;
+
+	/* Writes the oldest pending frame if its fence has signalled, or after waiting for it if wait is set. */
+	bool retire(bool wait);
+	bool writePPM(const string &path, const unsigned char *pixels, int width, int height);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+/* Compact G-buffer: 12 bytes per pixel instead of the 24 of a float position, float normal and RGBA8 layout.
+ *   depth        GL_DEPTH24_STENCIL8, positions are rebuilt from it and the inverse projection
+ *   normal       GL_RG16_SNORM, octahedral encoded (draw buffer 0)
+ *   albedoSpec   GL_RGBA8, albedo and specular intensity (draw buffer 1)
+ * Writers (buffer.fs, buffer_atlas.fs, ssao_geometry.fs) encode through common/octahedral.glsl, readers decode
+ * through common/gbuffer.glsl.
+ *
+ * The depth-stencil texture can also be attached to the lighting target (see LightVolumeRenderer) while it is
+ * sampled, as long as depth writes are off. */
+class GBuffer {
+public:
+	unsigned int FBO;
+	unsigned int depthTexture;
+	unsigned int normalTexture;
+	unsigned int albedoSpecTexture;
+
+	GBuffer();
+
+	/* (Re)creates the attachments at the given size. */
+	void create(int width, int height);
+
+	/* Binds the framebuffer for the geometry pass. */
+	void bind();
+
+	/* Binds depth, normal and albedoSpec to units firstUnit .. firstUnit + 2. */
+	void bindTextures(unsigned int firstUnit);
+
+	/* Points the shader's gDepth, gNormal and gAlbedoSpec samplers at the units used by bindTextures. */
+	static void setupShader(Shader &shader, unsigned int firstUnit);
+	/* Sets inverseProjection and inverseView, needed to rebuild positions. The shader must be in use. */
+	static void setMatrices(Shader &shader, const glm::mat4 &projection, const glm::mat4 &view);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	void deleteBuffers();
+
+private:
+	int width, height;
+};
+
+#endif
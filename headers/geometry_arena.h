@@ -0,0 +1,115 @@
+#ifndef GEOMETRY_ARENA_H
+#define GEOMETRY_ARENA_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* Vertex layouts that can live in the arena. Every format gets exactly one VAO and one vertex buffer,
+ * all formats share a single index buffer. */
+enum Vertex_Format {
+	VERTEX_FORMAT_MESH,		// Vertex struct from mesh.h (position, normal, uv, tangent, bitangent, bones)
+	VERTEX_FORMAT_P3N3T2,	// Tightly packed position, normal, uv floats (spheres, cubes)
+	VERTEX_FORMAT_P3T2,		// Tightly packed position, uv floats (screen quads)
+	VERTEX_FORMAT_COUNT
+};
+
+/* Sub-range of a buffer, in elements (vertices or indices) rather than bytes. */
+struct ArenaBlock {
+	unsigned int offset;
+	unsigned int size;
+};
+
+/* First fit allocator over a linear range of elements. Freed blocks are merged with their neighbours. */
+class RangeAllocator {
+public:
+	unsigned int capacity;
+
+	RangeAllocator(unsigned int capacity = 0);
+
+	/* Returns false if no free block is large enough. */
+	bool allocate(unsigned int size, unsigned int &offset);
+	void free(unsigned int offset, unsigned int size);
+
+	/* Extends the managed range, the new space is appended to the free list. */
+	void grow(unsigned int newCapacity);
+
+private:
+	/* Sorted by offset, never contains two adjacent blocks. */
+	vector<ArenaBlock> freeBlocks;
+};
+
+/* Everything needed to draw a piece of geometry that lives in the arena. */
+struct GeometryHandle {
+	Vertex_Format format = VERTEX_FORMAT_MESH;
+	GLenum mode = GL_TRIANGLES;
+	unsigned int baseVertex = 0;
+	unsigned int vertexCount = 0;
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+
+	bool valid() const { return indexCount != 0; }
+};
+
+class GeometryArena {
+public:
+	/* The single arena used by meshes and the builtin shapes. Buffers are created lazily on first use,
+	 * so this is safe to call before a GL context exists as long as nothing is allocated. */
+	static GeometryArena& get();
+
+	/* Copies vertex and index data into the arena. vertexData must hold vertexCount vertices of the given format. */
+	GeometryHandle allocate(Vertex_Format format, const void *vertexData, unsigned int vertexCount,
+		const unsigned int *indices, unsigned int indexCount, GLenum mode = GL_TRIANGLES);
+	/* Returns the ranges held by the handle to the free lists and clears it. */
+	void free(GeometryHandle &handle);
+
+	/* Binds the shared VAO of the format, skipping the call if it is already bound. */
+	void bind(Vertex_Format format);
+	/* Must be called if anything outside the arena changes the bound VAO. */
+	void resetBindingCache();
+
+	/* Single glDrawElementsBaseVertex call. */
+	void draw(const GeometryHandle &handle);
+	/* Draws all handles with one glMultiDrawElementsBaseVertex per run of equal format and mode. */
+	void drawBatch(const vector<const GeometryHandle*> &handles);
+	/* Full screen quad in NDC with texture coordinates, shared by every post processing pass. */
+	void drawScreenQuad();
+
+	unsigned int getVAO(Vertex_Format format) const { return VAOs[format]; }
+	unsigned int getVertexBuffer(Vertex_Format format) const { return VBOs[format]; }
+	unsigned int getIndexBuffer() const { return EBO; }
+	static unsigned int getStride(Vertex_Format format);
+
+	void deleteBuffers();
+
+private:
+	unsigned int VAOs[VERTEX_FORMAT_COUNT] = {};
+	unsigned int VBOs[VERTEX_FORMAT_COUNT] = {};
+	unsigned int EBO = 0;
+	RangeAllocator vertexAllocators[VERTEX_FORMAT_COUNT];
+	RangeAllocator indexAllocator;
+	unsigned int boundVAO = 0;
+	GeometryHandle screenQuad;
+
+	/* Scratch arrays for multi draw calls, kept around to avoid per frame allocations. */
+	vector<GLsizei> batchCounts;
+	vector<const void*> batchOffsets;
+	vector<GLint> batchBaseVertices;
+
+	GeometryArena() = default;
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	void setupFormat(Vertex_Format format);
+	void setupAttributes(Vertex_Format format);
+	/* Reallocates a buffer with a larger size and copies the old contents over. */
+	unsigned int growBuffer(unsigned int buffer, unsigned int oldBytes, unsigned int newBytes, const string &label);
+	void growVertices(Vertex_Format format, unsigned int minFree);
+	void growIndices(unsigned int minFree);
+};
+
+#endif
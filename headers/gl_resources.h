@@ -0,0 +1,165 @@
+#ifndef GL_RESOURCES_H
+#define GL_RESOURCES_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+
+using std::string;
+
+/* Kinds of GL objects the registry keeps track of. */
+enum GL_Resource_Type {
+	RESOURCE_TEXTURE,
+	RESOURCE_BUFFER,
+	RESOURCE_RENDERBUFFER,
+	RESOURCE_FRAMEBUFFER,
+	RESOURCE_VERTEX_ARRAY,
+	RESOURCE_PROGRAM,
+	RESOURCE_TYPES
+};
+
+/* Source line an object was created on. */
+struct GLSite {
+	const char *file;
+	int line;
+};
+#define GL_SITE GLSite{ __FILE__, __LINE__ }
+
+/* Names an object created on this line, for debuggers (glObjectLabel) and for the registry. */
+#define GL_LABEL(type, name, text) GLResources::get().label(type, name, text, GL_SITE)
+
+/* One live object. Sizes are what the internal formats need, drivers may pad (RGB to RGBA, depth 24 to 32) or
+ * compress, so the totals are estimates of the real footprint, close enough to budget with. */
+struct GLResource {
+	string label;
+	GLSite site = { nullptr, 0 };
+	/* Textures: target and internal format, renderbuffers: internal format, texture buffers: format of the view. */
+	GLenum target = 0;
+	GLenum format = 0;
+	/* Of level 0, depth is the layer count of array textures. */
+	int width = 0, height = 0, depth = 0;
+	/* Bytes per texture image, keyed level * 6 + cube face. Buffers and renderbuffers have a single entry. */
+	std::map<int, size_t> images;
+	size_t bytes = 0;
+	/* Labelled before GL created the object, glObjectLabel follows on its first bind. */
+	bool labelPending = false;
+};
+
+/* Registry of every texture, buffer, renderbuffer, framebuffer, vertex array and program alive in the context,
+ * to budget GPU memory and find leaks.
+ *
+ * setEnabled() swaps the glad pointers of the calls that create, delete, bind and allocate objects for versions
+ * that keep the registry up to date, like GLStats does, so objects are accounted for wherever they are made.
+ * Enable it right after GL is loaded, objects from before are unknown to it. What the hooks cannot see is where
+ * and what for an object was created, GL_LABEL (or a GLHandle) adds that. */
+class GLResources {
+public:
+	static GLResources& get();
+
+	void setEnabled(bool enable);
+	bool isEnabled() const { return enabled; }
+
+	/* Labels the object with glObjectLabel where the context has it (4.3) and records label and site. A name from
+	 * glGen* only becomes an object on its first bind, label after it or keep the registry enabled, which labels
+	 * the object when it is bound. */
+	void label(GL_Resource_Type type, unsigned int name, const string &label, GLSite site);
+
+	const std::map<unsigned int, GLResource>& objects(GL_Resource_Type type) const { return live[type]; }
+	size_t liveBytes(GL_Resource_Type type) const { return bytes[type]; }
+	size_t totalBytes() const;
+	/* Highest totalBytes() so far. */
+	size_t peakBytes() const { return peak; }
+
+	/* Count and size of the live objects per type, with the largest objects listed when largest > 0. */
+	void report(std::ostream &out, unsigned int largest = 0) const;
+	/* "GPU 212.3 MB", the live total. */
+	string summary() const;
+	/* Prints every object still alive as a leak and returns how many there are. Call it once everything has been
+	 * deleted, before the context goes away. */
+	unsigned int checkLeaks() const;
+
+	static const char* typeName(GL_Resource_Type type);
+	/* Bytes per texel of a sized or unsized internal format. */
+	static size_t texelSize(GLenum internalFormat);
+	/* "14.1 MB", or KB below a megabyte, the format of every memory report. */
+	static string memorySize(size_t bytes);
+
+	/* Creation and deletion, for GLHandle. The object goes into the registry through the hooks. */
+	static unsigned int generate(GL_Resource_Type type);
+	static void destroy(GL_Resource_Type type, unsigned int name);
+
+	/* Bookkeeping, called by the hooks. */
+	void created(GL_Resource_Type type, unsigned int name);
+	void deleted(GL_Resource_Type type, unsigned int name);
+	GLResource* find(GL_Resource_Type type, unsigned int name);
+	/* Sets the size of one image of the object. */
+	void setImage(GL_Resource_Type type, GLResource &resource, int image, size_t imageBytes);
+
+private:
+	bool enabled = false;
+	std::map<unsigned int, GLResource> live[RESOURCE_TYPES];
+	size_t bytes[RESOURCE_TYPES] = {};
+	size_t peak = 0;
+
+	GLResources() = default;
+	GLResources(const GLResources&) = delete;
+	GLResources& operator=(const GLResources&) = delete;
+};
+
+/* Owns one GL object: create() makes and labels it, the handle deletes it when it goes away or is reset().
+ * Handles move but do not copy, and convert to the object name so they pass straight to GL calls.
+ *
+ * Like every GL object they have to go before the context does, handles that live until the end of main() are
+ * reset() before it is destroyed. */
+template <GL_Resource_Type Type>
+class GLHandle {
+public:
+	GLHandle() = default;
+	GLHandle(const string &label, GLSite site) { create(label, site); }
+	~GLHandle() { reset(); }
+
+	GLHandle(GLHandle &&other) noexcept : name(other.name) { other.name = 0; }
+	GLHandle& operator=(GLHandle &&other) noexcept
+	{
+		if (this != &other) {
+			reset();
+			name = other.name;
+			other.name = 0;
+		}
+		return *this;
+	}
+	GLHandle(const GLHandle&) = delete;
+	GLHandle& operator=(const GLHandle&) = delete;
+
+	/* Deletes the object held so far and makes a new one. */
+	void create(const string &label, GLSite site)
+	{
+		reset();
+		name = GLResources::generate(Type);
+		GLResources::get().label(Type, name, label, site);
+	}
+	void reset()
+	{
+		if (name != 0) {
+			GLResources::destroy(Type, name);
+			name = 0;
+		}
+	}
+
+	unsigned int id() const { return name; }
+	operator unsigned int() const { return name; }
+
+private:
+	unsigned int name = 0;
+};
+
+typedef GLHandle<RESOURCE_TEXTURE> GLTexture;
+typedef GLHandle<RESOURCE_BUFFER> GLBuffer;
+typedef GLHandle<RESOURCE_RENDERBUFFER> GLRenderbuffer;
+typedef GLHandle<RESOURCE_FRAMEBUFFER> GLFramebuffer;
+typedef GLHandle<RESOURCE_VERTEX_ARRAY> GLVertexArray;
+
+#endif
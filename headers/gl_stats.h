@@ -0,0 +1,81 @@
+#ifndef GL_STATS_H
+#define GL_STATS_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+
+#include "benchmark.h"
+
+using std::string;
+
+/* Work submitted to GL in one frame. */
+struct GLFrameStats {
+	unsigned int drawCalls = 0;		// glDraw* and glMultiDraw* calls
+	unsigned int draws = 0;			// draws those calls made, a multi draw counts each of its draws
+	unsigned long long instances = 0;
+	unsigned long long primitives = 0;
+	unsigned int programSwitches = 0;	// glUseProgram calls that changed the program
+	unsigned int textureBinds = 0;		// glBindTexture calls
+	unsigned int redundantTextureBinds = 0;	// of those, the ones that bound what was already bound
+	unsigned int framebufferSwitches = 0;	// changes of the draw framebuffer
+	unsigned long long bufferBytes = 0;	// glBufferData with data, glBufferSubData, mapped for writing
+	unsigned long long textureBytes = 0;	// glTexImage* with data, glTexSubImage*
+};
+
+/* Counts the work every frame submits, to check batching and upload changes by numbers instead of by eye.
+ *
+ * setEnabled() swaps the glad pointers of the draw, bind and upload entry points for counting versions, like
+ * GLTraceRecorder does, so every path is covered, Mesh::Draw, GeometryArena, the render* helpers and the renderer
+ * classes alike, without a wrapper at each call site. Disabled, nothing is hooked. Enable it right after GL is
+ * loaded and before a GL trace capture starts, the hooks then chain.
+ *
+ * Indirect draws read their counts from a GPU buffer, so the caller adds their instances and primitives with
+ * addIndirectWork() (IndirectRenderer does). */
+class GLStats {
+public:
+	static GLStats& get();
+
+	void setEnabled(bool enable);
+	bool isEnabled() const { return enabled; }
+
+	/* Closes the frame: its counts become lastFrame() and counting starts over. */
+	void endFrame();
+
+	/* The frame being counted and the last complete one. */
+	const GLFrameStats& currentFrame() const { return current; }
+	const GLFrameStats& lastFrame() const { return last; }
+	/* Every frame since the start, frames() of them. */
+	const GLFrameStats& total() const { return totals; }
+	unsigned int frames() const { return frameCount; }
+
+	void addIndirectWork(unsigned long long instances, unsigned long long primitives);
+	/* Adds the last frame's counters to the benchmark's per frame counters. */
+	void addToBenchmark(Benchmark &benchmark) const;
+	/* "412 draws, 1.2M tris" for the last frame. */
+	string summary() const;
+
+	/* Primitives drawn by count vertices in the mode. */
+	static unsigned long long primitiveCount(GLenum mode, long long count);
+	/* Bytes of client memory an image of the format and type takes, rows padded to alignment. */
+	static size_t imageSize(int width, int height, int depth, GLenum format, GLenum type, int alignment = 1, int rowLength = 0);
+
+	/* Counters, written by the hooks. */
+	GLFrameStats current;
+	unsigned int activeTexture = 0;
+	unsigned int program = 0;
+	unsigned int drawFramebuffer = 0;
+
+private:
+	bool enabled = false;
+	GLFrameStats last;
+	GLFrameStats totals;
+	unsigned int frameCount = 0;
+
+	GLStats() = default;
+	GLStats(const GLStats&) = delete;
+	GLStats& operator=(const GLStats&) = delete;
+};
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "headless_context.h"
+
+using std::string;
+using std::vector;
+
+/* Commands of a GL trace. The values are part of the file format, new commands go at the end. Calls that only
+ * read state back (glGetIntegerv, glGetShaderiv, ...) are not recorded, they change nothing a replay depends on. */
+enum GL_Trace_Command {
+	/* Markers */
+	TRACE_CAPTURE_BEGIN,
+	TRACE_FRAME_END,
+
+	/* Fixed function state */
+	TRACE_ACTIVE_TEXTURE,
+	TRACE_BLEND_EQUATION,
+	TRACE_BLEND_FUNC,
+	TRACE_CLEAR_COLOR,
+	TRACE_COLOR_MASK,
+	TRACE_CULL_FACE,
+	TRACE_DEPTH_FUNC,
+	TRACE_DEPTH_MASK,
+	TRACE_ENABLE,
+	TRACE_DISABLE,
+	TRACE_DRAW_BUFFER,
+	TRACE_DRAW_BUFFERS,
+	TRACE_READ_BUFFER,
+	TRACE_PIXEL_STORE,
+	TRACE_POLYGON_MODE,
+	TRACE_STENCIL_FUNC,
+	TRACE_STENCIL_OP,
+	TRACE_STENCIL_OP_SEPARATE,
+	TRACE_VIEWPORT,
+
+	/* Object names */
+	TRACE_GEN_NAMES,
+	TRACE_DELETE_NAMES,
+	TRACE_BIND_BUFFER,
+	TRACE_BIND_BUFFER_BASE,
+	TRACE_BIND_BUFFER_RANGE,
+	TRACE_BIND_FRAMEBUFFER,
+	TRACE_BIND_RENDERBUFFER,
+	TRACE_BIND_TEXTURE,
+	TRACE_BIND_VERTEX_ARRAY,
+
+	/* Buffers */
+	TRACE_BUFFER_DATA,
+	TRACE_BUFFER_SUB_DATA,
+	TRACE_COPY_BUFFER_SUB_DATA,
+	TRACE_MAP_BUFFER_RANGE,
+	TRACE_UNMAP_BUFFER,
+	TRACE_TEX_BUFFER,
+
+	/* Textures and framebuffers */
+	TRACE_TEX_IMAGE_2D,
+	TRACE_TEX_IMAGE_3D,
+	TRACE_TEX_SUB_IMAGE_3D,
+	TRACE_TEX_PARAMETER_I,
+	TRACE_TEX_PARAMETER_FV,
+	TRACE_GENERATE_MIPMAP,
+	TRACE_FRAMEBUFFER_RENDERBUFFER,
+	TRACE_FRAMEBUFFER_TEXTURE,
+	TRACE_FRAMEBUFFER_TEXTURE_2D,
+	TRACE_FRAMEBUFFER_TEXTURE_LAYER,
+	TRACE_RENDERBUFFER_STORAGE,
+
+	/* Vertex arrays */
+	TRACE_ENABLE_VERTEX_ATTRIB_ARRAY,
+	TRACE_VERTEX_ATTRIB_POINTER,
+	TRACE_VERTEX_ATTRIB_I_POINTER,
+	TRACE_VERTEX_ATTRIB_DIVISOR,
+
+	/* Programs */
+	TRACE_CREATE_SHADER,
+	TRACE_SHADER_SOURCE,
+	TRACE_COMPILE_SHADER,
+	TRACE_DELETE_SHADER,
+	TRACE_CREATE_PROGRAM,
+	TRACE_ATTACH_SHADER,
+	TRACE_LINK_PROGRAM,
+	TRACE_DELETE_PROGRAM,
+	TRACE_USE_PROGRAM,
+	TRACE_GET_UNIFORM_LOCATION,
+	TRACE_GET_UNIFORM_BLOCK_INDEX,
+	TRACE_UNIFORM_BLOCK_BINDING,
+	TRACE_UNIFORM,
+
+	/* Queries and syncs */
+	TRACE_BEGIN_QUERY,
+	TRACE_END_QUERY,
+	TRACE_QUERY_COUNTER,
+	TRACE_GET_QUERY_OBJECT,
+	TRACE_FENCE_SYNC,
+	TRACE_CLIENT_WAIT_SYNC,
+	TRACE_DELETE_SYNC,
+
+	/* Output: draws and everything else that only writes pixels */
+	TRACE_CLEAR,
+	TRACE_DRAW_ELEMENTS_BASE_VERTEX,
+	TRACE_DRAW_ELEMENTS_INSTANCED_BASE_VERTEX,
+	TRACE_MULTI_DRAW_ELEMENTS_BASE_VERTEX,
+	TRACE_MULTI_DRAW_ELEMENTS_INDIRECT,
+	TRACE_BLIT_FRAMEBUFFER,
+	TRACE_READ_PIXELS,
+
+	/* Multisampled render targets (RenderGraph) */
+	TRACE_TEX_IMAGE_2D_MULTISAMPLE
+};
+
+/* Name spaces of the objects a trace creates. Shaders and programs share one, as they do in GL. */
+enum GL_Trace_Object {
+	TRACE_BUFFER,
+	TRACE_TEXTURE,
+	TRACE_FRAMEBUFFER,
+	TRACE_RENDERBUFFER,
+	TRACE_VERTEX_ARRAY,
+	TRACE_QUERY,
+	TRACE_PROGRAM,
+	TRACE_OBJECT_TYPES
+};
+
+/* Every glUniform* is recorded as its array form. */
+enum GL_Trace_Uniform {
+	TRACE_UNIFORM_1FV,
+	TRACE_UNIFORM_2FV,
+	TRACE_UNIFORM_3FV,
+	TRACE_UNIFORM_4FV,
+	TRACE_UNIFORM_1IV,
+	TRACE_UNIFORM_2IV,
+	TRACE_UNIFORM_3IV,
+	TRACE_UNIFORM_4IV,
+	TRACE_UNIFORM_1UIV,
+	TRACE_UNIFORM_MATRIX_2FV,
+	TRACE_UNIFORM_MATRIX_3FV,
+	TRACE_UNIFORM_MATRIX_4FV
+};
+
+/* File layout: a GLTraceHeader, then the commands. A command is a GL_Trace_Command and the byte size of its
+ * arguments, both uint32_t, followed by the arguments padded to 8 bytes. Blobs (buffer and texture contents,
+ * shader sources, arrays) are a uint64_t size and the bytes, starting on an 8 byte boundary so the replay can
+ * hand them to GL in place. */
+#define GL_TRACE_MAGIC 0x54474C41	// "ALGT"
+#define GL_TRACE_VERSION 1
+
+struct GLTraceHeader {
+	uint32_t magic;
+	uint32_t version;
+	/* Size of the default framebuffer, the replay renders into an offscreen target of this size instead. */
+	int32_t width, height;
+};
+
+/* Records the GL calls of the application into a binary trace that GLTraceReplayer can run without the
+ * application or its assets.
+ *
+ * start() swaps the glad function pointers for hooks that write each call with its arguments, including the
+ * buffer and texture data it uploads, and then call the driver. It has to run right after the GL functions are
+ * loaded, so every object the captured frames use is created on the record. Setup before the first frame and the
+ * captured frames are kept in full, the frames in between lose their output (draws, clears, blits, reads and
+ * waits), which is what makes a late frame affordable to capture. After the last captured frame the original pointers are put
+ * back and the application runs at full speed again. Without start() nothing is hooked and nothing is paid.
+ *
+ * Only the entry points the renderer uses are hooked, a call to any other GL function goes untraced. */
+class GLTraceRecorder {
+public:
+	static GLTraceRecorder& get();
+
+	/* Frames firstFrame to firstFrame + frameCount - 1 are captured, width and height give the size of the default
+	 * framebuffer. */
+	bool start(const string &path, int firstFrame, int frameCount, int width, int height);
+	/* Marks the frames, call them around the whole frame. */
+	void beginFrame();
+	void endFrame();
+	/* Puts the GL functions back and closes the trace. Called by endFrame() after the last captured frame. */
+	void stop();
+	bool isRecording() const { return recording; }
+
+	/* Encoding, used by the hooks. */
+	/* Output commands are dropped between the first frame and the first captured one. */
+	bool keepOutput() const { return !inFrames || frame >= firstFrame; }
+	void beginCommand(GL_Trace_Command command);
+	template <typename T>
+	void put(const T &value)
+	{
+		const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+		command.insert(command.end(), bytes, bytes + sizeof(T));
+	}
+	void putBlob(const void *data, size_t size);
+	void putString(const char *text) { putBlob(text, std::strlen(text) + 1); }
+	void endCommand();
+
+private:
+	std::ofstream file;
+	bool recording = false;
+	bool inFrames = false;
+	int frame = 0;
+	int firstFrame = 0;
+	int frameCount = 0;
+	/* The command being encoded, written out by endCommand(). */
+	vector<unsigned char> command;
+
+	GLTraceRecorder() = default;
+	GLTraceRecorder(const GLTraceRecorder&) = delete;
+	GLTraceRecorder& operator=(const GLTraceRecorder&) = delete;
+};
+
+/* Runs a trace written by GLTraceRecorder. Everything before the captured frames is executed once to recreate
+ * the objects and state, then the captured frames are executed loops times, each timed as a frame of the
+ * benchmark (CPU frame time plus a "replay" GPU pass). Object names, uniform locations and block indices are
+ * translated from the recorded values to the ones the replay context hands out, and the default framebuffer
+ * is replaced by an OffscreenTarget, so a headless context can replay a trace recorded in a window.
+ *
+ * Commands are decoded while they execute, the CPU times include that decoding but not any application work. */
+class GLTraceReplayer {
+public:
+	GLTraceReplayer();
+
+	bool load(const string &path);
+
+	int getWidth() const { return header.width; }
+	int getHeight() const { return header.height; }
+	/* Frames per loop. */
+	int capturedFrames() const { return frames; }
+
+	void run(Benchmark &benchmark, int loops);
+
+	/* Deletes everything the replay created. */
+	void deleteObjects();
+
+private:
+	/* Commands, kept as 64 bit words so every blob is aligned in memory the way it is in the file. */
+	vector<uint64_t> words;
+	size_t byteSize;
+	size_t captureOffset;
+	int frames;
+	GLTraceHeader header;
+
+	OffscreenTarget defaultTarget;
+	bool drawDefault, readDefault;
+	unsigned int currentProgram;
+	std::map<unsigned int, unsigned int> names[TRACE_OBJECT_TYPES];
+	/* Per replayed program: recorded uniform location or block index -> replayed one. */
+	std::map<unsigned int, std::map<int, int>> uniformLocations;
+	std::map<unsigned int, std::map<unsigned int, unsigned int>> blockIndices;
+	std::map<uint64_t, GLsync> syncs;
+	std::map<GLenum, void*> mappedBuffers;
+	/* Destination of reads into client memory. */
+	vector<unsigned char> scratch;
+
+	const unsigned char* bytes() const { return reinterpret_cast<const unsigned char*>(words.data()); }
+	unsigned int translate(GL_Trace_Object type, unsigned int name) const;
+	int translateLocation(int location) const;
+	GLenum translateBuffer(GLenum buffer, bool draw) const;
+	/* Executes the commands in [begin, end). With a benchmark every frame is timed. */
+	void execute(size_t begin, size_t end, Benchmark *benchmark);
+};
+
+#endif
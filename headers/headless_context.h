@@ -0,0 +1,72 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <vector>
+
+using std::vector;
+
+/* How the context was made. The backends are chosen at build time: AURORA_HEADLESS_EGL needs libEGL with
+ * EGL_MESA_platform_surfaceless and EGL_KHR_surfaceless_context, AURORA_HEADLESS_OSMESA needs libOSMesa. With
+ * both defined EGL is tried first. */
+enum Headless_Backend {
+	HEADLESS_BACKEND_NONE,
+	HEADLESS_BACKEND_EGL,		// surfaceless EGL display, there is no default framebuffer at all
+	HEADLESS_BACKEND_OSMESA		// software rendering into a client memory buffer, the default framebuffer exists
+};
+
+/* OpenGL context without a window or a display server, for batch rendering and benchmarks on machines without a
+ * GPU or an X server (Mesa llvmpipe works with either backend). Everything visible has to be drawn into a
+ * framebuffer object, see OffscreenTarget and FrameWriter.
+ *
+ * Asks for 4.3 core like the windowed path and falls back to 3.3 core. */
+class HeadlessContext {
+public:
+	HeadlessContext();
+	~HeadlessContext();
+
+	/* Creates the context and makes it current on this thread. */
+	bool create(int width, int height);
+	/* Loads the GL function pointers through the backend, call after create(). */
+	bool loadGL();
+	void destroy();
+
+	Headless_Backend getBackend() const { return backend; }
+	static const char* backendName(Headless_Backend backend);
+
+private:
+	Headless_Backend backend;
+	/* EGLDisplay and EGLContext, kept opaque so EGL stays out of the header. */
+	void *eglDisplay;
+	void *eglContext;
+	/* OSMesaContext and the color buffer it renders into. */
+	void *osmesaContext;
+	vector<unsigned char> osmesaBuffer;
+
+	bool createEGL();
+	bool createOSMesa(int width, int height);
+};
+
+/* Color and depth-stencil renderbuffers to draw a frame into when there is no window. */
+class OffscreenTarget {
+public:
+	unsigned int FBO;
+
+	OffscreenTarget();
+
+	void create(int width, int height);
+	void bind();
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	void deleteBuffers();
+
+private:
+	int width, height;
+	unsigned int colorBuffer;
+	unsigned int depthBuffer;
+};
+
+#endif
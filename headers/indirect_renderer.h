@@ -0,0 +1,89 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "shader.h"
+#include "geometry_arena.h"
+
+using std::vector;
+
+/* Per instance attribute locations. They sit above the ones used by VERTEX_FORMAT_MESH (0 - 6). */
+#define INSTANCE_MODEL_LOCATION 8		// mat4, occupies 8 - 11
+#define INSTANCE_MATERIAL_LOCATION 12	// vec4 (metallic, roughness, ao, unused)
+
+/* Layout mandated by the GL spec for glMultiDrawElementsIndirect. */
+struct DrawElementsIndirectCommand {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+/* Data read by the vertex shader through instanced attributes. baseInstance of each command points at the first one. */
+struct InstanceData {
+	glm::mat4 model;
+	glm::vec4 material;
+};
+
+/* Collects the draws of a pass on the CPU and submits them with one glMultiDrawElementsIndirect call per
+ * vertex format and primitive mode. Needs a 4.3 context, on older contexts submit() falls back to one
+ * glDrawElementsBaseVertex per draw with the instance data uploaded as uniforms. */
+class IndirectRenderer {
+public:
+	IndirectRenderer();
+
+	/* True if the current context can run the indirect path. */
+	static bool supported();
+
+	/* Use the fallback path even on 4.3 contexts, e.g. for comparing the two. */
+	void setEnabled(bool enable);
+	bool enabled() const { return useIndirect; }
+
+	/* Clears the draws recorded for the previous pass. */
+	void begin();
+
+	void add(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec4 &material = glm::vec4(0.0f));
+	/* Records one command that draws the geometry once per instance. A materialIndex of 0 or above replaces
+	 * material.w of every instance, which is where the atlas shaders read the material table index from. */
+	void addInstanced(const GeometryHandle &geometry, const InstanceData *instances, unsigned int count, int materialIndex = -1);
+
+	/* Draws everything recorded since begin(). The indirect shader reads the instanced attributes, the fallback
+	 * shader takes them as "model", "metallic", "roughness", "ao" and "materialIndex" uniforms instead. */
+	void submit(Shader &indirectShader, Shader &fallbackShader);
+
+	unsigned int drawCount() const { return static_cast<unsigned int>(draws.size()); }
+
+	void deleteBuffers();
+
+private:
+	struct PendingDraw {
+		GeometryHandle geometry;
+		unsigned int firstInstance;
+		unsigned int instanceCount;
+	};
+
+	bool useIndirect;
+	unsigned int commandBuffer;
+	unsigned int instanceBuffer;
+	unsigned int commandCapacity;
+	unsigned int instanceCapacity;
+	/* Arena VAOs that already have the instance attributes pointing at instanceBuffer. */
+	vector<unsigned int> attachedVAOs;
+
+	vector<PendingDraw> draws;
+	vector<InstanceData> instances;
+	vector<DrawElementsIndirectCommand> commands;
+
+	void createBuffers();
+	void attachInstanceAttributes(Vertex_Format format);
+	void submitIndirect();
+	void submitFallback(Shader &shader);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "shader.h"
+
+using std::vector;
+
+/* Froxel grid: screen tiles in x and y, exponential depth slices in z. */
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+#define CLUSTER_COUNT (CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z)
+/* Lights past this many in one cluster are dropped from it. Must fit the 8 bit count in the grid texels. */
+#define MAX_LIGHTS_PER_CLUSTER 128
+/* Light indices are stored as 16 bit. */
+#define MAX_CLUSTERED_LIGHTS 65535
+
+/* A point light as the clustered shaders see it. Attenuation is 1 / (constant + linear * d + quadratic * d^2),
+ * faded out to zero at radius so the light can be dropped from clusters it does not reach. */
+struct PointLight {
+	glm::vec3 position;		// world space
+	float radius;
+	glm::vec3 color;
+	float pad0 = 0.0f;
+	glm::vec3 attenuation = glm::vec3(0.0f, 0.0f, 1.0f);	// constant, linear, quadratic
+	float pad1 = 0.0f;
+};
+
+/* Distance at which a light's contribution falls below minIntensity, for the attenuation stored in the light. */
+float lightRadius(const glm::vec3 &color, const glm::vec3 &attenuation, float minIntensity = 5.0f / 256.0f);
+
+/* Assigns lights to the froxels of the view frustum on the CPU, so that shaders only loop over the lights that
+ * can reach the fragment's cluster (shaders/common/clusters.glsl).
+ *
+ * Everything lives in texture buffers, which the 3.3 core profile has: the lights (3 RGBA32F texels each), one
+ * R32UI texel per cluster holding offset << 8 | count into the index list, and the index list itself as R16UI.
+ * Binning tests the light's bounding sphere against the view space box of every cluster in the depth slices the
+ * sphere touches, four clusters at a time with SSE where available. */
+class LightClusters {
+public:
+	LightClusters();
+
+	/* Rebuilds the cluster boxes, needed whenever the projection or the framebuffer size changes. */
+	void setProjection(float fovy, float aspect, float zNear, float zFar, int width, int height);
+
+	/* Bins the lights for this view and uploads the lists. */
+	void update(const glm::mat4 &view, const vector<PointLight> &lights);
+
+	/* Points the shader's cluster samplers at units firstUnit .. firstUnit + 2 and sets the grid parameters. */
+	void setupShader(Shader &shader, unsigned int firstUnit);
+	void bind(unsigned int firstUnit);
+
+	/* Total number of light references written by the last update, a measure of the shading cost. */
+	unsigned int indexCount() const { return static_cast<unsigned int>(indices.size()); }
+
+	void deleteBuffers();
+
+private:
+	float zNear, zFar;
+	float tileWidth, tileHeight;
+
+	/* View space cluster boxes, structure of arrays so four neighbours in x load as one vector. */
+	vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+	/* View space depth of every slice boundary, CLUSTER_GRID_Z + 1 entries. */
+	vector<float> sliceDepth;
+
+	vector<unsigned short> clusterLights;	// MAX_LIGHTS_PER_CLUSTER scratch entries per cluster
+	vector<unsigned int> clusterCounts;
+	vector<unsigned int> grid;
+	vector<unsigned short> indices;
+
+	unsigned int lightBuffer, gridBuffer, indexBuffer;
+	unsigned int lightTexture, gridTexture, indexTexture;
+
+	void createBuffers();
+	void binLight(unsigned short index, const glm::vec3 &center, float radius);
+	static void upload(unsigned int buffer, const void *data, size_t size);
+};
+
+#endif
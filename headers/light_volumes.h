@@ -0,0 +1,54 @@
+#ifndef LIGHT_VOLUMES_H
+#define LIGHT_VOLUMES_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "geometry_arena.h"
+#include "light_clusters.h"
+#include "shader.h"
+
+using std::vector;
+
+/* How a light volume is limited to the pixels it actually reaches. */
+enum Light_Volume_Mode {
+	LIGHT_VOLUME_DEPTH,		// one pass per light: back faces with GL_GEQUAL, shades everything in front of the far side
+	LIGHT_VOLUME_STENCIL	// two passes per light: depth fail stencil marks the pixels inside the sphere, then shades only those
+};
+
+/* Deferred lighting that draws a bounding sphere per light instead of looping over every light for every pixel
+ * (deferred_shading.fs). The radius comes from the light's attenuation (lightRadius()), so each light only costs
+ * the pixels its sphere covers, and the result is added up with additive blending.
+ *
+ * render() draws into the bound framebuffer, which must share the G-buffer's depth-stencil texture
+ * (GBuffer::depthTexture) as its depth attachment. The shaders are light_volume.vs
+ * with light_volume.fs built three ways: plain for the lights, with STENCIL_PASS for the stencil marking and with
+ * AMBIENT_PASS for the full screen ambient term. Their G-buffer samplers have to point at the units the caller
+ * binds the G-buffer to (GBuffer::setupShader). */
+class LightVolumeRenderer {
+public:
+	LightVolumeRenderer();
+
+	void setMode(Light_Volume_Mode newMode) { mode = newMode; }
+	Light_Volume_Mode getMode() const { return mode; }
+
+	void render(Shader &lightShader, Shader &stencilShader, Shader &ambientShader, const vector<PointLight> &lights,
+		const glm::mat4 &view, const glm::mat4 &projection, int width, int height);
+
+	/* Lights that survived culling in the last render(). */
+	unsigned int volumeCount() const { return volumes; }
+
+	void deleteGeometry();
+
+private:
+	Light_Volume_Mode mode;
+	GeometryHandle sphere;
+	unsigned int volumes;
+
+	void createGeometry();
+};
+
+#endif
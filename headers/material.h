@@ -0,0 +1,103 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+using std::string;
+using std::vector;
+
+/* Uniform buffer binding point of the "MaterialParams" block. */
+#define MATERIAL_PARAMS_BINDING 3
+
+/* Texture units the frame binds for every program: the IBL maps (irradiance, prefilter, BRDF LUT), the light cluster
+ * lists (LightClusters, 3 units) and the AO inputs and targets (SSAORenderer, 6 units). Material samplers get the
+ * units from MATERIAL_TEXTURE_UNIT_BASE up. */
+#define IBL_TEXTURE_UNIT 0
+#define CLUSTER_TEXTURE_UNIT 3
+#define AO_TEXTURE_UNIT 6
+#define MATERIAL_TEXTURE_UNIT_BASE 12
+
+/* CPU copy of the "MaterialParams" std140 block. Only vec4 sized members, so the C++ layout matches std140 as is. */
+struct MaterialParams {
+	glm::vec4 albedo = glm::vec4(1.0f);			// rgb colour, a unused
+	glm::vec4 surface = glm::vec4(0.0f, 0.5f, 1.0f, 32.0f);	// metallic, roughness, ao, shininess
+};
+
+/* A texture bound by a material together with the sampler uniform it feeds. The unit is the sampler's, see
+ * Material::samplerUnit(), filled in by the Material. */
+struct MaterialTexture {
+	GLenum target;
+	unsigned int id;
+	string uniformName;
+	int unit = -1;
+};
+
+/* One uniform buffer holding the parameter blocks of every material, each at an offset aligned to
+ * GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT so it can be bound with glBindBufferRange. */
+class MaterialBlockPool {
+public:
+	static MaterialBlockPool& get();
+
+	/* Returns the byte offset of a new block holding params, reusing freed blocks first. */
+	unsigned int allocate(const MaterialParams &params);
+	void update(unsigned int offset, const MaterialParams &params);
+	/* Returns a block to the pool. */
+	void free(unsigned int offset);
+
+	unsigned int getBuffer() const { return UBO; }
+
+	void deleteBuffer();
+
+private:
+	unsigned int UBO = 0;
+	unsigned int blockStride = 0;
+	unsigned int capacity = 0;
+	unsigned int count = 0;
+	/* CPU copy, needed to refill the buffer when it grows. */
+	vector<unsigned char> blocks;
+	vector<unsigned int> freeOffsets;
+
+	MaterialBlockPool() = default;
+	MaterialBlockPool(const MaterialBlockPool&) = delete;
+	MaterialBlockPool& operator=(const MaterialBlockPool&) = delete;
+};
+
+/* Textures and parameters of a surface, resolved ahead of time. Binding it costs one glBindBufferRange and one
+ * glBindTexture per texture. Every sampler name has one texture unit for all materials, so materials with different
+ * texture sets can share a program: the units and the block binding are written into a shader's program the first
+ * time a material is bound with it, and again only when new sampler names appeared since. */
+class Material {
+public:
+	vector<MaterialTexture> textures;
+	MaterialParams params;
+
+	Material() = default;
+	Material(const vector<MaterialTexture> &textures, const MaterialParams &params);
+
+	/* Uploads changed parameters into the material's block. */
+	void setParams(const MaterialParams &newParams);
+
+	/* Binds textures and the parameter block for drawing with the shader, which must be in use. */
+	void bind(Shader &shader);
+
+	/* Returns the parameter block to the pool. Copies of this material must not be bound afterwards. */
+	void release();
+
+	/* Texture unit of a sampler uniform, assigned in order of first use from MATERIAL_TEXTURE_UNIT_BASE. -1 once
+	 * the units run out. */
+	static int samplerUnit(const string &uniformName);
+
+private:
+	int blockOffset = -1;
+
+	static void resolve(Shader &shader);
+};
+
+#endif
@@ -10,6 +10,8 @@
 #include <vector>
 
 #include "shader.h"
+#include "geometry_arena.h"
+#include "material.h"
 
 using std::string;
 using std::vector;
@@ -42,22 +44,40 @@ public:
 	vector<Vertex> vertices;
 	vector<unsigned int> indices;
 	vector<Texture> textures;
-	unsigned int VAO;
+	/* Location of the vertex and index data inside the shared geometry arena. */
+	GeometryHandle geometry;
+	/* Bounding sphere in model space, used for culling. */
+	glm::vec3 boundsCenter = glm::vec3(0.0f);
+	float boundsRadius = 0.0f;
+	/* Index into the texture atlas material table, -1 if the mesh binds its own textures. */
+	int materialIndex = -1;
 	
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures);
+	/* Textures and parameters resolved into a material block when the mesh is created. */
+	Material material;
+	
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const MaterialParams& params = MaterialParams());
 
 	/* Draw Call: Draws the corresponding mesh using the shader program passed to it as parameter. */
 	void Draw(Shader& shader);
 
-private:
+	/* Binds the mesh material: its parameter block and its textures on the units of their sampler names. */
+	void bindTextures(Shader& shader);
+
+	/* True if both meshes use the exact same set of textures, i.e. they can be drawn in one batch. */
+	bool sharesTextures(const Mesh& other) const;
 
-	/* Render Data */
-	unsigned int VBO, EBO;
+	/* Returns the vertex and index ranges to the geometry arena and the material block to its pool. Copies of this
+	 * mesh must not be drawn afterwards. */
+	void release();
 
-	/* - Create buffer and vertex array objects. 
-	   - Assign correct Vertex attribute pointers to the VAO */
+private:
+
+	/* Copy the vertex and index data into the geometry arena. */
 	void setupMesh();
 
+	/* Build the material from the texture list, naming each sampler "material.<type><number>". */
+	void setupMaterial(const MaterialParams& params);
+
 };
 
 #endif
\ No newline at end of file
@@ -5,34 +5,67 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "shader.h"
 #include "mesh.h"
+#include "indirect_renderer.h"
+#include "texture_atlas.h"
+#include "gl_resources.h"
 #include "stb_image.h"
 
 using std::vector;
 
+/* Meshes that share all of their textures. They are drawn with one texture bind set and a single multi draw call.
+ * Meshes are kept as indices into Model::meshes, which stay valid when the model is copied or moved. */
+struct MeshBatch {
+	unsigned int firstMesh;
+	vector<unsigned int> meshes;
+};
+
 class Model
 {
 public:
 	vector<Mesh> meshes;
 	string directory;
 	vector<Texture> textures_loaded;
+	/* Owns the GL textures behind textures_loaded. */
+	vector<GLTexture> textureObjects;
+	vector<MeshBatch> batches;
+	/* If set, textures are packed into the atlas and meshes reference them through materialIndex. */
+	TextureArrayAtlas *atlas;
 	bool gammaCorrection;
 
-	Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+	Model(string const &path, bool gamma = false, TextureArrayAtlas *atlas = nullptr) : atlas(atlas), gammaCorrection(gamma)
 	{
 		loadModel(path);
 	}
 	void Draw(Shader &shader);
+	/* Draws every instance of the model with one indirect multi draw per texture batch. If the renderer
+	 * is not enabled, falls back to Draw() once per instance with the model matrix set as a uniform.
+	 * The batches are recorded and submitted right away, each one through begin(), which discards whatever the
+	 * renderer had pending. Give it a renderer of its own, not one between begin() and submit() of a frame. */
+	void DrawIndirect(IndirectRenderer &renderer, Shader &indirectShader, Shader &fallbackShader, const InstanceData *instances, unsigned int count);
+	/* Returns the mesh geometry and material blocks to their pools and deletes the textures. The model must not be
+	 * drawn afterwards. */
+	void release();
 private:
 
 	void loadModel(string const &path);
 	void processNode(aiNode *node, const aiScene *scene);
+	void buildBatches();
 	Mesh processMesh(aiMesh *mesh, const aiScene *scene);
 	vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName);
+	MaterialParams loadMaterialParams(aiMaterial* mat);
+	/* Registers the material textures with the atlas, returns the material table index. */
+	int loadAtlasMaterial(aiMaterial* mat);
+	TextureLayer loadAtlasTexture(aiMaterial* mat, aiTextureType type);
+	/* Material table index per assimp material index, so every material is added to the atlas once. */
+	std::map<unsigned int, int> atlasMaterials;
+	/* Geometry of the batch being drawn, gathered again on every Draw(). */
+	vector<const GeometryHandle*> batchGeometry;
 };
 
 
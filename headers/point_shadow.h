@@ -0,0 +1,114 @@
+#ifndef POINT_SHADOW_H
+#define POINT_SHADOW_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "geometry_arena.h"
+#include "mesh.h"
+#include "shader.h"
+#include "shadow_caster.h"
+
+using std::vector;
+
+/* Omnidirectional shadow map of a point light, stored as light distance / far plane in a depth cubemap with
+ * hardware comparison enabled, as read by common/point_shadow.glsl.
+ *
+ * Every caster is culled against the six 90 degree face frustums on the CPU and only drawn into the faces it can
+ * appear in, instead of a geometry shader emitting every triangle six times. When the driver lets the vertex
+ * shader pick the layer (GL_ARB_shader_viewport_layer_array or GL_AMD_vertex_shader_layer) all faces of a caster
+ * are one instanced draw into the layered cubemap, otherwise the faces are rendered as six separate passes.
+ *
+ * Static casters are drawn into a second cubemap that is kept between frames. Each frame it is copied into the
+ * sampled cubemap with a depth blit and only the dynamic casters are drawn on top. The static map is redrawn only
+ * when the light moves or when a static caster within reach of the light was added, removed or moved (found by
+ * comparing the list with the previous frame's), and when nothing dynamic is in range and nothing changed the
+ * frame costs no GL work at all. With setViewer() the update is also skipped while the light cannot affect
+ * the view or is beyond the distance budget; the changes are remembered and applied once it is back.
+ *
+ * The depth shader is simpleDepth.vs/simpleDepth.fs built with getShaderDefines(). */
+class PointShadowRenderer {
+public:
+	PointShadowRenderer();
+
+	/* (Re)creates the cubemap with faces of size x size texels and picks the layered path if it is supported. */
+	void create(int size);
+
+	/* Forces the per face passes even if layered rendering is available, the depth shader has to be rebuilt. */
+	void setLayered(bool enable);
+	bool isLayered() const { return layered; }
+	/* Defines the depth shader must be built with for the current path. */
+	const ShaderDefines& getShaderDefines() const { return shaderDefines; }
+
+	void setPlanes(float nearPlane, float farPlane);
+	float getFarPlane() const { return farPlane; }
+
+	/* Clears the caster list. */
+	void begin();
+	/* Adds a caster by its bounding sphere in model space. Static casters must be added in the same order every
+	 * frame, a different order reads as a change and redraws the static map. */
+	void addCaster(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec3 &center, float radius, bool dynamic = false);
+	void addMesh(const Mesh &mesh, const glm::mat4 &model, bool dynamic = false);
+	/* Forces the static map to be redrawn on the next update. */
+	void invalidate() { staticDirty = true; }
+
+	/* Camera the shadow is seen from: updates are skipped if the light's range is outside the view frustum or
+	 * further than maxDistance from the camera. */
+	void setViewer(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos, float maxDistance);
+
+	/* Brings the cubemap up to date with the casters added since begin(), drawing as little as possible. Restores
+	 * the framebuffer binding to 0 and the viewport to what it was before. */
+	void render(Shader &depthShader, const glm::vec3 &lightPos);
+
+	unsigned int getCubemap() const { return depthCubemap; }
+	/* Caster face pairs drawn by the last render(), at most six per caster. */
+	unsigned int facesDrawn() const { return faceDraws; }
+	/* True if the last render() had to redraw the static map. */
+	bool staticRedrawn() const { return staticUpdated; }
+	/* True if the last render() skipped the update because the light is out of view or over the budget. */
+	bool updateSkipped() const { return skipped; }
+
+	void deleteBuffers();
+
+private:
+	int size;
+	float nearPlane, farPlane;
+	bool layered;
+	bool layeredAllowed;
+	ShaderDefines shaderDefines;
+	unsigned int FBO, staticFBO;
+	unsigned int depthCubemap, staticCubemap;
+	vector<ShadowCaster> staticCasters, dynamicCasters;
+	/* Static casters of the previous render(), compared against to find changes. */
+	vector<ShadowCaster> previousStatic;
+	/* Bit f set if caster i is inside the frustum of cube face f. */
+	vector<unsigned int> staticMasks, dynamicMasks;
+	unsigned int faceDraws;
+
+	/* Cache state. */
+	glm::vec3 cachedLightPos;
+	bool staticDirty;
+	/* The sampled cubemap holds dynamic casters on top of the static map and needs a fresh copy. */
+	bool hasDynamic;
+	bool staticUpdated;
+	bool skipped;
+
+	bool viewerSet;
+	glm::vec4 viewPlanes[6];
+	glm::vec3 cameraPos;
+	float maxDistance;
+
+	void selectPath();
+	/* Bit mask of the faces whose frustum the sphere intersects, 0 if it is beyond the far plane. */
+	unsigned int cullFaces(const glm::vec3 &lightPos, const glm::vec3 &center, float radius) const;
+	/* True if a static caster within reach of the light differs from the previous frame. */
+	bool staticCastersChanged(const glm::vec3 &lightPos) const;
+	bool inView(const glm::vec3 &lightPos) const;
+	void drawCasters(const vector<ShadowCaster> &list, const vector<unsigned int> &masks, unsigned int texture, bool clear, int modelloc, int faceOrderloc);
+	void copyStaticMap();
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+/* Scopes are compiled in for debug builds, and for release builds that define AURORA_PROFILE. Otherwise the
+ * PROFILE_* macros expand to nothing and the profiler costs nothing at all. */
+#if !defined(NDEBUG) || defined(AURORA_PROFILE)
+#define AURORA_PROFILING 1
+#else
+#define AURORA_PROFILING 0
+#endif
+
+/* Frames in flight: the queries of a frame are read this many frames later, when the GPU is long done with them. */
+#define PROFILER_FRAMES 3
+
+/* Aggregated timings of one scope, in milliseconds. Scopes are identified by their path, "frame/scene". */
+struct ProfileStats {
+	string path;
+	string name;
+	int depth = 0;
+	bool gpu = false;
+	unsigned int count = 0;
+	double cpuLast = 0.0, cpuTotal = 0.0, cpuMin = 0.0, cpuMax = 0.0, cpuRecent = 0.0;
+	double gpuLast = 0.0, gpuTotal = 0.0, gpuMin = 0.0, gpuMax = 0.0, gpuRecent = 0.0;
+};
+
+/* One complete event of a trace, times in milliseconds since the profiler's epoch. */
+struct TraceEvent {
+	const char *name;
+	unsigned int thread;	// TRACE_MAIN_THREAD, TRACE_GPU_THREAD or a worker
+	unsigned int frame;
+	double start, duration;
+};
+
+/* Thread ids in the trace, workers are numbered from TRACE_FIRST_WORKER in order of their first event. */
+#define TRACE_MAIN_THREAD 1
+#define TRACE_GPU_THREAD 2
+#define TRACE_FIRST_WORKER 3
+
+/* Hierarchical CPU and GPU profiler. A scope measures the CPU time between its construction and destruction, and
+ * GPU scopes also the GPU time between the two points of the command stream, through a pair of GL_TIMESTAMP
+ * queries. Timestamps, unlike GL_TIME_ELAPSED, nest freely and can be mixed with elapsed queries used elsewhere
+ * (SSAORenderer, Benchmark).
+ *
+ * Every frame gets its own set of queries out of PROFILER_FRAMES, and they are only read back when that set comes
+ * around again, so reading the results never waits for the GPU. The statistics therefore lag PROFILER_FRAMES
+ * frames behind.
+ *
+ * Use the macros, not the classes: PROFILE_GPU_SCOPE("ssao") or PROFILE_CPU_SCOPE("cluster binning") at the top of
+ * a block, PROFILE_FRAME_BEGIN() and PROFILE_FRAME_END() around the frame. Names must be string literals or
+ * otherwise outlive the frame. Those scopes belong to the thread that owns the GL context, other threads use
+ * PROFILE_THREAD_SCOPE("decode"), which only shows up in traces.
+ *
+ * While tracing, every scope is also kept as an event and writeTrace() saves them in the Chrome trace format, which
+ * chrome://tracing and Perfetto open as one timeline with a track for the main thread, one for the GPU and one per
+ * worker. GPU timestamps are moved onto the CPU clock with an offset measured through glGetInteger64v(GL_TIMESTAMP)
+ * once per frame, so drift between the two clocks never builds up. */
+class Profiler {
+public:
+	static Profiler& get();
+
+	void beginFrame();
+	void endFrame();
+
+	/* Returns the index to pass to endScope(). */
+	int beginScope(const char *name, bool gpu);
+	void endScope(int index);
+
+	/* Every scope seen so far, in order of first appearance, which puts children right after their parents. */
+	const vector<ProfileStats>& getStats() const { return stats; }
+	/* One line with the recent times of the scopes up to maxDepth, "scene 1.20/0.85 ms" (cpu/gpu). */
+	string summary(int maxDepth) const;
+	/* Resolves the frames still in flight, waiting for the GPU. Call it before the final reports. */
+	void flush();
+	/* Writes the aggregated statistics as JSON. */
+	bool writeReport(const string &path) const;
+
+	/* Starts or stops keeping trace events. Stopping keeps the events recorded so far. */
+	void setTracing(bool enable);
+	bool isTracing() const { return tracing; }
+	/* Adds a CPU event on the calling thread's track, safe to call from any thread. */
+	void addThreadEvent(const char *name, double start, double end);
+	/* Writes the trace events recorded so far as Chrome trace JSON. */
+	bool writeTrace(const string &path);
+
+	/* Milliseconds since the profiler was created, the clock of every event. */
+	double now() const;
+
+	void deleteQueries();
+
+private:
+	struct Record {
+		const char *name;
+		int parent;
+		int depth;
+		int startQuery, endQuery;	// into the frame's query pool, -1 for CPU only scopes
+		double cpuStart, cpuEnd;
+	};
+	struct FrameSlot {
+		vector<Record> records;
+		vector<unsigned int> queries;
+		unsigned int usedQueries = 0;
+		/* CPU time minus GPU time in milliseconds, measured when the slot's first GPU scope began. */
+		double gpuOffset = 0.0;
+		bool calibrated = false;
+		double frameStart = -1.0, frameEnd = -1.0;
+		unsigned int frameNumber = 0;
+	};
+
+	FrameSlot frames[PROFILER_FRAMES];
+	unsigned int current = 0;
+	int openScope = -1;
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	vector<ProfileStats> stats;
+	std::map<string, unsigned int> statIndex;
+	std::atomic<unsigned int> frameCount{ 0 };
+
+	std::atomic<bool> tracing{ false };
+	/* Guards traceEvents and workerThreads, everything else belongs to the GL thread. */
+	std::mutex traceMutex;
+	vector<TraceEvent> traceEvents;
+	std::map<std::thread::id, unsigned int> workerThreads;
+	std::thread::id mainThread;
+
+	Profiler() = default;
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	int allocateQuery(FrameSlot &slot);
+	/* Reads the queries of the slot and folds its records into the statistics, then empties it. */
+	void resolve(FrameSlot &slot);
+	void calibrate(FrameSlot &slot);
+};
+
+/* RAII helper behind the PROFILE_*_SCOPE macros. */
+class ProfileScope {
+public:
+	ProfileScope(const char *name, bool gpu) : index(Profiler::get().beginScope(name, gpu)) {}
+	~ProfileScope() { Profiler::get().endScope(index); }
+
+private:
+	int index;
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+/* RAII helper behind PROFILE_THREAD_SCOPE, only records while tracing. */
+class ThreadScope {
+public:
+	ThreadScope(const char *name) : name(name), start(Profiler::get().isTracing() ? Profiler::get().now() : -1.0) {}
+	~ThreadScope()
+	{
+		if (start >= 0.0) {
+			Profiler::get().addThreadEvent(name, start, Profiler::get().now());
+		}
+	}
+
+private:
+	const char *name;
+	double start;
+
+	ThreadScope(const ThreadScope&) = delete;
+	ThreadScope& operator=(const ThreadScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#if AURORA_PROFILING
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+#define PROFILE_CPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_THREAD_SCOPE(name) ThreadScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FRAME_BEGIN() Profiler::get().beginFrame()
+#define PROFILE_FRAME_END() Profiler::get().endFrame()
+#else
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_CPU_SCOPE(name)
+#define PROFILE_THREAD_SCOPE(name)
+#define PROFILE_FRAME_BEGIN()
+#define PROFILE_FRAME_END()
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "gl_resources.h"
+
+using std::string;
+using std::vector;
+
+/* A render target the graph allocates. internalFormat, format and type go to glTexImage2D, a GL_DEPTH_COMPONENT or
+ * GL_DEPTH_STENCIL format makes it the depth attachment of the passes writing it. */
+struct RenderTargetDesc {
+	GLenum internalFormat = GL_RGBA8;
+	GLenum format = GL_RGBA;
+	GLenum type = GL_UNSIGNED_BYTE;
+	/* Size relative to the graph's, unless width and height are set. */
+	float scale = 1.0f;
+	int width = 0, height = 0;
+	/* More than 0 makes a GL_TEXTURE_2D_MULTISAMPLE, read it back through RenderGraph::blit(). */
+	int samples = 0;
+	GLenum filter = GL_LINEAR;
+};
+
+/* Index of a texture or framebuffer in the graph. */
+typedef int RenderResource;
+
+/* Frame graph: passes declare the resources they read and write, and the graph works out the rest.
+ *
+ * compile() orders the passes, a pass runs after every writer of what it reads and the writers of one resource run
+ * in the order they were added, ties keep the order of addPass(). Passes that contribute nothing to an output
+ * (setOutput()) are culled. Transient textures, from createTexture(), only exist between their first and last use
+ * in that order, so two of the same format and size whose uses do not overlap share one GL texture. Their contents
+ * are undefined until the first pass writing them in the frame clears or overwrites them.
+ *
+ * Every pass writing transients gets a framebuffer with them attached, color targets in the order of write(), and
+ * execute() binds it and sets the viewport before calling the pass. A pass writing an imported framebuffer, like the
+ * default one, gets that instead, and a pass writing neither gets the default framebuffer. Passes bind what they read
+ * themselves, through getTexture().
+ *
+ * resize() changes the size every target is relative to, the targets are allocated again by the next execute(). */
+class RenderGraph {
+public:
+	RenderGraph();
+
+	RenderResource createTexture(const string &name, const RenderTargetDesc &desc);
+	/* A framebuffer made elsewhere, 0 for the default one. It has the graph's size and is never aliased. */
+	RenderResource importFramebuffer(const string &name, unsigned int framebuffer);
+	/* A texture its passes create and bind themselves, like the result of SSAORenderer. The graph only orders its
+	 * writers before its readers, it never allocates, attaches or aliases it and getTexture() returns 0. */
+	RenderResource importTexture(const string &name);
+
+	/* Adds a pass and returns its index. The name must be a string literal or otherwise outlive the graph, it names
+	 * the pass's profiler scope. */
+	int addPass(const char *name, std::function<void()> execute);
+	void read(int pass, RenderResource resource);
+	void write(int pass, RenderResource resource);
+	/* Marks a resource as a result of the frame, what it needs is kept. */
+	void setOutput(RenderResource resource);
+	/* Leaves a pass out of the benchmark passes of execute(), for passes running GPU timer queries of their own,
+	 * which cannot nest in the benchmark's. The profiler scope stays. */
+	void setBenchmarked(int pass, bool benchmarked);
+
+	void resize(int width, int height);
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	/* Orders, culls and allocates. execute() calls it when something changed, call it earlier to report on the
+	 * result. Returns false if the passes depend on each other in a cycle. */
+	bool compile();
+	/* Runs the passes that were kept, each in a GPU profiler scope and a benchmark pass of its name. */
+	void execute(Benchmark *benchmark = nullptr);
+
+	/* The texture behind a transient, valid until the next compile. */
+	unsigned int getTexture(RenderResource resource) const;
+	/* Copies a color target into the bound draw framebuffer, stretched over the viewport of the pass. Multisampled
+	 * targets are resolved on the way. */
+	void blit(RenderResource source) const;
+
+	bool isCulled(int pass) const { return !passes[pass].live; }
+	/* Bytes of the textures allocated, and what they would take without aliasing. */
+	size_t allocatedBytes() const;
+	size_t unaliasedBytes() const;
+	/* "3/4 passes, 2 targets 14.1 MB (21.1 MB unaliased)" */
+	string summary() const;
+	/* The passes in execution order with what they read and write, and which texture each transient lives in. */
+	void report(std::ostream &out) const;
+
+	void deleteTargets();
+
+private:
+	struct Resource {
+		string name;
+		RenderTargetDesc desc;
+		bool imported = false;
+		/* Imported by importTexture(), otherwise framebuffer is what importFramebuffer() was given. */
+		bool texture = false;
+		unsigned int framebuffer = 0;
+		bool output = false;
+		/* Of the last compile: texture index, -1 for culled and imported resources, and first and last use. */
+		int physical = -1;
+		int firstUse = -1, lastUse = -1;
+		int width = 0, height = 0;
+	};
+	struct Pass {
+		const char *name;
+		std::function<void()> execute;
+		vector<RenderResource> reads;
+		vector<RenderResource> writes;
+		bool live = false;
+		bool benchmarked = true;
+		GLFramebuffer framebuffer;
+		/* What execute() binds: framebuffer, or the imported one written. */
+		unsigned int target = 0;
+		int width = 0, height = 0;
+	};
+	struct Texture {
+		GLTexture texture;
+		RenderTargetDesc desc;
+		int width = 0, height = 0;
+		int lastUse = -1;
+		string label;
+	};
+
+	vector<Resource> resources;
+	vector<Pass> passes;
+	vector<int> order;
+	vector<Texture> textures;
+	int width, height;
+	bool dirty;
+	/* Pass being executed, -1 outside execute(). */
+	int currentPass;
+	/* Source of blit(). */
+	GLFramebuffer readFramebuffer;
+
+	void cull();
+	bool sort();
+	void allocate();
+	void createFramebuffers();
+
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+};
+
+#endif
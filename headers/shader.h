@@ -3,34 +3,82 @@
 
 #include <glad/glad.h>
 
+#include <map>
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+/* Preprocessor defines injected right after the #version line of every stage, name -> value.
+ * An empty value gives a plain feature flag ("#define NAME"). std::map keeps them sorted, so
+ * the same set always produces the same source and the same cache key. */
+typedef std::map<std::string, std::string> ShaderDefines;
+
 class Shader {
 public:
 
 	/* Identifier for the shader program object */
 	unsigned int ID;
 
-	/* Constructor: Reads and build the shader */
-	Shader(const char *vertexPath, const char *fragmentPath, const char* geometryPath = nullptr);
+	/* Every file the program was built from, including the ones pulled in through #include. */
+	std::vector<std::string> sourceFiles;
+
+	/* How many of the material sampler units (Material::samplerUnit) the program has, -1 before the block binding
+	 * is set. Kept by Material::bind(). */
+	int materialSamplers = -1;
+
+	/* Constructor: Reads and build the shader. Programs are cached by source and defines, so
+	 * building the same permutation twice compiles it only once. */
+	Shader(const char *vertexPath, const char *fragmentPath, const char* geometryPath = nullptr, const ShaderDefines &defines = ShaderDefines());
+	Shader(const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines);
+
+	/* Rebuilds the program from the files on disk. The new program only replaces the current one if every stage
+	 * compiled and it linked, in which case uniform values and block bindings are carried over from the old one.
+	 * On failure the errors are printed and the shader keeps drawing with the previous program. */
+	bool reload();
 
 	/* Use the shader */
 	void use();
 
 	/** Utility functions for setting Uniforms */
-	/* NOTE: Here const at the end of the function prototype means that 
-	 * this function cannot modify any of the member variables of this class. 
-	 * 
+	/* NOTE: Here const at the end of the function prototype means that
+	 * this function cannot modify any of the member variables of this class.
+	 *
 	 * If it does then this will throw a compiler error */
 	void setBool(const std::string &name, bool value) const;
 	void setInt(const std::string &name, int value) const;
 	void setFloat(const std::string &name, float value) const;
 	void setVecN(const std::string& name, float *value, int n) const;
 
+	/* Releases this reference to the program, it is deleted once no Shader uses the permutation anymore. */
 	void deleteProgram();
+
+	static std::string readFile(const std::string &path);
+	/* Loads a stage and resolves its #include "file" directives, relative to the including file. Each file is
+	 * included at most once per stage and #line directives map every line back to its file (the source string
+	 * number is the index in files). Results are cached until one of the files changes on disk. */
+	static const std::string& preprocess(const char *path, std::vector<std::string> &files);
+
+private:
+	/* Key of the program in the variant cache, empty for a program that failed to build, which is not shared. */
+	std::string cacheKey;
+
+	/* What the program is built from, kept for reload(). An empty geometryPath means no geometry stage. */
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::string geometryPath;
+	ShaderDefines defines;
+
+	/* Builds the program and takes a reference on it in the cache. Returns false if a stage did not compile or
+	 * the program did not link, failed programs are not cached. */
+	bool build(unsigned int &program, std::string &key);
+	static void copyProgramState(unsigned int from, unsigned int to);
+
+	/* Inserts the defines after #version and resets the line numbering so compile errors still point at the file. */
+	static std::string injectDefines(const std::string &source, const ShaderDefines &defines);
+	static unsigned int compileStage(GLenum type, const std::string &source, const char *stageName, const std::vector<std::string> &files, bool &compiled);
+	static unsigned int linkProgram(unsigned int vertex, unsigned int fragment, unsigned int geometry, bool &linked);
 };
 
-#endif
\ No newline at end of file
+#endif
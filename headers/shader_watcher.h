@@ -0,0 +1,68 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+using std::string;
+using std::vector;
+
+/* Watches the shader directory and reloads the programs whose sources change on disk, so shaders can be edited
+ * while the application runs. On Linux changes are picked up through inotify, elsewhere the modification times of
+ * the watched files are polled.
+ *
+ * Everything happens in update(), on the thread that owns the GL context. Editors tend to write a file several
+ * times per save, so a program is only rebuilt once its files have been quiet for a moment, and at most one program
+ * is rebuilt per call to keep the cost of a save to a single compile per frame. A program that fails to build is
+ * never swapped in (see Shader::reload), the old one keeps drawing until the next save. */
+class ShaderWatcher {
+public:
+	ShaderWatcher(const string &directory = "shaders");
+	~ShaderWatcher();
+
+	/* Registers a shader for reloading. It has to stay alive until it is removed or the watcher is destroyed. */
+	void add(Shader &shader);
+	void remove(Shader &shader);
+
+	/* Call once per frame with the current time in seconds. */
+	void update(double time);
+
+	/* Number of successful reloads so far. */
+	unsigned int reloadCount() const { return reloads; }
+
+private:
+	struct PendingReload {
+		Shader *shader;
+		double readyAt;
+	};
+
+	string directory;
+	vector<Shader*> shaders;
+	vector<PendingReload> pending;
+	unsigned int reloads = 0;
+
+#ifdef __linux__
+	int inotifyFd = -1;
+	/* Watch descriptor -> watched directory. */
+	std::map<int, string> watches;
+
+	void watchDirectory(const string &path);
+	void readEvents(vector<string> &changed);
+#else
+	std::map<string, std::filesystem::file_time_type> fileTimes;
+	double nextScan = 0.0;
+
+	void scanFiles(vector<string> &changed);
+#endif
+
+	void fileChanged(const string &path, double time);
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef SHADOW_CASTER_H
+#define SHADOW_CASTER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include "geometry_arena.h"
+
+/* Something drawn into a shadow map, with its bounding sphere in world space for culling. */
+struct ShadowCaster {
+	GeometryHandle geometry;
+	glm::mat4 model;
+	glm::vec3 center;
+	float radius;
+};
+
+/* Moves a model space bounding sphere into world space. The radius is scaled by the largest axis scale, so the
+ * sphere still encloses the mesh under non uniform scaling. */
+inline ShadowCaster makeShadowCaster(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec3 &center, float radius)
+{
+	ShadowCaster caster;
+	caster.geometry = geometry;
+	caster.model = model;
+	caster.center = glm::vec3(model * glm::vec4(center, 1.0f));
+	float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	caster.radius = radius * scale;
+	return caster;
+}
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SSAO_RENDERER_H
+#define SSAO_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+#include "shader.h"
+
+using std::vector;
+
+/* Divisor of the framebuffer size the occlusion is computed at. */
+enum SSAO_Resolution {
+	SSAO_FULL = 1,
+	SSAO_HALF = 2,
+	SSAO_QUARTER = 4
+};
+
+/* Occlusion technique, switchable at runtime. Both share the blur and upsample. */
+enum AO_Mode {
+	AO_MODE_SSAO,		// hemisphere kernel (ssao.fs)
+	AO_MODE_GTAO,		// horizon search over a depth pyramid with temporal accumulation (gtao.fs)
+	AO_MODE_COUNT
+};
+
+/* Must match MAX_KERNEL_SIZE in ssao.fs. */
+#define SSAO_MAX_KERNEL_SIZE 64
+/* Levels of the GTAO linear depth pyramid. */
+#define AO_PYRAMID_LEVELS 6
+
+/* Programs used by SSAORenderer, all built with ssao.vs. Only the ones of the active mode have to be valid. */
+struct AOShaders {
+	Shader *ssao;			// ssao.fs
+	Shader *depthPyramid;	// depth_pyramid.fs
+	Shader *gtao;			// gtao.fs
+	Shader *temporal;		// gtao_temporal.fs
+	Shader *blur;			// ssao_blur.fs
+	Shader *upsample;		// ssao_upsample.fs
+};
+
+/* Screen space ambient occlusion computed at a fraction of the framebuffer resolution, then cleaned up with a
+ * separable depth and normal aware blur and brought back to full resolution by a bilateral upsample that never
+ * mixes occlusion across depth edges.
+ *
+ * AO_MODE_SSAO samples a hemisphere kernel around each pixel. AO_MODE_GTAO marches a few screen space directions
+ * against a linear depth pyramid, integrates the visibility between the horizons found on both sides, and
+ * accumulates the result over frames with reprojection; directions rotate every frame so the history converges
+ * to many more directions than one frame takes. The defaults give about the same image from both.
+ *
+ * The inputs are the compact G-buffer textures (GBuffer) bound to gbufferUnit .. gbufferUnit + 2, with view
+ * space normals as written by ssao_geometry.fs. The result is a full resolution R8 texture. */
+class SSAORenderer {
+public:
+	SSAORenderer();
+
+	/* (Re)creates the targets for a framebuffer of the given size. */
+	void create(int width, int height);
+
+	void setMode(AO_Mode newMode);
+	void setResolution(SSAO_Resolution newResolution);
+	/* 8, 16, 32 or 64 samples, other values are rounded up to the next of those. */
+	void setKernelSize(unsigned int size);
+	/* GTAO directions per pixel and frame, and steps per direction. */
+	void setHorizonSamples(int directions, int steps) { gtaoDirections = directions; gtaoSteps = steps; }
+	void setRadius(float newRadius) { radius = newRadius; }
+	void setBias(float newBias) { bias = newBias; }
+
+	AO_Mode getMode() const { return mode; }
+	SSAO_Resolution getResolution() const { return resolution; }
+	unsigned int getKernelSize() const { return kernelSize; }
+
+	/* Runs all passes of the active mode, leaving the viewport at the full framebuffer size. */
+	void render(const AOShaders &shaders, const glm::mat4 &projection, const glm::mat4 &view, unsigned int gbufferUnit);
+
+	unsigned int getTexture() const { return outputTexture; }
+
+	/* GPU time of the most recent finished render() in the mode, in milliseconds. Read a frame late so it never stalls. */
+	float getGpuTime(AO_Mode timedMode) const { return gpuTimes[timedMode]; }
+
+	void deleteBuffers();
+
+private:
+	int width, height;
+	AO_Mode mode;
+	SSAO_Resolution resolution;
+	unsigned int kernelSize;
+	int gtaoDirections, gtaoSteps;
+	float radius, bias;
+
+	vector<glm::vec3> kernel;
+	/* Program the current kernel was uploaded to, 0 if it has to be uploaded again. */
+	unsigned int kernelProgram;
+	unsigned int noiseTexture;
+
+	/* Reduced resolution ping-pong targets and the full resolution result. */
+	unsigned int lowFBOs[2];
+	unsigned int lowTextures[2];
+	unsigned int outputFBO;
+	unsigned int outputTexture;
+
+	/* GTAO: linear view depth pyramid and RG16F (occlusion, depth) history, swapped every frame. */
+	unsigned int pyramidFBO;
+	unsigned int pyramidTexture;
+	unsigned int historyFBOs[2];
+	unsigned int historyTextures[2];
+	unsigned int historyIndex;
+	unsigned int frameIndex;
+	glm::mat4 previousViewProjection;
+
+	unsigned int timerQueries[2];
+	AO_Mode timerModes[2];
+	bool timerPending[2];
+	unsigned int timerIndex;
+	float gpuTimes[AO_MODE_COUNT];
+
+	void generateKernel();
+	void createNoise();
+	void deleteTargets();
+	void readTimer(unsigned int index);
+
+	/* Pass writing the raw occlusion into the first low resolution target. Returns the texture the blur reads. */
+	unsigned int renderSSAO(const AOShaders &shaders, const glm::mat4 &projection, unsigned int gbufferUnit);
+	unsigned int renderGTAO(const AOShaders &shaders, const glm::mat4 &projection, const glm::mat4 &view, unsigned int gbufferUnit);
+};
+
+#endif
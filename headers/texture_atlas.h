@@ -0,0 +1,93 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+
+#include "shader.h"
+
+using std::string;
+using std::vector;
+
+/* Number of texture arrays a shader can see at once. Must match MAX_MATERIAL_PAGES in buffer_atlas.fs. */
+#define MAX_MATERIAL_PAGES 4
+/* Size of the material table uniform block. Must match MAX_MATERIALS in buffer_atlas.fs. */
+#define MAX_MATERIALS 256
+/* Uniform buffer binding point of the material table. */
+#define MATERIAL_TABLE_BINDING 2
+
+/* Where a single texture ended up: a layer of one of the atlas pages. page is -1 if the texture is missing. */
+struct TextureLayer {
+	int page = -1;
+	int layer = 0;
+};
+
+/* Texture layers used by one material, laid out exactly like the std140 struct in the shader. */
+struct AtlasMaterial {
+	int diffuse[2] = { -1, 0 };		// page, layer
+	int specular[2] = { -1, 0 };
+	int normal[2] = { -1, 0 };
+	int height[2] = { -1, 0 };
+};
+
+/* Packs textures of equal size into GL_TEXTURE_2D_ARRAY pages so that meshes with different materials can be
+ * drawn with a single set of texture bindings. Materials pick their layers through a uniform buffer table
+ * indexed by a per draw material index.
+ *
+ * Textures are always expanded to RGBA8 on load, so the page key is the size alone. Textures are queued by
+ * addTexture() and uploaded by build(); a page that was already built never grows, new layers of the same
+ * size start a new page instead. */
+class TextureArrayAtlas {
+public:
+	vector<AtlasMaterial> materials;
+
+	TextureArrayAtlas();
+
+	/* Queues a texture for upload, returning the layer it will occupy. Loading the same path twice returns the same layer. */
+	TextureLayer addTexture(const string &path);
+
+	/* Adds a material to the table and returns its index, -1 if the table is full. */
+	int addMaterial(const AtlasMaterial &material);
+
+	/* Uploads every queued texture and the material table. */
+	void build();
+
+	/* Points the shader's page samplers at consecutive units starting at firstUnit and connects its material
+	 * table block. Only needs to run once per program. */
+	void setupShader(Shader &shader, unsigned int firstUnit);
+
+	/* Binds every page and the material table. This is the whole per batch cost of switching materials. */
+	void bind(unsigned int firstUnit);
+
+	unsigned int pageCount() const { return static_cast<unsigned int>(pages.size()); }
+
+	void deleteTextures();
+
+private:
+	struct PendingLayer {
+		string path;
+		unsigned char *pixels;
+	};
+
+	struct Page {
+		int width;
+		int height;
+		unsigned int texture;		// 0 until built
+		vector<PendingLayer> pending;
+	};
+
+	struct LoadedTexture {
+		string path;
+		TextureLayer layer;
+	};
+
+	vector<Page> pages;
+	vector<LoadedTexture> loaded;
+	unsigned int materialBuffer;
+
+	int findOpenPage(int width, int height);
+};
+
+#endif
@@ -0,0 +1,243 @@
+#include "headless_context.h"
+#include "gl_resources.h"
+
+#include <iostream>
+
+#ifdef AURORA_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+#ifdef AURORA_HEADLESS_OSMESA
+/* glad has already defined the GL types and keeps GL/gl.h out. */
+#include <GL/osmesa.h>
+#endif
+
+HeadlessContext::HeadlessContext() : backend(HEADLESS_BACKEND_NONE), eglDisplay(NULL), eglContext(NULL), osmesaContext(NULL)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	destroy();
+}
+
+const char* HeadlessContext::backendName(Headless_Backend backend)
+{
+	switch (backend) {
+	case HEADLESS_BACKEND_EGL:
+		return "EGL surfaceless";
+	case HEADLESS_BACKEND_OSMESA:
+		return "OSMesa";
+	default:
+		return "none";
+	}
+}
+
+bool HeadlessContext::create(int width, int height)
+{
+	if (createEGL()) {
+		backend = HEADLESS_BACKEND_EGL;
+		return true;
+	}
+	if (createOSMesa(width, height)) {
+		backend = HEADLESS_BACKEND_OSMESA;
+		return true;
+	}
+	std::cout << "ERROR::HEADLESS::NO_BACKEND" << std::endl;
+	return false;
+}
+
+bool HeadlessContext::createEGL()
+{
+#ifdef AURORA_HEADLESS_EGL
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay == NULL) {
+		std::cout << "ERROR::HEADLESS::EGL_PLATFORM_DISPLAY_UNSUPPORTED" << std::endl;
+		return false;
+	}
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		std::cout << "ERROR::HEADLESS::EGL_INITIALIZE_FAILED" << std::endl;
+		return false;
+	}
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "ERROR::HEADLESS::EGL_OPENGL_API_UNSUPPORTED" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	/* No surface will ever be made from the config, so any surface type will do. */
+	const EGLint configAttributes[] = {
+		EGL_SURFACE_TYPE, 0,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint configCount = 0;
+	if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+		std::cout << "ERROR::HEADLESS::EGL_NO_CONFIG" << std::endl;
+		eglTerminate(display);
+		return false;
+	}
+
+	EGLContext context = EGL_NO_CONTEXT;
+	const EGLint versions[2][2] = { { 4, 3 }, { 3, 3 } };
+	for (unsigned int i = 0; i < 2 && context == EGL_NO_CONTEXT; i++) {
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, versions[i][0],
+			EGL_CONTEXT_MINOR_VERSION, versions[i][1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+	}
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cout << "ERROR::HEADLESS::EGL_CONTEXT_FAILED" << std::endl;
+		if (context != EGL_NO_CONTEXT) {
+			eglDestroyContext(display, context);
+		}
+		eglTerminate(display);
+		return false;
+	}
+	eglDisplay = display;
+	eglContext = context;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool HeadlessContext::createOSMesa(int width, int height)
+{
+#ifdef AURORA_HEADLESS_OSMESA
+	OSMesaContext context = NULL;
+	const int versions[2][2] = { { 4, 3 }, { 3, 3 } };
+	for (unsigned int i = 0; i < 2 && context == NULL; i++) {
+		const int attributes[] = {
+			OSMESA_FORMAT, OSMESA_RGBA,
+			OSMESA_DEPTH_BITS, 24,
+			OSMESA_STENCIL_BITS, 8,
+			OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+			OSMESA_CONTEXT_MAJOR_VERSION, versions[i][0],
+			OSMESA_CONTEXT_MINOR_VERSION, versions[i][1],
+			0
+		};
+		context = OSMesaCreateContextAttribs(attributes, NULL);
+	}
+	if (context == NULL) {
+		std::cout << "ERROR::HEADLESS::OSMESA_CONTEXT_FAILED" << std::endl;
+		return false;
+	}
+	osmesaBuffer.resize((size_t)width * height * 4);
+	if (!OSMesaMakeCurrent(context, osmesaBuffer.data(), GL_UNSIGNED_BYTE, width, height)) {
+		std::cout << "ERROR::HEADLESS::OSMESA_MAKE_CURRENT_FAILED" << std::endl;
+		OSMesaDestroyContext(context);
+		osmesaBuffer.clear();
+		return false;
+	}
+	osmesaContext = context;
+	return true;
+#else
+	(void)width;
+	(void)height;
+	return false;
+#endif
+}
+
+#ifdef AURORA_HEADLESS_EGL
+static void* eglLoader(const char *name)
+{
+	/* Mesa has EGL_KHR_get_all_proc_addresses, core entry points resolve too. */
+	return (void*)eglGetProcAddress(name);
+}
+#endif
+
+#ifdef AURORA_HEADLESS_OSMESA
+static void* osmesaLoader(const char *name)
+{
+	return (void*)OSMesaGetProcAddress(name);
+}
+#endif
+
+bool HeadlessContext::loadGL()
+{
+	switch (backend) {
+#ifdef AURORA_HEADLESS_EGL
+	case HEADLESS_BACKEND_EGL:
+		return gladLoadGLLoader((GLADloadproc)eglLoader) != 0;
+#endif
+#ifdef AURORA_HEADLESS_OSMESA
+	case HEADLESS_BACKEND_OSMESA:
+		return gladLoadGLLoader((GLADloadproc)osmesaLoader) != 0;
+#endif
+	default:
+		return false;
+	}
+}
+
+void HeadlessContext::destroy()
+{
+#ifdef AURORA_HEADLESS_EGL
+	if (eglDisplay != NULL) {
+		eglMakeCurrent((EGLDisplay)eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)eglDisplay, (EGLContext)eglContext);
+		eglTerminate((EGLDisplay)eglDisplay);
+	}
+#endif
+#ifdef AURORA_HEADLESS_OSMESA
+	if (osmesaContext != NULL) {
+		OSMesaDestroyContext((OSMesaContext)osmesaContext);
+	}
+#endif
+	eglDisplay = NULL;
+	eglContext = NULL;
+	osmesaContext = NULL;
+	osmesaBuffer.clear();
+	backend = HEADLESS_BACKEND_NONE;
+}
+
+OffscreenTarget::OffscreenTarget() : FBO(0), width(0), height(0), colorBuffer(0), depthBuffer(0)
+{
+}
+
+void OffscreenTarget::create(int width, int height)
+{
+	deleteBuffers();
+	this->width = width;
+	this->height = height;
+
+	glGenFramebuffers(1, &FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	GL_LABEL(RESOURCE_FRAMEBUFFER, FBO, "offscreen target");
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	GL_LABEL(RESOURCE_RENDERBUFFER, colorBuffer, "offscreen color");
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	GL_LABEL(RESOURCE_RENDERBUFFER, depthBuffer, "offscreen depth");
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+}
+
+void OffscreenTarget::bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	glViewport(0, 0, width, height);
+}
+
+void OffscreenTarget::deleteBuffers()
+{
+	if (FBO != 0) {
+		glDeleteFramebuffers(1, &FBO);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+		FBO = 0;
+		colorBuffer = 0;
+		depthBuffer = 0;
+	}
+}
@@ -0,0 +1,195 @@
+#include "indirect_renderer.h"
+#include "gl_stats.h"
+#include "gl_resources.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+
+IndirectRenderer::IndirectRenderer() : useIndirect(false), commandBuffer(0), instanceBuffer(0), commandCapacity(0), instanceCapacity(0)
+{
+}
+
+bool IndirectRenderer::supported()
+{
+	return GLAD_GL_VERSION_4_3 != 0;
+}
+
+void IndirectRenderer::setEnabled(bool enable)
+{
+	useIndirect = enable && supported();
+	if (useIndirect && commandBuffer == 0) {
+		createBuffers();
+	}
+}
+
+void IndirectRenderer::createBuffers()
+{
+	glGenBuffers(1, &commandBuffer);
+	glGenBuffers(1, &instanceBuffer);
+	/* Not bound until the first submit, the registry labels them then. */
+	GL_LABEL(RESOURCE_BUFFER, commandBuffer, "indirect commands");
+	GL_LABEL(RESOURCE_BUFFER, instanceBuffer, "indirect instances");
+}
+
+void IndirectRenderer::begin()
+{
+	draws.clear();
+	instances.clear();
+}
+
+void IndirectRenderer::add(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec4 &material)
+{
+	InstanceData instance;
+	instance.model = model;
+	instance.material = material;
+	addInstanced(geometry, &instance, 1);
+}
+
+void IndirectRenderer::addInstanced(const GeometryHandle &geometry, const InstanceData *data, unsigned int count, int materialIndex)
+{
+	if (!geometry.valid() || count == 0) {
+		return;
+	}
+	unsigned int first = static_cast<unsigned int>(instances.size());
+	draws.push_back(PendingDraw{ geometry, first, count });
+	instances.insert(instances.end(), data, data + count);
+	if (materialIndex >= 0) {
+		for (unsigned int i = first; i < instances.size(); i++) {
+			instances[i].material.w = static_cast<float>(materialIndex);
+		}
+	}
+}
+
+void IndirectRenderer::submit(Shader &indirectShader, Shader &fallbackShader)
+{
+	if (draws.empty()) {
+		return;
+	}
+	if (useIndirect) {
+		indirectShader.use();
+		submitIndirect();
+	}
+	else {
+		fallbackShader.use();
+		submitFallback(fallbackShader);
+	}
+}
+
+void IndirectRenderer::attachInstanceAttributes(Vertex_Format format)
+{
+	GeometryArena &arena = GeometryArena::get();
+	unsigned int vao = arena.getVAO(format);
+	if (std::find(attachedVAOs.begin(), attachedVAOs.end(), vao) != attachedVAOs.end()) {
+		return;
+	}
+
+	/* The attributes are only read by shaders that declare them, so the regular draws through the same VAO are unaffected. */
+	arena.bind(format);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	for (unsigned int i = 0; i < 4; i++) {
+		glEnableVertexAttribArray(INSTANCE_MODEL_LOCATION + i);
+		glVertexAttribPointer(INSTANCE_MODEL_LOCATION + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(INSTANCE_MODEL_LOCATION + i, 1);
+	}
+	glEnableVertexAttribArray(INSTANCE_MATERIAL_LOCATION);
+	glVertexAttribPointer(INSTANCE_MATERIAL_LOCATION, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, material));
+	glVertexAttribDivisor(INSTANCE_MATERIAL_LOCATION, 1);
+
+	attachedVAOs.push_back(vao);
+}
+
+void IndirectRenderer::submitIndirect()
+{
+	/* Group draws that can share a multi draw call. Instance data is addressed through baseInstance, so reordering is free. */
+	std::stable_sort(draws.begin(), draws.end(), [](const PendingDraw &a, const PendingDraw &b) {
+		if (a.geometry.format != b.geometry.format) {
+			return a.geometry.format < b.geometry.format;
+		}
+		return a.geometry.mode < b.geometry.mode;
+	});
+
+	commands.clear();
+	unsigned long long instanceTotal = 0, primitiveTotal = 0;
+	for (unsigned int i = 0; i < draws.size(); i++) {
+		DrawElementsIndirectCommand command;
+		command.count = draws[i].geometry.indexCount;
+		command.instanceCount = draws[i].instanceCount;
+		command.firstIndex = draws[i].geometry.firstIndex;
+		command.baseVertex = draws[i].geometry.baseVertex;
+		command.baseInstance = draws[i].firstInstance;
+		commands.push_back(command);
+		instanceTotal += command.instanceCount;
+		primitiveTotal += GLStats::primitiveCount(draws[i].geometry.mode, command.count) * command.instanceCount;
+	}
+	/* GLStats cannot see into the command buffer. */
+	if (GLStats::get().isEnabled()) {
+		GLStats::get().addIndirectWork(instanceTotal, primitiveTotal);
+	}
+
+	/* Orphan and refill both buffers so the driver never has to wait on the previous frame's draws. */
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	if (instances.size() > instanceCapacity) {
+		instanceCapacity = static_cast<unsigned int>(instances.size()) * 2;
+	}
+	glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(InstanceData), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(InstanceData), instances.data());
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+	if (commands.size() > commandCapacity) {
+		commandCapacity = static_cast<unsigned int>(commands.size()) * 2;
+	}
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commandCapacity * sizeof(DrawElementsIndirectCommand), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+
+	unsigned int first = 0;
+	while (first < draws.size()) {
+		unsigned int last = first + 1;
+		while (last < draws.size() && draws[last].geometry.format == draws[first].geometry.format
+			&& draws[last].geometry.mode == draws[first].geometry.mode) {
+			last++;
+		}
+
+		attachInstanceAttributes(draws[first].geometry.format);
+		GeometryArena::get().bind(draws[first].geometry.format);
+		glMultiDrawElementsIndirect(draws[first].geometry.mode, GL_UNSIGNED_INT,
+			(void*)(first * sizeof(DrawElementsIndirectCommand)), last - first, 0);
+
+		first = last;
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void IndirectRenderer::submitFallback(Shader &shader)
+{
+	GeometryArena &arena = GeometryArena::get();
+	/* Look the locations up once per pass, not once per draw. */
+	int modelloc = glGetUniformLocation(shader.ID, "model");
+	int metallicloc = glGetUniformLocation(shader.ID, "metallic");
+	int roughnessloc = glGetUniformLocation(shader.ID, "roughness");
+	int aoloc = glGetUniformLocation(shader.ID, "ao");
+	int materialloc = glGetUniformLocation(shader.ID, "materialIndex");
+
+	for (unsigned int i = 0; i < draws.size(); i++) {
+		for (unsigned int j = 0; j < draws[i].instanceCount; j++) {
+			const InstanceData &instance = instances[draws[i].firstInstance + j];
+			glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(instance.model));
+			glUniform1f(metallicloc, instance.material.x);
+			glUniform1f(roughnessloc, instance.material.y);
+			glUniform1f(aoloc, instance.material.z);
+			glUniform1i(materialloc, static_cast<int>(instance.material.w));
+			arena.draw(draws[i].geometry);
+		}
+	}
+}
+
+void IndirectRenderer::deleteBuffers()
+{
+	if (commandBuffer != 0) {
+		glDeleteBuffers(1, &commandBuffer);
+		glDeleteBuffers(1, &instanceBuffer);
+		commandBuffer = 0;
+		instanceBuffer = 0;
+	}
+	attachedVAOs.clear();
+}
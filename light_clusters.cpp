@@ -0,0 +1,223 @@
+#include "light_clusters.h"
+#include "profiler.h"
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CLUSTERS_SSE
+#endif
+
+float lightRadius(const glm::vec3 &color, const glm::vec3 &attenuation, float minIntensity)
+{
+	/* Solve constant + linear * d + quadratic * d^2 = brightest / minIntensity for d. */
+	float brightest = std::max(std::max(color.r, color.g), color.b);
+	float target = brightest / minIntensity;
+	float c = attenuation.x - target;
+	if (attenuation.z > 0.0f) {
+		return (-attenuation.y + std::sqrt(attenuation.y * attenuation.y - 4.0f * attenuation.z * c)) / (2.0f * attenuation.z);
+	}
+	if (attenuation.y > 0.0f) {
+		return -c / attenuation.y;
+	}
+	/* Constant attenuation never falls off. */
+	return 1e30f;
+}
+
+LightClusters::LightClusters() : zNear(0.1f), zFar(100.0f), tileWidth(1.0f), tileHeight(1.0f),
+	lightBuffer(0), gridBuffer(0), indexBuffer(0), lightTexture(0), gridTexture(0), indexTexture(0)
+{
+	clusterLights.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+	clusterCounts.resize(CLUSTER_COUNT);
+	grid.resize(CLUSTER_COUNT);
+}
+
+void LightClusters::createBuffers()
+{
+	unsigned int *buffers[] = { &lightBuffer, &gridBuffer, &indexBuffer };
+	unsigned int *textures[] = { &lightTexture, &gridTexture, &indexTexture };
+	GLenum formats[] = { GL_RGBA32F, GL_R32UI, GL_R16UI };
+	const char *labels[] = { "cluster lights", "cluster grid", "cluster indices" };
+	for (unsigned int i = 0; i < 3; i++) {
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_TEXTURE_BUFFER, *buffers[i]);
+		GL_LABEL(RESOURCE_BUFFER, *buffers[i], labels[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+		glGenTextures(1, textures[i]);
+		glBindTexture(GL_TEXTURE_BUFFER, *textures[i]);
+		GL_LABEL(RESOURCE_TEXTURE, *textures[i], labels[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], *buffers[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::setProjection(float fovy, float aspect, float zNear, float zFar, int width, int height)
+{
+	this->zNear = zNear;
+	this->zFar = zFar;
+	tileWidth = (float)width / CLUSTER_GRID_X;
+	tileHeight = (float)height / CLUSTER_GRID_Y;
+
+	sliceDepth.resize(CLUSTER_GRID_Z + 1);
+	for (int z = 0; z <= CLUSTER_GRID_Z; z++) {
+		sliceDepth[z] = zNear * std::pow(zFar / zNear, (float)z / CLUSTER_GRID_Z);
+	}
+
+	float tanY = std::tan(fovy * 0.5f);
+	float tanX = tanY * aspect;
+	for (std::vector<float>* bounds : { &minX, &minY, &minZ, &maxX, &maxY, &maxZ }) {
+		bounds->resize(CLUSTER_COUNT);
+	}
+	for (int z = 0; z < CLUSTER_GRID_Z; z++) {
+		float depths[2] = { sliceDepth[z], sliceDepth[z + 1] };
+		for (int y = 0; y < CLUSTER_GRID_Y; y++) {
+			float ndcY[2] = { -1.0f + 2.0f * y / CLUSTER_GRID_Y, -1.0f + 2.0f * (y + 1) / CLUSTER_GRID_Y };
+			for (int x = 0; x < CLUSTER_GRID_X; x++) {
+				float ndcX[2] = { -1.0f + 2.0f * x / CLUSTER_GRID_X, -1.0f + 2.0f * (x + 1) / CLUSTER_GRID_X };
+				int cluster = x + CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+
+				/* Box around the eight corners of the froxel. */
+				glm::vec3 lo(1e30f), hi(-1e30f);
+				for (float depth : depths) {
+					for (float nx : ndcX) {
+						for (float ny : ndcY) {
+							glm::vec3 corner(nx * tanX * depth, ny * tanY * depth, -depth);
+							lo = glm::min(lo, corner);
+							hi = glm::max(hi, corner);
+						}
+					}
+				}
+				minX[cluster] = lo.x; minY[cluster] = lo.y; minZ[cluster] = lo.z;
+				maxX[cluster] = hi.x; maxY[cluster] = hi.y; maxZ[cluster] = hi.z;
+			}
+		}
+	}
+}
+
+void LightClusters::binLight(unsigned short index, const glm::vec3 &center, float radius)
+{
+	float depth = -center.z;
+	if (depth + radius < zNear || depth - radius > zFar) {
+		return;
+	}
+	/* Only the slices the sphere's depth range overlaps can contain it. */
+	int firstSlice = static_cast<int>(std::upper_bound(sliceDepth.begin(), sliceDepth.end(), depth - radius) - sliceDepth.begin()) - 1;
+	int lastSlice = static_cast<int>(std::upper_bound(sliceDepth.begin(), sliceDepth.end(), depth + radius) - sliceDepth.begin()) - 1;
+	firstSlice = std::max(firstSlice, 0);
+	lastSlice = std::min(lastSlice, CLUSTER_GRID_Z - 1);
+
+	float radiusSq = radius * radius;
+	for (int z = firstSlice; z <= lastSlice; z++) {
+		for (int y = 0; y < CLUSTER_GRID_Y; y++) {
+			int row = CLUSTER_GRID_X * (y + CLUSTER_GRID_Y * z);
+#ifdef CLUSTERS_SSE
+			/* Squared distance from the centre to each box, four clusters per iteration. */
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+			const __m128 rr = _mm_set1_ps(radiusSq);
+			for (int x = 0; x < CLUSTER_GRID_X; x += 4) {
+				int cluster = row + x;
+				__m128 dx = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[cluster]), cx), zero), _mm_max_ps(_mm_sub_ps(cx, _mm_loadu_ps(&maxX[cluster])), zero));
+				__m128 dy = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[cluster]), cy), zero), _mm_max_ps(_mm_sub_ps(cy, _mm_loadu_ps(&maxY[cluster])), zero));
+				__m128 dz = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minZ[cluster]), cz), zero), _mm_max_ps(_mm_sub_ps(cz, _mm_loadu_ps(&maxZ[cluster])), zero));
+				__m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				int hits = _mm_movemask_ps(_mm_cmple_ps(distSq, rr));
+				for (int i = 0; hits != 0; i++, hits >>= 1) {
+					if ((hits & 1) && clusterCounts[cluster + i] < MAX_LIGHTS_PER_CLUSTER) {
+						clusterLights[(cluster + i) * MAX_LIGHTS_PER_CLUSTER + clusterCounts[cluster + i]++] = index;
+					}
+				}
+			}
+#else
+			for (int x = 0; x < CLUSTER_GRID_X; x++) {
+				int cluster = row + x;
+				float dx = std::max(minX[cluster] - center.x, 0.0f) + std::max(center.x - maxX[cluster], 0.0f);
+				float dy = std::max(minY[cluster] - center.y, 0.0f) + std::max(center.y - maxY[cluster], 0.0f);
+				float dz = std::max(minZ[cluster] - center.z, 0.0f) + std::max(center.z - maxZ[cluster], 0.0f);
+				if (dx * dx + dy * dy + dz * dz <= radiusSq && clusterCounts[cluster] < MAX_LIGHTS_PER_CLUSTER) {
+					clusterLights[cluster * MAX_LIGHTS_PER_CLUSTER + clusterCounts[cluster]++] = index;
+				}
+			}
+#endif
+		}
+	}
+}
+
+void LightClusters::upload(unsigned int buffer, const void *data, size_t size)
+{
+	/* Orphan every frame so the upload never waits for last frame's shading. */
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max(size, (size_t)16), NULL, GL_STREAM_DRAW);
+	if (size > 0) {
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+	}
+}
+
+void LightClusters::update(const glm::mat4 &view, const vector<PointLight> &lights)
+{
+	PROFILE_CPU_SCOPE("cluster binning");
+	if (lightBuffer == 0) {
+		createBuffers();
+	}
+
+	std::fill(clusterCounts.begin(), clusterCounts.end(), 0);
+	unsigned int lightCount = std::min((unsigned int)lights.size(), (unsigned int)MAX_CLUSTERED_LIGHTS);
+	for (unsigned int i = 0; i < lightCount; i++) {
+		glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+		binLight(static_cast<unsigned short>(i), center, lights[i].radius);
+	}
+
+	/* Compact the per cluster scratch lists into one index list. */
+	indices.clear();
+	for (unsigned int cluster = 0; cluster < CLUSTER_COUNT; cluster++) {
+		unsigned int offset = static_cast<unsigned int>(indices.size());
+		grid[cluster] = offset << 8 | clusterCounts[cluster];
+		const unsigned short *list = &clusterLights[cluster * MAX_LIGHTS_PER_CLUSTER];
+		indices.insert(indices.end(), list, list + clusterCounts[cluster]);
+	}
+
+	upload(lightBuffer, lights.data(), lightCount * sizeof(PointLight));
+	upload(gridBuffer, grid.data(), grid.size() * sizeof(unsigned int));
+	upload(indexBuffer, indices.data(), indices.size() * sizeof(unsigned short));
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::setupShader(Shader &shader, unsigned int firstUnit)
+{
+	shader.use();
+	shader.setInt("clusterLights", firstUnit);
+	shader.setInt("clusterGrid", firstUnit + 1);
+	shader.setInt("clusterIndices", firstUnit + 2);
+	glUniform3i(glGetUniformLocation(shader.ID, "clusterCount"), CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z);
+	/* slice = log(depth) * scale - bias */
+	float scale = CLUSTER_GRID_Z / std::log(zFar / zNear);
+	float depthParams[4] = { zNear, zFar, scale, std::log(zNear) * scale };
+	shader.setVecN("clusterDepth", depthParams, 4);
+	float tileSize[2] = { tileWidth, tileHeight };
+	shader.setVecN("clusterTileSize", tileSize, 2);
+}
+
+void LightClusters::bind(unsigned int firstUnit)
+{
+	unsigned int textures[] = { lightTexture, gridTexture, indexTexture };
+	for (unsigned int i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void LightClusters::deleteBuffers()
+{
+	if (lightBuffer != 0) {
+		unsigned int buffers[] = { lightBuffer, gridBuffer, indexBuffer };
+		unsigned int textures[] = { lightTexture, gridTexture, indexTexture };
+		glDeleteBuffers(3, buffers);
+		glDeleteTextures(3, textures);
+		lightBuffer = gridBuffer = indexBuffer = 0;
+		lightTexture = gridTexture = indexTexture = 0;
+	}
+}
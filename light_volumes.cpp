@@ -0,0 +1,168 @@
+#include "light_volumes.h"
+
+#include "gbuffer.h"
+#include "profiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+
+/* Low poly is plenty, the sphere only limits which pixels get shaded. */
+const unsigned int VolumeSegments = 16;
+const unsigned int VolumeRings = 12;
+
+LightVolumeRenderer::LightVolumeRenderer() : mode(LIGHT_VOLUME_STENCIL), volumes(0)
+{
+}
+
+void LightVolumeRenderer::createGeometry()
+{
+	const float PI = 3.14159265359f;
+	/* Push the vertices out so the faces, not the vertices, touch the unit sphere. */
+	float scale = 1.0f / (std::cos(PI / VolumeSegments) * std::cos(PI / (2.0f * VolumeRings)));
+
+	vector<float> vertices;
+	for (unsigned int ring = 0; ring <= VolumeRings; ring++) {
+		float theta = (float)ring / VolumeRings * PI;
+		for (unsigned int segment = 0; segment <= VolumeSegments; segment++) {
+			float phi = (float)segment / VolumeSegments * 2.0f * PI;
+			float position[5] = { std::cos(phi) * std::sin(theta) * scale, std::cos(theta) * scale, std::sin(phi) * std::sin(theta) * scale, 0.0f, 0.0f };
+			vertices.insert(vertices.end(), position, position + 5);
+		}
+	}
+
+	/* Counter clockwise seen from outside, so GL_FRONT culling keeps the far side. */
+	vector<unsigned int> indices;
+	for (unsigned int ring = 0; ring < VolumeRings; ring++) {
+		for (unsigned int segment = 0; segment < VolumeSegments; segment++) {
+			unsigned int a = ring * (VolumeSegments + 1) + segment;
+			unsigned int b = a + VolumeSegments + 1;
+			unsigned int triangles[6] = { a, a + 1, b, b, a + 1, b + 1 };
+			indices.insert(indices.end(), triangles, triangles + 6);
+		}
+	}
+	sphere = GeometryArena::get().allocate(VERTEX_FORMAT_P3T2, vertices.data(), static_cast<unsigned int>(vertices.size() / 5),
+		indices.data(), static_cast<unsigned int>(indices.size()));
+}
+
+void LightVolumeRenderer::render(Shader &lightShader, Shader &stencilShader, Shader &ambientShader, const vector<PointLight> &lights,
+	const glm::mat4 &view, const glm::mat4 &projection, int width, int height)
+{
+	PROFILE_GPU_SCOPE("light volumes");
+	if (!sphere.valid()) {
+		createGeometry();
+	}
+	GeometryArena &arena = GeometryArena::get();
+	glm::mat4 identity = glm::mat4(1.0f);
+	glm::vec3 viewPos = glm::vec3(glm::inverse(view)[3]);
+	float screenSize[2] = { (float)width, (float)height };
+
+	/* Ambient once for every pixel, the volumes add the lights on top. */
+	glDepthMask(GL_FALSE);
+	glDisable(GL_DEPTH_TEST);
+	ambientShader.use();
+	glUniformMatrix4fv(glGetUniformLocation(ambientShader.ID, "model"), 1, GL_FALSE, glm::value_ptr(identity));
+	glUniformMatrix4fv(glGetUniformLocation(ambientShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(identity));
+	glUniformMatrix4fv(glGetUniformLocation(ambientShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(identity));
+	ambientShader.setVecN("screenSize", screenSize, 2);
+	arena.drawScreenQuad();
+
+	glEnable(GL_BLEND);
+	glBlendEquation(GL_FUNC_ADD);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glEnable(GL_CULL_FACE);
+	/* Volumes crossing the far plane must not lose their back faces. */
+	glEnable(GL_DEPTH_CLAMP);
+
+	Shader* shaders[] = { &lightShader, &stencilShader };
+	for (Shader* shader : shaders) {
+		shader->use();
+		glUniformMatrix4fv(glGetUniformLocation(shader->ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+		glUniformMatrix4fv(glGetUniformLocation(shader->ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	}
+	int stencilModelloc = glGetUniformLocation(stencilShader.ID, "model");
+
+	/* Look the locations up once per pass, not once per light. */
+	lightShader.use();
+	lightShader.setVecN("screenSize", screenSize, 2);
+	lightShader.setVecN("viewPos", &viewPos[0], 3);
+	GBuffer::setMatrices(lightShader, projection, view);
+	int modelloc = glGetUniformLocation(lightShader.ID, "model");
+	int positionloc = glGetUniformLocation(lightShader.ID, "light.Position");
+	int colorloc = glGetUniformLocation(lightShader.ID, "light.Color");
+	int attenuationloc = glGetUniformLocation(lightShader.ID, "light.Attenuation");
+	int radiusloc = glGetUniformLocation(lightShader.ID, "light.Radius");
+
+	if (mode == LIGHT_VOLUME_STENCIL) {
+		glEnable(GL_STENCIL_TEST);
+	}
+	else {
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_GEQUAL);
+		glCullFace(GL_FRONT);
+	}
+
+	volumes = 0;
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		const PointLight &light = lights[i];
+		/* Lights entirely behind the camera. */
+		glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.0f));
+		if (center.z - light.radius > 0.0f) {
+			continue;
+		}
+		volumes++;
+
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), light.position);
+		model = glm::scale(model, glm::vec3(light.radius));
+
+		if (mode == LIGHT_VOLUME_STENCIL) {
+			/* Depth fail counting: back faces behind the scene add one, front faces behind it take one away,
+			 * which leaves a non zero value exactly where the scene lies inside the sphere. Works from inside the
+			 * volume too, since only the failing faces count. */
+			stencilShader.use();
+			glUniformMatrix4fv(stencilModelloc, 1, GL_FALSE, glm::value_ptr(model));
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			glEnable(GL_DEPTH_TEST);
+			glDepthFunc(GL_LESS);
+			glDisable(GL_CULL_FACE);
+			glStencilFunc(GL_ALWAYS, 0, 0xFF);
+			glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+			glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+			arena.draw(sphere);
+
+			/* Shade the marked pixels and reset them to zero on the way, so no clear is needed between lights. */
+			lightShader.use();
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDisable(GL_DEPTH_TEST);
+			glEnable(GL_CULL_FACE);
+			glCullFace(GL_FRONT);
+			glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+			glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+		}
+
+		glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(model));
+		glUniform3fv(positionloc, 1, glm::value_ptr(light.position));
+		glUniform3fv(colorloc, 1, glm::value_ptr(light.color));
+		glUniform3fv(attenuationloc, 1, glm::value_ptr(light.attenuation));
+		glUniform1f(radiusloc, light.radius);
+		arena.draw(sphere);
+	}
+
+	/* Back to the defaults the rest of the renderer expects. */
+	glDisable(GL_STENCIL_TEST);
+	glDisable(GL_DEPTH_CLAMP);
+	glDisable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glDisable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_TRUE);
+}
+
+void LightVolumeRenderer::deleteGeometry()
+{
+	if (sphere.valid()) {
+		GeometryArena::get().free(sphere);
+	}
+}
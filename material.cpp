@@ -0,0 +1,156 @@
+#include "material.h"
+#include "gl_resources.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+const unsigned int InitialMaterialCapacity = 256;
+
+/* Sampler uniform names in order of first use, the index is the unit after MATERIAL_TEXTURE_UNIT_BASE. */
+static vector<string> samplerNames;
+static std::map<string, int> samplerUnits;
+
+MaterialBlockPool& MaterialBlockPool::get()
+{
+	static MaterialBlockPool pool;
+	return pool;
+}
+
+unsigned int MaterialBlockPool::allocate(const MaterialParams &params)
+{
+	if (UBO == 0) {
+		int alignment;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		blockStride = (sizeof(MaterialParams) + alignment - 1) / alignment * alignment;
+		glGenBuffers(1, &UBO);
+	}
+
+	if (!freeOffsets.empty()) {
+		unsigned int offset = freeOffsets.back();
+		freeOffsets.pop_back();
+		update(offset, params);
+		return offset;
+	}
+
+	if (count == capacity) {
+		/* Grow and refill from the CPU copy, existing offsets stay valid. */
+		capacity = capacity == 0 ? InitialMaterialCapacity : capacity * 2;
+		blocks.resize(capacity * blockStride);
+		glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+		GL_LABEL(RESOURCE_BUFFER, UBO, "material blocks");
+		glBufferData(GL_UNIFORM_BUFFER, blocks.size(), blocks.data(), GL_STATIC_DRAW);
+	}
+
+	unsigned int offset = count * blockStride;
+	count++;
+	update(offset, params);
+	return offset;
+}
+
+void MaterialBlockPool::update(unsigned int offset, const MaterialParams &params)
+{
+	std::copy((const unsigned char*)&params, (const unsigned char*)&params + sizeof(MaterialParams), blocks.begin() + offset);
+	glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(MaterialParams), &params);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void MaterialBlockPool::free(unsigned int offset)
+{
+	freeOffsets.push_back(offset);
+}
+
+void MaterialBlockPool::deleteBuffer()
+{
+	if (UBO != 0) {
+		glDeleteBuffers(1, &UBO);
+		UBO = 0;
+	}
+	capacity = 0;
+	count = 0;
+	blocks.clear();
+	freeOffsets.clear();
+}
+
+Material::Material(const vector<MaterialTexture> &textures, const MaterialParams &params) : textures(textures), params(params)
+{
+	for (MaterialTexture &texture : this->textures) {
+		texture.unit = samplerUnit(texture.uniformName);
+	}
+	blockOffset = MaterialBlockPool::get().allocate(params);
+}
+
+int Material::samplerUnit(const string &uniformName)
+{
+	auto found = samplerUnits.find(uniformName);
+	if (found != samplerUnits.end()) {
+		return found->second;
+	}
+	static int maxUnits = 0;
+	if (maxUnits == 0) {
+		glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxUnits);
+	}
+	int unit = MATERIAL_TEXTURE_UNIT_BASE + static_cast<int>(samplerNames.size());
+	if (unit >= maxUnits) {
+		std::cout << "ERROR::MATERIAL::OUT_OF_TEXTURE_UNITS: " << uniformName << " would need unit " << unit << " of " << maxUnits
+			<< ", its textures are not bound" << std::endl;
+		return -1;
+	}
+	samplerNames.push_back(uniformName);
+	samplerUnits[uniformName] = unit;
+	return unit;
+}
+
+void Material::release()
+{
+	if (blockOffset >= 0) {
+		MaterialBlockPool::get().free(blockOffset);
+		blockOffset = -1;
+	}
+}
+
+void Material::setParams(const MaterialParams &newParams)
+{
+	params = newParams;
+	if (blockOffset < 0) {
+		blockOffset = MaterialBlockPool::get().allocate(params);
+	}
+	else {
+		MaterialBlockPool::get().update(blockOffset, params);
+	}
+}
+
+/* Writes the units of the sampler names the program does not have yet, and the block binding the first time. */
+void Material::resolve(Shader &shader)
+{
+	if (shader.materialSamplers < 0) {
+		unsigned int blockIndex = glGetUniformBlockIndex(shader.ID, "MaterialParams");
+		if (blockIndex != GL_INVALID_INDEX) {
+			glUniformBlockBinding(shader.ID, blockIndex, MATERIAL_PARAMS_BINDING);
+		}
+		shader.materialSamplers = 0;
+	}
+	for (int i = shader.materialSamplers; i < static_cast<int>(samplerNames.size()); i++) {
+		shader.setInt(samplerNames[i], MATERIAL_TEXTURE_UNIT_BASE + i);
+	}
+	shader.materialSamplers = static_cast<int>(samplerNames.size());
+}
+
+void Material::bind(Shader &shader)
+{
+	if (shader.materialSamplers < static_cast<int>(samplerNames.size())) {
+		resolve(shader);
+	}
+
+	if (blockOffset >= 0) {
+		glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_PARAMS_BINDING, MaterialBlockPool::get().getBuffer(), blockOffset, sizeof(MaterialParams));
+	}
+	for (unsigned int i = 0; i < textures.size(); i++) {
+		if (textures[i].unit < 0) {
+			continue;
+		}
+		glActiveTexture(GL_TEXTURE0 + textures[i].unit);
+		glBindTexture(textures[i].target, textures[i].id);
+	}
+}
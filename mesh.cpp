@@ -1,71 +1,76 @@
 #include "mesh.h"
 
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const MaterialParams& params)
 {
 	this->vertices = vertices;
 	this->indices = indices;
 	this->textures = textures;
 
 	setupMesh();
+	setupMaterial(params);
 }
 
 void Mesh::setupMesh()
 {
-	/* Create Vertex Array Object and VBO, EBO buffer objects, and store a reference to their corresponding IDs. */
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	/* Bind VAO to setup Vertex Attribute Pointers. */
-	glBindVertexArray(VAO);
-
-	/* Bind VBO as the cuurent active buffer object. */
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	/* Load vertex data into memory and bind to active buffer object */
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-	/* Bind EBO to load polygon indices from vertex data. */
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-	/* Set correct vertex attribute pointers as specified in the vertex shader. */
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+	/* All meshes share one VAO and one pair of vertex/index buffers, the mesh only remembers its ranges. */
+	geometry = GeometryArena::get().allocate(VERTEX_FORMAT_MESH, vertices.data(), static_cast<unsigned int>(vertices.size()),
+		indices.data(), static_cast<unsigned int>(indices.size()));
+
+	/* Sphere around the box of the vertices, not minimal but good enough to cull against. */
+	if (!vertices.empty()) {
+		glm::vec3 boundsMin = vertices[0].Position;
+		glm::vec3 boundsMax = vertices[0].Position;
+		for (unsigned int i = 1; i < vertices.size(); i++) {
+			boundsMin = glm::min(boundsMin, vertices[i].Position);
+			boundsMax = glm::max(boundsMax, vertices[i].Position);
+		}
+		boundsCenter = (boundsMin + boundsMax) * 0.5f;
+		boundsRadius = glm::length(boundsMax - boundsCenter);
+	}
+}
 
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+void Mesh::release()
+{
+	GeometryArena::get().free(geometry);
+	material.release();
+}
 
-	glEnableVertexAttribArray(3);
-	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-	
-	glEnableVertexAttribArray(4);
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-	
-	glEnableVertexAttribArray(5);
-	glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
+bool Mesh::sharesTextures(const Mesh& other) const
+{
+	if (textures.size() != other.textures.size()) {
+		return false;
+	}
+	for (unsigned int i = 0; i < textures.size(); i++) {
+		if (textures[i].id != other.textures[i].id || textures[i].type != other.textures[i].type) {
+			return false;
+		}
+	}
+	return true;
+}
 
-	glEnableVertexAttribArray(6);
-	glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
+void Mesh::Draw(Shader& shader)
+{
+	bindTextures(shader);
+	GeometryArena::get().draw(geometry);
 
-	/* Unbind the VAO. To be used later during Draw Call. */
-	glBindVertexArray(0);
+	glActiveTexture(GL_TEXTURE0);
+}
 
+void Mesh::bindTextures(Shader& shader)
+{
+	material.bind(shader);
 }
 
-void Mesh::Draw(Shader& shader)
+void Mesh::setupMaterial(const MaterialParams& params)
 {
+	/* Sampler names are built once here, drawing only binds the resolved textures. */
 	unsigned int diffuseNr = 1;
 	unsigned int specularNr = 1;
 	unsigned int normalNr = 1;
 	unsigned int heightNr = 1;
 
+	vector<MaterialTexture> materialTextures;
 	for (unsigned int i = 0; i < textures.size(); i++) {
-		glActiveTexture(GL_TEXTURE0 + i);
-
 		string number;
 		string name = textures[i].type;
 		if (name == "texture_diffuse") {
@@ -81,12 +86,7 @@ void Mesh::Draw(Shader& shader)
 			number = std::to_string(heightNr++);
 		}
 
-		shader.setInt(("material." + name + number).c_str(), i);
-		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		materialTextures.push_back(MaterialTexture{ GL_TEXTURE_2D, textures[i].id, "material." + name + number });
 	}
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
-
-	glActiveTexture(GL_TEXTURE0);
-}
\ No newline at end of file
+	material = Material(materialTextures, params);
+}
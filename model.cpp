@@ -1,11 +1,93 @@
 #include "model.h"
+#include "profiler.h"
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+#include <glm/gtc/type_ptr.hpp>
+
+GLTexture TextureFromFile(const char* path, const string& directory, bool gamma = false);
 
 void Model::Draw(Shader& shader)
+{
+	if (atlas) {
+		/* Textures come from the atlas which is bound once for all meshes, only the table index changes per mesh. */
+		int materialloc = glGetUniformLocation(shader.ID, "materialIndex");
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			glUniform1i(materialloc, meshes[i].materialIndex);
+			GeometryArena::get().draw(meshes[i].geometry);
+		}
+		return;
+	}
+
+	for (unsigned int i = 0; i < batches.size(); i++) {
+		meshes[batches[i].firstMesh].bindTextures(shader);
+		batchGeometry.clear();
+		for (unsigned int mesh : batches[i].meshes) {
+			batchGeometry.push_back(&meshes[mesh].geometry);
+		}
+		GeometryArena::get().drawBatch(batchGeometry);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void Model::DrawIndirect(IndirectRenderer& renderer, Shader& indirectShader, Shader& fallbackShader, const InstanceData* instances, unsigned int count)
+{
+	if (!renderer.enabled()) {
+		fallbackShader.use();
+		int modelloc = glGetUniformLocation(fallbackShader.ID, "model");
+		for (unsigned int i = 0; i < count; i++) {
+			glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(instances[i].model));
+			if (atlas) {
+				Draw(fallbackShader);
+				continue;
+			}
+			for (unsigned int j = 0; j < meshes.size(); j++) {
+				meshes[j].Draw(fallbackShader);
+			}
+		}
+		return;
+	}
+
+	indirectShader.use();
+	if (atlas) {
+		/* Every mesh shares the atlas bind set, so the whole model goes out in one multi draw. */
+		renderer.begin();
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			renderer.addInstanced(meshes[i].geometry, instances, count, meshes[i].materialIndex);
+		}
+		renderer.submit(indirectShader, fallbackShader);
+		return;
+	}
+	for (unsigned int i = 0; i < batches.size(); i++) {
+		meshes[batches[i].firstMesh].bindTextures(indirectShader);
+		renderer.begin();
+		for (unsigned int mesh : batches[i].meshes) {
+			renderer.addInstanced(meshes[mesh].geometry, instances, count);
+		}
+		renderer.submit(indirectShader, fallbackShader);
+	}
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void Model::release()
 {
 	for (unsigned int i = 0; i < meshes.size(); i++) {
-		meshes[i].Draw(shader);
+		meshes[i].release();
+	}
+	textureObjects.clear();
+	textures_loaded.clear();
+}
+
+void Model::buildBatches()
+{
+	batches.clear();
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		unsigned int j = 0;
+		while (j < batches.size() && !meshes[batches[j].firstMesh].sharesTextures(meshes[i])) {
+			j++;
+		}
+		if (j == batches.size()) {
+			batches.push_back(MeshBatch{ i, {} });
+		}
+		batches[j].meshes.push_back(i);
 	}
 }
 
@@ -21,6 +103,10 @@ void Model::loadModel(string const &path)
 	directory = path.substr(0, path.find_last_of('/'));
 
 	processNode(scene->mRootNode, scene);
+	buildBatches();
+	if (atlas) {
+		atlas->build();
+	}
 }
 
 void Model::processNode(aiNode *node, const aiScene *scene)
@@ -93,6 +179,21 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
 		}
 	}
 
+	MaterialParams params = loadMaterialParams(scene->mMaterials[mesh->mMaterialIndex]);
+
+	if (atlas) {
+		Mesh result(vertices, indices, textures, params);
+		auto cached = atlasMaterials.find(mesh->mMaterialIndex);
+		if (cached != atlasMaterials.end()) {
+			result.materialIndex = cached->second;
+		}
+		else {
+			result.materialIndex = loadAtlasMaterial(scene->mMaterials[mesh->mMaterialIndex]);
+			atlasMaterials[mesh->mMaterialIndex] = result.materialIndex;
+		}
+		return result;
+	}
+
 	if (mesh->mMaterialIndex >= 0) {
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
@@ -105,7 +206,7 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene)
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 	}
 
-	return Mesh(vertices, indices, textures);
+	return Mesh(vertices, indices, textures, params);
 
 }
 
@@ -125,7 +226,8 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type,
 		}
 		if (!skip) {
 			Texture texture;
-			texture.id = TextureFromFile(str.C_Str(), this->directory);
+			textureObjects.push_back(TextureFromFile(str.C_Str(), this->directory));
+			texture.id = textureObjects.back();
 			texture.type = typeName;
 			texture.path = str.C_Str();
 			textures.push_back(texture);
@@ -136,13 +238,58 @@ vector<Texture> Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type,
 	return textures;
 }
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+MaterialParams Model::loadMaterialParams(aiMaterial *mat)
+{
+	MaterialParams params;
+
+	/* Most exporters write a diffuse colour next to the diffuse map, only use it when there is no map. */
+	aiColor3D colour;
+	if (mat->GetTextureCount(aiTextureType_DIFFUSE) == 0 && mat->Get(AI_MATKEY_COLOR_DIFFUSE, colour) == AI_SUCCESS) {
+		params.albedo = glm::vec4(colour.r, colour.g, colour.b, 1.0f);
+	}
+	float shininess;
+	if (mat->Get(AI_MATKEY_SHININESS, shininess) == AI_SUCCESS && shininess > 0.0f) {
+		params.surface.w = shininess;
+	}
+	return params;
+}
+
+int Model::loadAtlasMaterial(aiMaterial *mat)
+{
+	AtlasMaterial material;
+	TextureLayer diffuse = loadAtlasTexture(mat, aiTextureType_DIFFUSE);
+	TextureLayer specular = loadAtlasTexture(mat, aiTextureType_SPECULAR);
+	TextureLayer normal = loadAtlasTexture(mat, aiTextureType_HEIGHT);
+	TextureLayer height = loadAtlasTexture(mat, aiTextureType_AMBIENT);
+	material.diffuse[0] = diffuse.page;
+	material.diffuse[1] = diffuse.layer;
+	material.specular[0] = specular.page;
+	material.specular[1] = specular.layer;
+	material.normal[0] = normal.page;
+	material.normal[1] = normal.layer;
+	material.height[0] = height.page;
+	material.height[1] = height.layer;
+	return atlas->addMaterial(material);
+}
+
+TextureLayer Model::loadAtlasTexture(aiMaterial *mat, aiTextureType type)
+{
+	/* The atlas stores one texture per slot, same as the shaders only sample the first one of each type. */
+	if (mat->GetTextureCount(type) == 0) {
+		return TextureLayer();
+	}
+	aiString str;
+	mat->GetTexture(type, 0, &str);
+	return atlas->addTexture(directory + '/' + string(str.C_Str()));
+}
+
+GLTexture TextureFromFile(const char* path, const string& directory, bool gamma)
 {
+	PROFILE_CPU_SCOPE("texture load");
 	string filename = string(path);
 	filename = directory + '/' + filename;
 
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
+	GLTexture textureID(filename, GL_SITE);
 
 	int width, height, nrComponents;
 	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
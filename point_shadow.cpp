@@ -0,0 +1,383 @@
+#include "point_shadow.h"
+#include "profiler.h"
+#include "gl_resources.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <iostream>
+
+/* Look direction and up vector of every cube face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + face order. */
+static const glm::vec3 FaceDirections[6] = {
+	glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+	glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+	glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+};
+static const glm::vec3 FaceUps[6] = {
+	glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+	glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+	glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+};
+
+static bool hasExtension(const char *name)
+{
+	int count = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+	for (int i = 0; i < count; i++) {
+		const char *extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (extension != NULL && std::strcmp(extension, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+PointShadowRenderer::PointShadowRenderer() : size(0), nearPlane(0.1f), farPlane(25.0f), layered(false), layeredAllowed(true),
+	FBO(0), staticFBO(0), depthCubemap(0), staticCubemap(0), faceDraws(0), cachedLightPos(0.0f), staticDirty(true),
+	hasDynamic(false), staticUpdated(false), skipped(false), viewerSet(false), viewPlanes(), cameraPos(0.0f), maxDistance(0.0f)
+{
+}
+
+static unsigned int createCubemap(const char *label)
+{
+	unsigned int cubemap;
+	glGenTextures(1, &cubemap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	GL_LABEL(RESOURCE_TEXTURE, cubemap, label);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	return cubemap;
+}
+
+static unsigned int createFramebuffer(const char *label, unsigned int cubemap)
+{
+	unsigned int fbo;
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	GL_LABEL(RESOURCE_FRAMEBUFFER, fbo, label);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	/* Completeness is checked on the layered attachment, the per face path attaches one face at a time later. */
+	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cubemap, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::POINT_SHADOW::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+	return fbo;
+}
+
+void PointShadowRenderer::create(int size)
+{
+	deleteBuffers();
+	this->size = size;
+
+	depthCubemap = createCubemap("point shadow");
+	for (unsigned int i = 0; i < 6; i++) {
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	}
+	/* Linear filtering with comparison gives a 2x2 PCF per fetch, see common/point_shadow.glsl. */
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	/* Only ever blitted from, same format so the depth blit is a plain copy. */
+	staticCubemap = createCubemap("point shadow static");
+	for (unsigned int i = 0; i < 6; i++) {
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	FBO = createFramebuffer("point shadow", depthCubemap);
+	staticFBO = createFramebuffer("point shadow static", staticCubemap);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	staticDirty = true;
+	selectPath();
+}
+
+void PointShadowRenderer::setLayered(bool enable)
+{
+	layeredAllowed = enable;
+	selectPath();
+}
+
+void PointShadowRenderer::selectPath()
+{
+	shaderDefines.clear();
+	layered = false;
+	if (!layeredAllowed) {
+		return;
+	}
+	if (hasExtension("GL_ARB_shader_viewport_layer_array")) {
+		shaderDefines["VERTEX_LAYER_ARB"] = "";
+		layered = true;
+	}
+	else if (hasExtension("GL_AMD_vertex_shader_layer")) {
+		shaderDefines["VERTEX_LAYER_AMD"] = "";
+		layered = true;
+	}
+}
+
+void PointShadowRenderer::setPlanes(float nearPlane, float farPlane)
+{
+	if (nearPlane != this->nearPlane || farPlane != this->farPlane) {
+		this->nearPlane = nearPlane;
+		this->farPlane = farPlane;
+		staticDirty = true;
+	}
+}
+
+void PointShadowRenderer::begin()
+{
+	/* Keep last frame's static list to diff against, without reallocating either vector. */
+	previousStatic.swap(staticCasters);
+	staticCasters.clear();
+	dynamicCasters.clear();
+}
+
+void PointShadowRenderer::addCaster(const GeometryHandle &geometry, const glm::mat4 &model, const glm::vec3 &center, float radius, bool dynamic)
+{
+	if (!geometry.valid()) {
+		return;
+	}
+	if (dynamic) {
+		dynamicCasters.push_back(makeShadowCaster(geometry, model, center, radius));
+	}
+	else {
+		staticCasters.push_back(makeShadowCaster(geometry, model, center, radius));
+	}
+}
+
+void PointShadowRenderer::addMesh(const Mesh &mesh, const glm::mat4 &model, bool dynamic)
+{
+	addCaster(mesh.geometry, model, mesh.boundsCenter, mesh.boundsRadius, dynamic);
+}
+
+void PointShadowRenderer::setViewer(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos, float maxDistance)
+{
+	/* Gribb/Hartmann: the planes are sums and differences of the rows of the matrix, normals pointing inwards. */
+	glm::mat4 m = glm::transpose(viewProjection);
+	viewPlanes[0] = m[3] + m[0];
+	viewPlanes[1] = m[3] - m[0];
+	viewPlanes[2] = m[3] + m[1];
+	viewPlanes[3] = m[3] - m[1];
+	viewPlanes[4] = m[3] + m[2];
+	viewPlanes[5] = m[3] - m[2];
+	for (unsigned int i = 0; i < 6; i++) {
+		viewPlanes[i] /= glm::length(glm::vec3(viewPlanes[i]));
+	}
+	this->cameraPos = cameraPos;
+	this->maxDistance = maxDistance;
+	viewerSet = true;
+}
+
+bool PointShadowRenderer::inView(const glm::vec3 &lightPos) const
+{
+	if (!viewerSet) {
+		return true;
+	}
+	/* Nothing outside the sphere of the far plane receives light, and so no shadow either. */
+	if (glm::length(lightPos - cameraPos) - farPlane > maxDistance) {
+		return false;
+	}
+	for (unsigned int i = 0; i < 6; i++) {
+		if (glm::dot(glm::vec3(viewPlanes[i]), lightPos) + viewPlanes[i].w < -farPlane) {
+			return false;
+		}
+	}
+	return true;
+}
+
+unsigned int PointShadowRenderer::cullFaces(const glm::vec3 &lightPos, const glm::vec3 &center, float radius) const
+{
+	glm::vec3 d = center - lightPos;
+	if (glm::length(d) - radius > farPlane) {
+		return 0;
+	}
+	/* The side planes of a 90 degree face frustum are |other axis| = distance along the face axis, their normals
+	 * are (axis +- other) / sqrt(2). */
+	float slack = radius * 1.41421356f;
+	unsigned int mask = 0;
+	for (unsigned int face = 0; face < 6; face++) {
+		int axis = face / 2;
+		float along = (face % 2 == 0) ? d[axis] : -d[axis];
+		float a = d[(axis + 1) % 3];
+		float b = d[(axis + 2) % 3];
+		if (along + radius >= nearPlane && along - a >= -slack && along + a >= -slack && along - b >= -slack && along + b >= -slack) {
+			mask |= 1u << face;
+		}
+	}
+	return mask;
+}
+
+bool PointShadowRenderer::staticCastersChanged(const glm::vec3 &lightPos) const
+{
+	if (staticCasters.size() != previousStatic.size()) {
+		return true;
+	}
+	for (unsigned int i = 0; i < staticCasters.size(); i++) {
+		const ShadowCaster &current = staticCasters[i];
+		const ShadowCaster &previous = previousStatic[i];
+		bool same = current.geometry.format == previous.geometry.format && current.geometry.baseVertex == previous.geometry.baseVertex
+			&& current.geometry.firstIndex == previous.geometry.firstIndex && current.geometry.indexCount == previous.geometry.indexCount
+			&& current.model == previous.model;
+		/* A change out of the light's reach, before and after, leaves the map as it is. */
+		if (!same && (cullFaces(lightPos, current.center, current.radius) != 0 || cullFaces(lightPos, previous.center, previous.radius) != 0)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void PointShadowRenderer::drawCasters(const vector<ShadowCaster> &list, const vector<unsigned int> &masks, unsigned int texture, bool clear, int modelloc, int faceOrderloc)
+{
+	GeometryArena &arena = GeometryArena::get();
+	if (layered) {
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+		if (clear) {
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+		for (unsigned int i = 0; i < list.size(); i++) {
+			const ShadowCaster &caster = list[i];
+			/* One instance per visible face, the vertex shader reads its face from faceOrder. */
+			int faceOrder = 0;
+			int faceCount = 0;
+			for (unsigned int face = 0; face < 6; face++) {
+				if (masks[i] & (1u << face)) {
+					faceOrder |= face << (3 * faceCount);
+					faceCount++;
+				}
+			}
+			if (faceCount == 0) {
+				continue;
+			}
+			glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(caster.model));
+			glUniform1i(faceOrderloc, faceOrder);
+			arena.bind(caster.geometry.format);
+			glDrawElementsInstancedBaseVertex(caster.geometry.mode, caster.geometry.indexCount, GL_UNSIGNED_INT,
+				(void*)(caster.geometry.firstIndex * sizeof(unsigned int)), faceCount, caster.geometry.baseVertex);
+			faceDraws += faceCount;
+		}
+	}
+	else {
+		for (unsigned int face = 0; face < 6; face++) {
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, texture, 0);
+			if (clear) {
+				glClear(GL_DEPTH_BUFFER_BIT);
+			}
+			glUniform1i(faceOrderloc, face);
+			for (unsigned int i = 0; i < list.size(); i++) {
+				if (masks[i] & (1u << face)) {
+					glUniformMatrix4fv(modelloc, 1, GL_FALSE, glm::value_ptr(list[i].model));
+					arena.draw(list[i].geometry);
+					faceDraws++;
+				}
+			}
+		}
+	}
+}
+
+void PointShadowRenderer::copyStaticMap()
+{
+	/* Blits work on one layer at a time, so face by face. Leaves FBO bound for drawing. */
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+	for (unsigned int face = 0; face < 6; face++) {
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, staticCubemap, 0);
+		glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, depthCubemap, 0);
+		glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+}
+
+void PointShadowRenderer::render(Shader &depthShader, const glm::vec3 &lightPos)
+{
+	PROFILE_GPU_SCOPE("point shadow");
+	faceDraws = 0;
+	staticUpdated = false;
+	skipped = false;
+	if (depthCubemap == 0) {
+		return;
+	}
+	if (lightPos != cachedLightPos) {
+		cachedLightPos = lightPos;
+		staticDirty = true;
+	}
+	if (!staticDirty && staticCastersChanged(lightPos)) {
+		staticDirty = true;
+	}
+
+	dynamicMasks.resize(dynamicCasters.size());
+	bool dynamicInRange = false;
+	for (unsigned int i = 0; i < dynamicCasters.size(); i++) {
+		dynamicMasks[i] = cullFaces(lightPos, dynamicCasters[i].center, dynamicCasters[i].radius);
+		dynamicInRange = dynamicInRange || dynamicMasks[i] != 0;
+	}
+
+	/* Nothing moved: the cubemap from the last update is still exact. */
+	if (!staticDirty && !dynamicInRange && !hasDynamic) {
+		return;
+	}
+	/* Pending changes stay flagged until the light is worth updating again. The dynamic casters then come back in
+	 * at whatever position they have. */
+	if (!inView(lightPos)) {
+		skipped = true;
+		return;
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+	glm::mat4 shadowMatrices[6];
+	for (unsigned int face = 0; face < 6; face++) {
+		shadowMatrices[face] = projection * glm::lookAt(lightPos, lightPos + FaceDirections[face], FaceUps[face]);
+	}
+
+	int viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	glViewport(0, 0, size, size);
+	glEnable(GL_DEPTH_TEST);
+
+	depthShader.use();
+	glUniformMatrix4fv(glGetUniformLocation(depthShader.ID, "shadowMatrices"), 6, GL_FALSE, glm::value_ptr(shadowMatrices[0]));
+	depthShader.setFloat("far_plane", farPlane);
+	glUniform3fv(glGetUniformLocation(depthShader.ID, "lightPos"), 1, glm::value_ptr(lightPos));
+	int modelloc = glGetUniformLocation(depthShader.ID, "model");
+	int faceOrderloc = glGetUniformLocation(depthShader.ID, "faceOrder");
+
+	if (staticDirty) {
+		staticMasks.resize(staticCasters.size());
+		for (unsigned int i = 0; i < staticCasters.size(); i++) {
+			staticMasks[i] = cullFaces(lightPos, staticCasters[i].center, staticCasters[i].radius);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+		drawCasters(staticCasters, staticMasks, staticCubemap, true, modelloc, faceOrderloc);
+		staticDirty = false;
+		staticUpdated = true;
+	}
+	copyStaticMap();
+	if (dynamicInRange) {
+		drawCasters(dynamicCasters, dynamicMasks, depthCubemap, false, modelloc, faceOrderloc);
+	}
+	hasDynamic = dynamicInRange;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void PointShadowRenderer::deleteBuffers()
+{
+	if (FBO != 0) {
+		unsigned int framebuffers[] = { FBO, staticFBO };
+		unsigned int textures[] = { depthCubemap, staticCubemap };
+		glDeleteFramebuffers(2, framebuffers);
+		glDeleteTextures(2, textures);
+		FBO = 0;
+		staticFBO = 0;
+		depthCubemap = 0;
+		staticCubemap = 0;
+	}
+	staticDirty = true;
+	hasDynamic = false;
+}
@@ -0,0 +1,293 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+/* Weight of the newest sample in the recent averages shown by summary(). */
+const double RecentWeight = 0.05;
+/* Upper bound on the events kept by a trace, about 40 MB. Long sessions keep their beginning. */
+const size_t TraceMaxEvents = 1 << 20;
+
+Profiler& Profiler::get()
+{
+	static Profiler profiler;
+	return profiler;
+}
+
+double Profiler::now() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+int Profiler::allocateQuery(FrameSlot &slot)
+{
+	/* The pool only grows, a frame with the same scopes as the last one allocates nothing. */
+	if (slot.usedQueries == slot.queries.size()) {
+		unsigned int query;
+		glGenQueries(1, &query);
+		slot.queries.push_back(query);
+	}
+	return static_cast<int>(slot.usedQueries++);
+}
+
+void Profiler::beginFrame()
+{
+	/* This slot was last filled PROFILER_FRAMES frames ago. */
+	FrameSlot &slot = frames[current];
+	resolve(slot);
+	slot.frameNumber = frameCount++;
+	slot.frameStart = now();
+}
+
+void Profiler::endFrame()
+{
+	frames[current].frameEnd = now();
+	if (openScope >= 0) {
+		std::cout << "ERROR::PROFILER::SCOPE_OPEN_AT_FRAME_END: " << frames[current].records[openScope].name << std::endl;
+		openScope = -1;
+	}
+	current = (current + 1) % PROFILER_FRAMES;
+}
+
+int Profiler::beginScope(const char *name, bool gpu)
+{
+	FrameSlot &slot = frames[current];
+	Record record;
+	record.name = name;
+	record.parent = openScope;
+	record.depth = openScope >= 0 ? slot.records[openScope].depth + 1 : 0;
+	record.startQuery = -1;
+	record.endQuery = -1;
+	if (gpu) {
+		if (tracing && !slot.calibrated) {
+			calibrate(slot);
+		}
+		record.startQuery = allocateQuery(slot);
+		record.endQuery = allocateQuery(slot);
+		glQueryCounter(slot.queries[record.startQuery], GL_TIMESTAMP);
+	}
+	record.cpuStart = now();
+	record.cpuEnd = record.cpuStart;
+	slot.records.push_back(record);
+	openScope = static_cast<int>(slot.records.size()) - 1;
+	return openScope;
+}
+
+void Profiler::endScope(int index)
+{
+	FrameSlot &slot = frames[current];
+	/* A frame boundary inside the scope drops it. */
+	if (index < 0 || index >= static_cast<int>(slot.records.size()) || index != openScope) {
+		return;
+	}
+	Record &record = slot.records[index];
+	if (record.endQuery >= 0) {
+		glQueryCounter(slot.queries[record.endQuery], GL_TIMESTAMP);
+	}
+	record.cpuEnd = now();
+	openScope = record.parent;
+}
+
+void Profiler::flush()
+{
+	/* Oldest first, after endFrame() the current slot is the oldest one. */
+	for (unsigned int i = 0; i < PROFILER_FRAMES; i++) {
+		resolve(frames[(current + i) % PROFILER_FRAMES]);
+	}
+}
+
+void Profiler::calibrate(FrameSlot &slot)
+{
+	/* The GL time of this call, read without waiting for the GPU. Taking it next to the CPU time gives the offset
+	 * between the clocks up to the latency of the call itself. */
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	slot.gpuOffset = now() - gpuTime / 1000000.0;
+	slot.calibrated = true;
+}
+
+void Profiler::resolve(FrameSlot &slot)
+{
+	std::unique_lock<std::mutex> traceLock(traceMutex, std::defer_lock);
+	bool trace = tracing;
+	if (trace) {
+		traceLock.lock();
+		if (slot.frameStart >= 0.0 && slot.frameEnd >= slot.frameStart) {
+			traceEvents.push_back(TraceEvent{ "frame", TRACE_MAIN_THREAD, slot.frameNumber, slot.frameStart, slot.frameEnd - slot.frameStart });
+		}
+	}
+
+	vector<string> paths(slot.records.size());
+	for (unsigned int i = 0; i < slot.records.size(); i++) {
+		const Record &record = slot.records[i];
+		paths[i] = record.parent >= 0 ? paths[record.parent] + "/" + record.name : string(record.name);
+
+		auto found = statIndex.find(paths[i]);
+		if (found == statIndex.end()) {
+			ProfileStats added;
+			added.path = paths[i];
+			added.name = record.name;
+			added.depth = record.depth;
+			added.gpu = record.startQuery >= 0;
+			found = statIndex.insert(std::make_pair(paths[i], static_cast<unsigned int>(stats.size()))).first;
+			stats.push_back(added);
+		}
+		ProfileStats &stat = stats[found->second];
+
+		double cpu = record.cpuEnd - record.cpuStart;
+		double gpu = 0.0;
+		if (record.startQuery >= 0) {
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(slot.queries[record.startQuery], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(slot.queries[record.endQuery], GL_QUERY_RESULT, &end);
+			gpu = end > start ? (end - start) / 1000000.0 : 0.0;
+			if (trace && slot.calibrated) {
+				traceEvents.push_back(TraceEvent{ record.name, TRACE_GPU_THREAD, slot.frameNumber, start / 1000000.0 + slot.gpuOffset, gpu });
+			}
+		}
+		if (trace) {
+			traceEvents.push_back(TraceEvent{ record.name, TRACE_MAIN_THREAD, slot.frameNumber, record.cpuStart, cpu });
+		}
+
+		if (stat.count == 0) {
+			stat.cpuMin = stat.cpuMax = stat.cpuRecent = cpu;
+			stat.gpuMin = stat.gpuMax = stat.gpuRecent = gpu;
+		}
+		stat.count++;
+		stat.cpuLast = cpu;
+		stat.cpuTotal += cpu;
+		stat.cpuMin = std::min(stat.cpuMin, cpu);
+		stat.cpuMax = std::max(stat.cpuMax, cpu);
+		stat.cpuRecent += (cpu - stat.cpuRecent) * RecentWeight;
+		stat.gpuLast = gpu;
+		stat.gpuTotal += gpu;
+		stat.gpuMin = std::min(stat.gpuMin, gpu);
+		stat.gpuMax = std::max(stat.gpuMax, gpu);
+		stat.gpuRecent += (gpu - stat.gpuRecent) * RecentWeight;
+	}
+	if (trace && traceEvents.size() > TraceMaxEvents) {
+		std::cout << "ERROR::PROFILER::TRACE_FULL: tracing stopped after " << traceEvents.size() << " events" << std::endl;
+		tracing = false;
+	}
+	slot.records.clear();
+	slot.usedQueries = 0;
+	slot.calibrated = false;
+	slot.frameStart = -1.0;
+	slot.frameEnd = -1.0;
+}
+
+string Profiler::summary(int maxDepth) const
+{
+	string line;
+	char buffer[128];
+	for (unsigned int i = 0; i < stats.size(); i++) {
+		const ProfileStats &stat = stats[i];
+		if (stat.depth > maxDepth) {
+			continue;
+		}
+		if (stat.gpu) {
+			std::snprintf(buffer, sizeof(buffer), "%s%s %.2f/%.2f ms", line.empty() ? "" : " | ", stat.name.c_str(), stat.cpuRecent, stat.gpuRecent);
+		}
+		else {
+			std::snprintf(buffer, sizeof(buffer), "%s%s %.2f ms", line.empty() ? "" : " | ", stat.name.c_str(), stat.cpuRecent);
+		}
+		line += buffer;
+	}
+	return line;
+}
+
+bool Profiler::writeReport(const string &path) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::PROFILER::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	file << "{\n  \"scopes\": [";
+	for (unsigned int i = 0; i < stats.size(); i++) {
+		const ProfileStats &stat = stats[i];
+		double count = stat.count > 0 ? stat.count : 1.0;
+		file << (i == 0 ? "\n" : ",\n") << "    { \"path\": \"" << stat.path << "\", \"depth\": " << stat.depth << ", \"count\": " << stat.count
+			<< ", \"cpu_ms\": { \"avg\": " << stat.cpuTotal / count << ", \"min\": " << stat.cpuMin << ", \"max\": " << stat.cpuMax << " }";
+		if (stat.gpu) {
+			file << ", \"gpu_ms\": { \"avg\": " << stat.gpuTotal / count << ", \"min\": " << stat.gpuMin << ", \"max\": " << stat.gpuMax << " }";
+		}
+		file << " }";
+	}
+	file << (stats.empty() ? "]\n" : "\n  ]\n") << "}\n";
+	return true;
+}
+
+void Profiler::setTracing(bool enable)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (enable) {
+		/* Tracing is switched from the GL thread, whose events go on the main track. */
+		mainThread = std::this_thread::get_id();
+	}
+	tracing = enable;
+}
+
+void Profiler::addThreadEvent(const char *name, double start, double end)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	if (!tracing) {
+		return;
+	}
+	unsigned int thread = TRACE_MAIN_THREAD;
+	std::thread::id id = std::this_thread::get_id();
+	if (id != mainThread) {
+		auto found = workerThreads.find(id);
+		if (found == workerThreads.end()) {
+			found = workerThreads.insert(std::make_pair(id, TRACE_FIRST_WORKER + static_cast<unsigned int>(workerThreads.size()))).first;
+		}
+		thread = found->second;
+	}
+	/* frameCount is already past the frame in progress. */
+	unsigned int frame = frameCount;
+	traceEvents.push_back(TraceEvent{ name, thread, frame > 0 ? frame - 1 : 0, start, end - start });
+}
+
+bool Profiler::writeTrace(const string &path)
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::PROFILER::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	/* Chrome trace format: complete ("X") events in microseconds, plus metadata naming the process and threads. */
+	file << "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n";
+	file << "    { \"ph\": \"M\", \"pid\": 1, \"name\": \"process_name\", \"args\": { \"name\": \"Aurora\" } },\n";
+	file << "    { \"ph\": \"M\", \"pid\": 1, \"tid\": " << TRACE_MAIN_THREAD << ", \"name\": \"thread_name\", \"args\": { \"name\": \"main\" } },\n";
+	file << "    { \"ph\": \"M\", \"pid\": 1, \"tid\": " << TRACE_GPU_THREAD << ", \"name\": \"thread_name\", \"args\": { \"name\": \"GPU\" } }";
+	for (const auto &worker : workerThreads) {
+		file << ",\n    { \"ph\": \"M\", \"pid\": 1, \"tid\": " << worker.second << ", \"name\": \"thread_name\", \"args\": { \"name\": \"worker "
+			<< worker.second - TRACE_FIRST_WORKER << "\" } }";
+	}
+
+	char buffer[64];
+	for (const TraceEvent &event : traceEvents) {
+		std::snprintf(buffer, sizeof(buffer), "%.3f, \"dur\": %.3f", event.start * 1000.0, event.duration * 1000.0);
+		file << ",\n    { \"ph\": \"X\", \"pid\": 1, \"tid\": " << event.thread << ", \"name\": \"" << event.name
+			<< "\", \"ts\": " << buffer << ", \"args\": { \"frame\": " << event.frame << " } }";
+	}
+	file << "\n  ]\n}\n";
+	return true;
+}
+
+void Profiler::deleteQueries()
+{
+	for (unsigned int i = 0; i < PROFILER_FRAMES; i++) {
+		if (!frames[i].queries.empty()) {
+			glDeleteQueries(static_cast<GLsizei>(frames[i].queries.size()), frames[i].queries.data());
+		}
+		frames[i].queries.clear();
+		frames[i].records.clear();
+		frames[i].usedQueries = 0;
+	}
+	openScope = -1;
+}
@@ -0,0 +1,515 @@
+#include "render_graph.h"
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+static bool contains(const vector<RenderResource> &list, RenderResource resource)
+{
+	return std::find(list.begin(), list.end(), resource) != list.end();
+}
+
+static bool isDepth(const RenderTargetDesc &desc)
+{
+	return desc.format == GL_DEPTH_COMPONENT || desc.format == GL_DEPTH_STENCIL;
+}
+
+static bool sameFormat(const RenderTargetDesc &a, const RenderTargetDesc &b)
+{
+	return a.internalFormat == b.internalFormat && a.format == b.format && a.type == b.type && a.samples == b.samples
+		&& a.filter == b.filter;
+}
+
+static size_t textureBytes(const RenderTargetDesc &desc, int width, int height)
+{
+	return GLResources::texelSize(desc.internalFormat) * width * height * std::max(desc.samples, 1);
+}
+
+RenderGraph::RenderGraph() : width(0), height(0), dirty(true), currentPass(-1)
+{
+}
+
+RenderResource RenderGraph::createTexture(const string &name, const RenderTargetDesc &desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.desc = desc;
+	resources.push_back(resource);
+	dirty = true;
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::importFramebuffer(const string &name, unsigned int framebuffer)
+{
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.framebuffer = framebuffer;
+	resources.push_back(resource);
+	dirty = true;
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderResource RenderGraph::importTexture(const string &name)
+{
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.texture = true;
+	resources.push_back(resource);
+	dirty = true;
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+int RenderGraph::addPass(const char *name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = std::move(execute);
+	passes.push_back(std::move(pass));
+	dirty = true;
+	return static_cast<int>(passes.size() - 1);
+}
+
+void RenderGraph::read(int pass, RenderResource resource)
+{
+	if (!contains(passes[pass].reads, resource)) {
+		passes[pass].reads.push_back(resource);
+		dirty = true;
+	}
+}
+
+void RenderGraph::write(int pass, RenderResource resource)
+{
+	if (!contains(passes[pass].writes, resource)) {
+		passes[pass].writes.push_back(resource);
+		dirty = true;
+	}
+}
+
+void RenderGraph::setOutput(RenderResource resource)
+{
+	resources[resource].output = true;
+	dirty = true;
+}
+
+void RenderGraph::setBenchmarked(int pass, bool benchmarked)
+{
+	passes[pass].benchmarked = benchmarked;
+}
+
+void RenderGraph::resize(int width, int height)
+{
+	/* A minimized window reports 0 x 0, keep the targets until it comes back. */
+	if (width <= 0 || height <= 0 || (width == this->width && height == this->height)) {
+		return;
+	}
+	this->width = width;
+	this->height = height;
+	dirty = true;
+}
+
+bool RenderGraph::compile()
+{
+	dirty = false;
+	cull();
+	if (!sort()) {
+		order.clear();
+		deleteTargets();
+		dirty = false;
+		return false;
+	}
+	allocate();
+	createFramebuffers();
+	return true;
+}
+
+/* A pass is kept if it writes an output, or something a kept pass reads. */
+void RenderGraph::cull()
+{
+	for (Pass &pass : passes) {
+		pass.live = false;
+		for (RenderResource resource : pass.writes) {
+			pass.live = pass.live || resources[resource].output;
+		}
+	}
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (const Pass &pass : passes) {
+			if (!pass.live) {
+				continue;
+			}
+			for (RenderResource resource : pass.reads) {
+				for (Pass &writer : passes) {
+					if (!writer.live && contains(writer.writes, resource)) {
+						writer.live = true;
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Topological sort of the kept passes, always taking the first one added among those whose dependencies ran, so an
+ * already valid order is left alone. */
+bool RenderGraph::sort()
+{
+	size_t count = passes.size();
+	vector<vector<int>> successors(count);
+	vector<int> dependencies(count, 0);
+	auto addEdge = [&](int from, int to) {
+		successors[from].push_back(to);
+		dependencies[to]++;
+	};
+	for (size_t resource = 0; resource < resources.size(); resource++) {
+		vector<int> writers;
+		for (size_t i = 0; i < count; i++) {
+			if (passes[i].live && contains(passes[i].writes, static_cast<RenderResource>(resource))) {
+				if (!writers.empty()) {
+					addEdge(writers.back(), static_cast<int>(i));
+				}
+				writers.push_back(static_cast<int>(i));
+			}
+		}
+		for (size_t i = 0; i < count; i++) {
+			if (passes[i].live && contains(passes[i].reads, static_cast<RenderResource>(resource))
+				&& !contains(passes[i].writes, static_cast<RenderResource>(resource))) {
+				for (int writer : writers) {
+					addEdge(writer, static_cast<int>(i));
+				}
+			}
+		}
+	}
+
+	order.clear();
+	vector<bool> done(count, false);
+	size_t live = 0;
+	for (const Pass &pass : passes) {
+		live += pass.live ? 1 : 0;
+	}
+	while (order.size() < live) {
+		int next = -1;
+		for (size_t i = 0; i < count && next < 0; i++) {
+			if (passes[i].live && !done[i] && dependencies[i] == 0) {
+				next = static_cast<int>(i);
+			}
+		}
+		if (next < 0) {
+			std::cout << "ERROR::RENDER_GRAPH::CYCLE:";
+			for (size_t i = 0; i < count; i++) {
+				if (passes[i].live && !done[i]) {
+					std::cout << " " << passes[i].name;
+				}
+			}
+			std::cout << std::endl;
+			return false;
+		}
+		done[next] = true;
+		order.push_back(next);
+		for (int successor : successors[next]) {
+			dependencies[successor]--;
+		}
+	}
+	return true;
+}
+
+/* Lifetimes are positions in the order, a texture is free for another transient once the pass of its last use ran.
+ * Transients are placed in order of first use, each into the first free texture of its format and size. */
+void RenderGraph::allocate()
+{
+	textures.clear();
+	for (Resource &resource : resources) {
+		resource.physical = -1;
+		resource.firstUse = -1;
+		resource.lastUse = -1;
+		if (resource.imported) {
+			resource.width = width;
+			resource.height = height;
+		}
+		else {
+			resource.width = resource.desc.width > 0 ? resource.desc.width : std::max(static_cast<int>(width * resource.desc.scale), 1);
+			resource.height = resource.desc.height > 0 ? resource.desc.height : std::max(static_cast<int>(height * resource.desc.scale), 1);
+		}
+	}
+	for (size_t position = 0; position < order.size(); position++) {
+		const Pass &pass = passes[order[position]];
+		for (const vector<RenderResource> *list : { &pass.reads, &pass.writes }) {
+			for (RenderResource index : *list) {
+				Resource &resource = resources[index];
+				if (resource.firstUse < 0) {
+					resource.firstUse = static_cast<int>(position);
+				}
+				resource.lastUse = static_cast<int>(position);
+			}
+		}
+	}
+
+	vector<int> transients;
+	for (size_t i = 0; i < resources.size(); i++) {
+		if (!resources[i].imported && resources[i].firstUse >= 0) {
+			transients.push_back(static_cast<int>(i));
+		}
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](int a, int b) { return resources[a].firstUse < resources[b].firstUse; });
+	for (int index : transients) {
+		Resource &resource = resources[index];
+		if (!contains(passes[order[resource.firstUse]].writes, index)) {
+			std::cout << "ERROR::RENDER_GRAPH::READ_BEFORE_WRITE: " << resource.name << " is read by "
+				<< passes[order[resource.firstUse]].name << " before any pass writes it" << std::endl;
+		}
+		for (size_t i = 0; i < textures.size() && resource.physical < 0; i++) {
+			Texture &texture = textures[i];
+			if (texture.lastUse < resource.firstUse && sameFormat(texture.desc, resource.desc) && texture.width == resource.width
+				&& texture.height == resource.height) {
+				resource.physical = static_cast<int>(i);
+			}
+		}
+		if (resource.physical < 0) {
+			Texture texture;
+			texture.desc = resource.desc;
+			texture.width = resource.width;
+			texture.height = resource.height;
+			textures.push_back(std::move(texture));
+			resource.physical = static_cast<int>(textures.size() - 1);
+		}
+		Texture &texture = textures[resource.physical];
+		texture.lastUse = resource.lastUse;
+		texture.label += (texture.label.empty() ? "" : ", ") + resource.name;
+	}
+
+	for (Texture &texture : textures) {
+		texture.texture.create(texture.label, GL_SITE);
+		if (texture.desc.samples > 0) {
+			glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, texture.texture);
+			glTexImage2DMultisample(GL_TEXTURE_2D_MULTISAMPLE, texture.desc.samples, texture.desc.internalFormat, texture.width,
+				texture.height, GL_TRUE);
+			glBindTexture(GL_TEXTURE_2D_MULTISAMPLE, 0);
+			continue;
+		}
+		glBindTexture(GL_TEXTURE_2D, texture.texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, texture.desc.internalFormat, texture.width, texture.height, 0, texture.desc.format,
+			texture.desc.type, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.desc.filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, texture.desc.filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+void RenderGraph::createFramebuffers()
+{
+	if (readFramebuffer.id() == 0) {
+		readFramebuffer.create("render graph blit", GL_SITE);
+	}
+	for (Pass &pass : passes) {
+		pass.framebuffer.reset();
+		pass.target = 0;
+	}
+	for (int index : order) {
+		Pass &pass = passes[index];
+		bool imported = false, transient = false;
+		pass.width = width;
+		pass.height = height;
+		for (RenderResource write : pass.writes) {
+			const Resource &resource = resources[write];
+			if (resource.imported && !resource.texture) {
+				imported = true;
+				pass.target = resource.framebuffer;
+				pass.width = resource.width;
+				pass.height = resource.height;
+			}
+			else if (!resource.imported) {
+				transient = true;
+			}
+		}
+		if (imported) {
+			if (transient) {
+				std::cout << "ERROR::RENDER_GRAPH::MIXED_TARGETS: " << pass.name
+					<< " writes an imported framebuffer and transients, only the framebuffer is bound" << std::endl;
+			}
+			continue;
+		}
+		if (!transient) {
+			continue;
+		}
+
+		pass.framebuffer.create(pass.name, GL_SITE);
+		pass.target = pass.framebuffer;
+		glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+		vector<GLenum> drawBuffers;
+		bool sized = false;
+		for (RenderResource write : pass.writes) {
+			const Resource &resource = resources[write];
+			if (resource.imported) {
+				continue;
+			}
+			GLenum target = resource.desc.samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+			GLenum attachment;
+			if (resource.desc.format == GL_DEPTH_STENCIL) {
+				attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+			}
+			else if (resource.desc.format == GL_DEPTH_COMPONENT) {
+				attachment = GL_DEPTH_ATTACHMENT;
+			}
+			else {
+				attachment = GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(drawBuffers.size());
+				drawBuffers.push_back(attachment);
+			}
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, target, textures[resource.physical].texture, 0);
+			/* The viewport covers the first color target, or the depth target of depth only passes. */
+			if (!sized || (drawBuffers.size() == 1 && attachment == GL_COLOR_ATTACHMENT0)) {
+				pass.width = resource.width;
+				pass.height = resource.height;
+				sized = true;
+			}
+		}
+		if (drawBuffers.empty()) {
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+		else {
+			glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+		}
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			std::cout << "ERROR::RENDER_GRAPH::FRAMEBUFFER_INCOMPLETE: " << pass.name << std::endl;
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::execute(Benchmark *benchmark)
+{
+	if (dirty) {
+		compile();
+	}
+	for (int index : order) {
+		Pass &pass = passes[index];
+		bool benchmarked = benchmark && pass.benchmarked;
+		if (benchmarked) {
+			benchmark->beginPass(pass.name);
+		}
+		{
+			PROFILE_GPU_SCOPE(pass.name);
+			glBindFramebuffer(GL_FRAMEBUFFER, pass.target);
+			glViewport(0, 0, pass.width, pass.height);
+			currentPass = index;
+			pass.execute();
+		}
+		if (benchmarked) {
+			benchmark->endPass();
+		}
+	}
+	currentPass = -1;
+}
+
+unsigned int RenderGraph::getTexture(RenderResource resource) const
+{
+	int physical = resources[resource].physical;
+	return physical < 0 ? 0 : textures[physical].texture.id();
+}
+
+void RenderGraph::blit(RenderResource source) const
+{
+	const Resource &resource = resources[source];
+	if (resource.physical < 0 || isDepth(resource.desc)) {
+		std::cout << "ERROR::RENDER_GRAPH::BLIT: " << resource.name << " is not a color target of this frame" << std::endl;
+		return;
+	}
+	const Texture &texture = textures[resource.physical];
+	int destinationWidth = currentPass >= 0 ? passes[currentPass].width : width;
+	int destinationHeight = currentPass >= 0 ? passes[currentPass].height : height;
+	/* Resolving needs the same size on both sides, and any filtering is wasted on a copy. */
+	bool copy = texture.desc.samples > 0 || (texture.width == destinationWidth && texture.height == destinationHeight);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture.desc.samples > 0 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D,
+		texture.texture, 0);
+	glBlitFramebuffer(0, 0, texture.width, texture.height, 0, 0, destinationWidth, destinationHeight, GL_COLOR_BUFFER_BIT,
+		copy ? GL_NEAREST : GL_LINEAR);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, currentPass >= 0 ? passes[currentPass].target : 0);
+}
+
+size_t RenderGraph::allocatedBytes() const
+{
+	size_t bytes = 0;
+	for (const Texture &texture : textures) {
+		bytes += textureBytes(texture.desc, texture.width, texture.height);
+	}
+	return bytes;
+}
+
+size_t RenderGraph::unaliasedBytes() const
+{
+	size_t bytes = 0;
+	for (const Resource &resource : resources) {
+		if (resource.physical >= 0) {
+			bytes += textureBytes(resource.desc, resource.width, resource.height);
+		}
+	}
+	return bytes;
+}
+
+string RenderGraph::summary() const
+{
+	char line[128];
+	std::snprintf(line, sizeof(line), "%u/%u passes, %u targets %s (%s unaliased)", static_cast<unsigned int>(order.size()),
+		static_cast<unsigned int>(passes.size()), static_cast<unsigned int>(textures.size()), GLResources::memorySize(allocatedBytes()).c_str(),
+		GLResources::memorySize(unaliasedBytes()).c_str());
+	return line;
+}
+
+void RenderGraph::report(std::ostream &out) const
+{
+	out << "Render graph " << width << "x" << height << ": " << summary() << "\n";
+	for (int index : order) {
+		const Pass &pass = passes[index];
+		char name[32];
+		std::snprintf(name, sizeof(name), "  %-16s", pass.name);
+		out << name;
+		const char *separator = "";
+		if (!pass.reads.empty()) {
+			out << "reads";
+			for (size_t i = 0; i < pass.reads.size(); i++) {
+				out << (i == 0 ? " " : ", ") << resources[pass.reads[i]].name;
+			}
+			separator = ", ";
+		}
+		if (!pass.writes.empty()) {
+			out << separator << "writes";
+			for (size_t i = 0; i < pass.writes.size(); i++) {
+				out << (i == 0 ? " " : ", ") << resources[pass.writes[i]].name;
+			}
+		}
+		out << "\n";
+	}
+	for (const Pass &pass : passes) {
+		if (!pass.live) {
+			out << "  " << pass.name << " culled\n";
+		}
+	}
+	for (size_t i = 0; i < textures.size(); i++) {
+		const Texture &texture = textures[i];
+		char line[96];
+		std::snprintf(line, sizeof(line), "  texture %-2u %5dx%-5d x%d %10s  ", static_cast<unsigned int>(i), texture.width, texture.height,
+			std::max(texture.desc.samples, 1), GLResources::memorySize(textureBytes(texture.desc, texture.width, texture.height)).c_str());
+		out << line << texture.label << "\n";
+	}
+}
+
+void RenderGraph::deleteTargets()
+{
+	textures.clear();
+	for (Pass &pass : passes) {
+		pass.framebuffer.reset();
+		pass.target = 0;
+	}
+	for (Resource &resource : resources) {
+		resource.physical = -1;
+	}
+	readFramebuffer.reset();
+	dirty = true;
+}
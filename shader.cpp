@@ -1,116 +1,370 @@
 #include "shader.h"
+#include "profiler.h"
+#include "gl_resources.h"
 
-/* :: is the scope resolution operator. 
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <set>
+
+/* :: is the scope resolution operator.
  * Use it when trying to access members/functions/variables that are inside a class */
 
+/* Compiled permutations, shared by every Shader built from the same sources and defines. */
+struct CachedProgram {
+	unsigned int ID;
+	int references;
+};
+static std::map<std::string, CachedProgram> programCache;
+
+/* Result of preprocessing one stage, valid as long as none of its files changed. */
+struct PreprocessedSource {
+	std::string code;
+	std::vector<std::string> files;
+	std::vector<std::filesystem::file_time_type> times;
+};
+static std::map<std::string, PreprocessedSource> preprocessCache;
+
+const int MaxIncludeDepth = 32;
+
+static bool upToDate(const PreprocessedSource& source)
+{
+	for (unsigned int i = 0; i < source.files.size(); i++) {
+		std::error_code error;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(source.files[i], error);
+		if (error || time != source.times[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Appends path to result.code with its includes expanded in place. */
+static void expandIncludes(const std::string& path, const std::string& code, PreprocessedSource& result, std::set<std::string>& included, int depth)
+{
+	int fileIndex = static_cast<int>(result.files.size());
+	std::error_code error;
+	result.files.push_back(path);
+	result.times.push_back(std::filesystem::last_write_time(path, error));
+
+	std::filesystem::path directory = std::filesystem::path(path).parent_path();
+	std::istringstream lines(code);
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(lines, line)) {
+		lineNumber++;
+
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+			result.code += line + "\n";
+			continue;
+		}
+
+		size_t open = line.find('"', start);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos) {
+			std::cout << "ERROR::SHADER::INCLUDE::MALFORMED " << path << "(" << lineNumber << ")" << std::endl;
+			result.code += "\n";
+			continue;
+		}
+
+		std::string includePath = (directory / line.substr(open + 1, close - open - 1)).lexically_normal().generic_string();
+		/* Files already pulled into this stage are skipped, which acts as an implicit include guard. */
+		if (included.count(includePath) || depth >= MaxIncludeDepth) {
+			result.code += "\n";
+			continue;
+		}
+		included.insert(includePath);
+
+		std::string includeCode = Shader::readFile(includePath);
+		result.code += "#line 1 " + std::to_string(result.files.size()) + "\n";
+		expandIncludes(includePath, includeCode, result, included, depth + 1);
+		result.code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+	}
+}
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath) {
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const ShaderDefines& defines) : Shader(vertexPath, fragmentPath, nullptr, defines)
+{
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const ShaderDefines& defines)
+	: vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath != nullptr ? geometryPath : ""), defines(defines)
+{
+	if (!build(ID, cacheKey)) {
+		/* The broken program stays with this instance, out of the cache, so a later Shader of the same sources
+		 * compiles them again. deleteProgram() releases it. */
+		cacheKey.clear();
+	}
+}
 
-	std::string vertexCode;
+bool Shader::build(unsigned int& program, std::string& key)
+{
+	std::vector<std::string> vertexFiles, fragmentFiles, geometryFiles;
+	std::string vertexCode = preprocess(vertexPath.c_str(), vertexFiles);
+	std::string fragmentCode = preprocess(fragmentPath.c_str(), fragmentFiles);
 	std::string geometryCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream gShaderFile;
-	std::ifstream fShaderFile;
+	if (!geometryPath.empty()) {
+		geometryCode = preprocess(geometryPath.c_str(), geometryFiles);
+	}
+	sourceFiles = vertexFiles;
+	for (const std::vector<std::string>* files : { &fragmentFiles, &geometryFiles }) {
+		for (const std::string& file : *files) {
+			if (std::find(sourceFiles.begin(), sourceFiles.end(), file) == sourceFiles.end()) {
+				sourceFiles.push_back(file);
+			}
+		}
+	}
 
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	/* Key: hash of the raw sources plus the canonical define list. */
+	std::string defineList;
+	for (const auto& define : defines) {
+		defineList += define.first + "=" + define.second + ";";
+	}
+	size_t sourceHash = std::hash<std::string>()(vertexCode + '\0' + geometryCode + '\0' + fragmentCode);
+	key = std::to_string(sourceHash) + "|" + defineList;
+
+	auto cached = programCache.find(key);
+	if (cached != programCache.end()) {
+		cached->second.references++;
+		program = cached->second.ID;
+		return true;
+	}
+
+	/* Only cache misses, the compiles that can cause a hitch. */
+	PROFILE_CPU_SCOPE("shader compile");
+	bool success = true;
+	unsigned int vertex = compileStage(GL_VERTEX_SHADER, injectDefines(vertexCode, defines), "VERTEX", vertexFiles, success);
+	unsigned int fragment = compileStage(GL_FRAGMENT_SHADER, injectDefines(fragmentCode, defines), "FRAGMENT", fragmentFiles, success);
+	unsigned int geometry = 0;
+	if (!geometryPath.empty()) {
+		geometry = compileStage(GL_GEOMETRY_SHADER, injectDefines(geometryCode, defines), "GEOMETRY", geometryFiles, success);
+	}
+
+	program = linkProgram(vertex, fragment, geometry, success);
+	GL_LABEL(RESOURCE_PROGRAM, program, vertexPath + " " + fragmentPath + (defineList.empty() ? "" : " " + defineList));
 
+	/* Delete Shaders after use */
+	glDeleteShader(vertex);
+	if (geometry != 0) {
+		glDeleteShader(geometry);
+	}
+	glDeleteShader(fragment);
+
+	if (success) {
+		programCache[key] = CachedProgram{ program, 1 };
+	}
+	return success;
+}
+
+bool Shader::reload()
+{
+	unsigned int program;
+	std::string key;
+	if (!build(program, key)) {
+		glDeleteProgram(program);
+		std::cout << "ERROR::SHADER::RELOAD_FAILED " << fragmentPath << ", keeping the previous program" << std::endl;
+		return false;
+	}
+	if (key == cacheKey) {
+		/* Saved without changing anything that ends up in the program. */
+		programCache[key].references--;
+		return true;
+	}
+
+	copyProgramState(ID, program);
+	deleteProgram();
+	ID = program;
+	cacheKey = key;
+	/* Samplers the new source added still need their units. */
+	materialSamplers = -1;
+	return true;
+}
+
+/* Copies one uniform, or one element of an array, between programs. The target program must be in use. */
+static void copyUniform(unsigned int from, int source, int target, GLenum type)
+{
+	float f[16];
+	int i[4];
+	unsigned int u;
+	switch (type) {
+	case GL_FLOAT:		glGetUniformfv(from, source, f); glUniform1fv(target, 1, f); break;
+	case GL_FLOAT_VEC2:	glGetUniformfv(from, source, f); glUniform2fv(target, 1, f); break;
+	case GL_FLOAT_VEC3:	glGetUniformfv(from, source, f); glUniform3fv(target, 1, f); break;
+	case GL_FLOAT_VEC4:	glGetUniformfv(from, source, f); glUniform4fv(target, 1, f); break;
+	case GL_FLOAT_MAT2:	glGetUniformfv(from, source, f); glUniformMatrix2fv(target, 1, GL_FALSE, f); break;
+	case GL_FLOAT_MAT3:	glGetUniformfv(from, source, f); glUniformMatrix3fv(target, 1, GL_FALSE, f); break;
+	case GL_FLOAT_MAT4:	glGetUniformfv(from, source, f); glUniformMatrix4fv(target, 1, GL_FALSE, f); break;
+	case GL_INT_VEC2:
+	case GL_BOOL_VEC2:	glGetUniformiv(from, source, i); glUniform2iv(target, 1, i); break;
+	case GL_INT_VEC3:
+	case GL_BOOL_VEC3:	glGetUniformiv(from, source, i); glUniform3iv(target, 1, i); break;
+	case GL_INT_VEC4:
+	case GL_BOOL_VEC4:	glGetUniformiv(from, source, i); glUniform4iv(target, 1, i); break;
+	case GL_UNSIGNED_INT:	glGetUniformuiv(from, source, &u); glUniform1ui(target, u); break;
+	case GL_DOUBLE:
+	case GL_DOUBLE_VEC2:
+	case GL_DOUBLE_VEC3:
+	case GL_DOUBLE_VEC4:	break;
+	/* int, bool and every sampler type. */
+	default:		glGetUniformiv(from, source, i); glUniform1i(target, i[0]); break;
+	}
+}
+
+void Shader::copyProgramState(unsigned int from, unsigned int to)
+{
+	int previous;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+	glUseProgram(to);
+
+	int count, maxLength;
+	glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(from, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+	std::vector<char> name(maxLength + 1);
+	for (int index = 0; index < count; index++) {
+		int size;
+		GLenum type;
+		glGetActiveUniform(from, index, maxLength + 1, NULL, &size, &type, name.data());
+
+		/* Arrays are reported once as name[0], but every element has its own location. */
+		std::string base = name.data();
+		if (size > 1 && base.size() > 3 && base.compare(base.size() - 3, 3, "[0]") == 0) {
+			base.erase(base.size() - 3);
+		}
+		for (int element = 0; element < size; element++) {
+			std::string elementName = size > 1 ? base + "[" + std::to_string(element) + "]" : base;
+			/* Uniforms inside blocks have no location and live in their buffers. */
+			int source = glGetUniformLocation(from, elementName.c_str());
+			int target = glGetUniformLocation(to, elementName.c_str());
+			if (source >= 0 && target >= 0) {
+				copyUniform(from, source, target, type);
+			}
+		}
+	}
+
+	glGetProgramiv(from, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	char blockName[256];
+	for (int index = 0; index < count; index++) {
+		int binding;
+		glGetActiveUniformBlockName(from, index, sizeof(blockName), NULL, blockName);
+		glGetActiveUniformBlockiv(from, index, GL_UNIFORM_BLOCK_BINDING, &binding);
+		unsigned int blockIndex = glGetUniformBlockIndex(to, blockName);
+		if (blockIndex != GL_INVALID_INDEX) {
+			glUniformBlockBinding(to, blockIndex, binding);
+		}
+	}
+
+	glUseProgram(previous);
+}
+
+std::string Shader::readFile(const std::string& path)
+{
+	std::ifstream shaderFile;
+	// ensure ifstream objects can throw exceptions:
+	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 	try {
-		//open files
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, gShaderStream, fShaderStream;
-		// read file's buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		// close file handlers
-		vShaderFile.close();
-		fShaderFile.close();
-		// convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-
-		if (geometryPath != nullptr)
-		{
-			gShaderFile.open(geometryPath);
-			std::stringstream gShaderStream;
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
-			geometryCode = gShaderStream.str();
+		shaderFile.open(path);
+		std::stringstream shaderStream;
+		shaderStream << shaderFile.rdbuf();
+		shaderFile.close();
+		return shaderStream.str();
+	}
+	catch (std::ifstream::failure& e) {
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << path << "\n" << std::endl;
+	}
+	return std::string();
+}
+
+const std::string& Shader::preprocess(const char* path, std::vector<std::string>& files)
+{
+	auto cached = preprocessCache.find(path);
+	if (cached == preprocessCache.end() || !upToDate(cached->second)) {
+		PreprocessedSource result;
+		std::set<std::string> included;
+		included.insert(path);
+		expandIncludes(path, readFile(path), result, included, 0);
+		cached = preprocessCache.insert_or_assign(path, result).first;
+	}
+	files = cached->second.files;
+	return cached->second.code;
+}
+
+std::string Shader::injectDefines(const std::string& source, const ShaderDefines& defines)
+{
+	if (defines.empty()) {
+		return source;
+	}
+
+	/* #version has to stay the first statement, so the defines go on the line after it. */
+	size_t insertAt = 0;
+	int versionLine = 0;
+	size_t version = source.find("#version");
+	if (version != std::string::npos) {
+		size_t lineEnd = source.find('\n', version);
+		insertAt = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+		for (size_t i = 0; i < insertAt; i++) {
+			if (source[i] == '\n') {
+				versionLine++;
+			}
 		}
 	}
-	catch (std::ifstream::failure e) {
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ\n" << std::endl;
+
+	std::string injected;
+	for (const auto& define : defines) {
+		injected += "#define " + define.first + " " + define.second + "\n";
+	}
+	injected += "#line " + std::to_string(versionLine + 1) + "\n";
+
+	std::string result = source.substr(0, insertAt);
+	if (insertAt > 0 && result.back() != '\n') {
+		result += '\n';
 	}
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+	return result + injected + source.substr(insertAt);
+}
 
-	unsigned int vertex, fragment;
+unsigned int Shader::compileStage(GLenum type, const std::string& source, const char* stageName, const std::vector<std::string>& files, bool& compiled)
+{
 	int success;
 	char infoLog[512];
+	const char* code = source.c_str();
 
-	/* Vertex Shader */
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
-	// Handle shader compilation errors
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	/* Fragment Shader */
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
+	unsigned int stage = glCreateShader(type);
+	glShaderSource(stage, 1, &code, NULL);
+	glCompileShader(stage);
 	// Handle shader compilation errors
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+	glGetShaderiv(stage, GL_COMPILE_STATUS, &success);
 	if (!success) {
-		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-	}
-
-	unsigned int geometry;
-	if (geometryPath != nullptr)
-	{
-		const char* gShaderCode = geometryCode.c_str();
-		/* Geometry Shader */
-		geometry = glCreateShader(GL_GEOMETRY_SHADER);
-		glShaderSource(geometry, 1, &gShaderCode, NULL);
-		glCompileShader(geometry);
-		// Handle shader compilation errors
-		glGetShaderiv(geometry, GL_COMPILE_STATUS, &success);
-		if (!success) {
-			glGetShaderInfoLog(geometry, 512, NULL, infoLog);
-			std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n" << infoLog << std::endl;
+		glGetShaderInfoLog(stage, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+		compiled = false;
+		/* Error locations are reported as source(line), list which file each source number is. */
+		for (unsigned int i = 0; i < files.size(); i++) {
+			std::cout << "  source " << i << ": " << files[i] << std::endl;
 		}
 	}
+	return stage;
+}
+
+unsigned int Shader::linkProgram(unsigned int vertex, unsigned int fragment, unsigned int geometry, bool& linked)
+{
+	int success;
+	char infoLog[512];
 
 	/* Create Shader program and link the required shaders */
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	if (geometryPath != nullptr) {
-		glAttachShader(ID, geometry);
-	}
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
-	// Handle linking errors 
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	unsigned int program = glCreateProgram();
+	glAttachShader(program, vertex);
+	if (geometry != 0) {
+		glAttachShader(program, geometry);
+	}
+	glAttachShader(program, fragment);
+	glLinkProgram(program);
+	// Handle linking errors
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
 	if (!success) {
-		glGetProgramInfoLog(ID, 512, NULL, infoLog);
+		glGetProgramInfoLog(program, 512, NULL, infoLog);
 		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		linked = false;
 	}
-
-	/* Delete Shaders after use */
-	glDeleteShader(vertex);
-	if (geometryPath != nullptr) {
-		glDeleteShader(geometry);
-	}
-	glDeleteShader(fragment);
+	return program;
 }
 
 void Shader::use() {
@@ -118,7 +372,19 @@ void Shader::use() {
 }
 
 void Shader::deleteProgram() {
-	glDeleteProgram(ID);
+	if (cacheKey.empty()) {
+		glDeleteProgram(ID);
+		ID = 0;
+		return;
+	}
+	auto cached = programCache.find(cacheKey);
+	if (cached == programCache.end()) {
+		return;
+	}
+	if (--cached->second.references == 0) {
+		glDeleteProgram(ID);
+		programCache.erase(cached);
+	}
 }
 
 void Shader::setBool(const std::string& name, bool value) const {
@@ -144,4 +410,4 @@ void Shader::setVecN(const std::string &name, float *value, int n) const {
 	else if (n == 4) {
 		glUniform4f(glGetUniformLocation(ID, name.c_str()), value[0], value[1], value[2], value[3]);
 	}
-}
\ No newline at end of file
+}
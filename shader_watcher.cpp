@@ -0,0 +1,192 @@
+#include "shader_watcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+/* Seconds a program's files have to stay unchanged before it is rebuilt. */
+const double ReloadDelay = 0.1;
+/* Seconds between modification time scans where inotify is not available. */
+const double ScanInterval = 0.5;
+
+static string normalizePath(const string &path)
+{
+	return std::filesystem::path(path).lexically_normal().generic_string();
+}
+
+ShaderWatcher::ShaderWatcher(const string &directory) : directory(directory)
+{
+#ifdef __linux__
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFd < 0) {
+		std::cout << "ERROR::SHADER_WATCHER::INOTIFY_INIT_FAILED" << std::endl;
+		return;
+	}
+	/* Includes usually live in subdirectories (shaders/common), so watch the whole tree. */
+	watchDirectory(directory);
+	std::error_code error;
+	for (auto it = std::filesystem::recursive_directory_iterator(directory, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+		if (error) {
+			break;
+		}
+		if (it->is_directory()) {
+			watchDirectory(it->path().generic_string());
+		}
+	}
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#endif
+}
+
+void ShaderWatcher::add(Shader &shader)
+{
+	if (std::find(shaders.begin(), shaders.end(), &shader) == shaders.end()) {
+		shaders.push_back(&shader);
+	}
+#ifndef __linux__
+	for (const string &file : shader.sourceFiles) {
+		std::error_code error;
+		fileTimes.emplace(normalizePath(file), std::filesystem::last_write_time(file, error));
+	}
+#endif
+}
+
+void ShaderWatcher::remove(Shader &shader)
+{
+	shaders.erase(std::remove(shaders.begin(), shaders.end(), &shader), shaders.end());
+	pending.erase(std::remove_if(pending.begin(), pending.end(), [&shader](const PendingReload &reload) {
+		return reload.shader == &shader;
+	}), pending.end());
+}
+
+#ifdef __linux__
+void ShaderWatcher::watchDirectory(const string &path)
+{
+	/* Editors that save through a temporary file and a rename only produce IN_MOVED_TO. */
+	int wd = inotify_add_watch(inotifyFd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+	if (wd < 0) {
+		std::cout << "ERROR::SHADER_WATCHER::WATCH_FAILED " << path << std::endl;
+		return;
+	}
+	watches[wd] = path;
+}
+
+void ShaderWatcher::readEvents(vector<string> &changed)
+{
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+		if (length <= 0) {
+			/* EAGAIN: nothing left to read this frame. */
+			return;
+		}
+		for (char *ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len) {
+			const inotify_event *event = (const inotify_event*)ptr;
+			auto watch = watches.find(event->wd);
+			if (watch == watches.end() || event->len == 0) {
+				continue;
+			}
+			string path = watch->second + "/" + event->name;
+			if (event->mask & IN_ISDIR) {
+				if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+					watchDirectory(path);
+				}
+				continue;
+			}
+			/* IN_CREATE alone is followed by IN_CLOSE_WRITE once the contents are there. */
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+				changed.push_back(normalizePath(path));
+			}
+		}
+	}
+}
+#else
+void ShaderWatcher::scanFiles(vector<string> &changed)
+{
+	for (auto &file : fileTimes) {
+		std::error_code error;
+		std::filesystem::file_time_type time = std::filesystem::last_write_time(file.first, error);
+		if (!error && time != file.second) {
+			file.second = time;
+			changed.push_back(file.first);
+		}
+	}
+}
+#endif
+
+void ShaderWatcher::fileChanged(const string &path, double time)
+{
+	for (Shader *shader : shaders) {
+		bool uses = false;
+		for (const string &file : shader->sourceFiles) {
+			if (normalizePath(file) == path) {
+				uses = true;
+				break;
+			}
+		}
+		if (!uses) {
+			continue;
+		}
+
+		/* Another write pushes the rebuild back instead of queueing a second one. */
+		auto queued = std::find_if(pending.begin(), pending.end(), [shader](const PendingReload &reload) {
+			return reload.shader == shader;
+		});
+		if (queued != pending.end()) {
+			queued->readyAt = time + ReloadDelay;
+		}
+		else {
+			pending.push_back(PendingReload{ shader, time + ReloadDelay });
+		}
+	}
+}
+
+void ShaderWatcher::update(double time)
+{
+	vector<string> changed;
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		readEvents(changed);
+	}
+#else
+	if (time >= nextScan) {
+		scanFiles(changed);
+		nextScan = time + ScanInterval;
+	}
+#endif
+	for (const string &path : changed) {
+		fileChanged(path, time);
+	}
+
+	for (auto it = pending.begin(); it != pending.end(); ++it) {
+		if (it->readyAt > time) {
+			continue;
+		}
+		Shader *shader = it->shader;
+		pending.erase(it);
+		if (shader->reload()) {
+			reloads++;
+			std::cout << "SHADER_WATCHER::RELOADED program " << shader->ID << std::endl;
+		}
+#ifndef __linux__
+		/* The rebuild may have picked up new includes. */
+		for (const string &file : shader->sourceFiles) {
+			std::error_code error;
+			fileTimes.emplace(normalizePath(file), std::filesystem::last_write_time(file, error));
+		}
+#endif
+		break;
+	}
+}
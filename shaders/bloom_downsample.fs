@@ -0,0 +1,78 @@
+#version 330 core
+// 13 tap downsample from "Next Generation Post Processing in Call of Duty: Advanced Warfare" (Jimenez 2014).
+// Every tap is a bilinear fetch between four texels, so 13 fetches cover a 6x6 texel footprint.
+// The first pass reads the HDR scene: it weights the five 2x2 boxes by 1 / (1 + luma) (Karis average) so that
+// single very bright pixels do not flicker, and keeps only what is above the bloom threshold.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform vec2 srcTexelSize;
+uniform bool firstPass;
+uniform float threshold = 1.0;
+uniform float knee = 0.5;
+
+float luma(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+vec3 karisAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    vec4 sum = vec4(0.0);
+    sum += vec4(a, 1.0) / (1.0 + luma(a));
+    sum += vec4(b, 1.0) / (1.0 + luma(b));
+    sum += vec4(c, 1.0) / (1.0 + luma(c));
+    sum += vec4(d, 1.0) / (1.0 + luma(d));
+    return sum.rgb / sum.a;
+}
+
+// soft threshold: a quadratic knee around the threshold instead of a hard cut
+vec3 prefilter(vec3 color)
+{
+    float brightness = luma(color);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 0.00001);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 0.00001);
+    return color * contribution;
+}
+
+void main()
+{
+    vec2 t = srcTexelSize;
+    vec3 a = texture(srcTexture, TexCoords + vec2(-2.0,  2.0) * t).rgb;
+    vec3 b = texture(srcTexture, TexCoords + vec2( 0.0,  2.0) * t).rgb;
+    vec3 c = texture(srcTexture, TexCoords + vec2( 2.0,  2.0) * t).rgb;
+    vec3 d = texture(srcTexture, TexCoords + vec2(-2.0,  0.0) * t).rgb;
+    vec3 e = texture(srcTexture, TexCoords).rgb;
+    vec3 f = texture(srcTexture, TexCoords + vec2( 2.0,  0.0) * t).rgb;
+    vec3 g = texture(srcTexture, TexCoords + vec2(-2.0, -2.0) * t).rgb;
+    vec3 h = texture(srcTexture, TexCoords + vec2( 0.0, -2.0) * t).rgb;
+    vec3 i = texture(srcTexture, TexCoords + vec2( 2.0, -2.0) * t).rgb;
+    vec3 j = texture(srcTexture, TexCoords + vec2(-1.0,  1.0) * t).rgb;
+    vec3 k = texture(srcTexture, TexCoords + vec2( 1.0,  1.0) * t).rgb;
+    vec3 l = texture(srcTexture, TexCoords + vec2(-1.0, -1.0) * t).rgb;
+    vec3 m = texture(srcTexture, TexCoords + vec2( 1.0, -1.0) * t).rgb;
+
+    vec3 result;
+    if (firstPass)
+    {
+        // the centre box counts for half, the four overlapping corner boxes for an eighth each
+        result = karisAverage(j, k, l, m) * 0.5;
+        result += karisAverage(a, b, d, e) * 0.125;
+        result += karisAverage(b, c, e, f) * 0.125;
+        result += karisAverage(d, e, g, h) * 0.125;
+        result += karisAverage(e, f, h, i) * 0.125;
+        result = prefilter(result);
+    }
+    else
+    {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+    // keep the chain free of negative values, R11G11B10 cannot store them anyway
+    FragColor = vec4(max(result, 0.0001), 1.0);
+}
@@ -7,6 +7,7 @@ uniform sampler2D scene;
 uniform sampler2D bloomBlur;
 uniform bool bloom;
 uniform float exposure;
+uniform float bloomStrength = 0.04;
 
 void main()
 {             
@@ -14,7 +15,7 @@ void main()
     vec3 hdrColor = texture(scene, TexCoords).rgb;      
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
     if(bloom)
-        hdrColor += bloomColor; // additive blending
+        hdrColor = mix(hdrColor, bloomColor, bloomStrength); // the mip chain holds the whole scene blurred, not just the bright parts
     // tone mapping
     vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
     // also gamma correct while we're at it       
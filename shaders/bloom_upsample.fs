@@ -0,0 +1,24 @@
+#version 330 core
+// 3x3 tent filter upsample, blended additively onto the next larger mip of the bloom chain.
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform vec2 srcTexelSize;
+uniform float filterRadius = 1.0;   // in source texels
+
+void main()
+{
+    vec2 t = srcTexelSize * filterRadius;
+    vec3 result = texture(srcTexture, TexCoords).rgb * 4.0;
+    result += (texture(srcTexture, TexCoords + vec2(-t.x, 0.0)).rgb
+             + texture(srcTexture, TexCoords + vec2( t.x, 0.0)).rgb
+             + texture(srcTexture, TexCoords + vec2(0.0, -t.y)).rgb
+             + texture(srcTexture, TexCoords + vec2(0.0,  t.y)).rgb) * 2.0;
+    result += texture(srcTexture, TexCoords + vec2(-t.x, -t.y)).rgb
+            + texture(srcTexture, TexCoords + vec2( t.x, -t.y)).rgb
+            + texture(srcTexture, TexCoords + vec2(-t.x,  t.y)).rgb
+            + texture(srcTexture, TexCoords + vec2( t.x,  t.y)).rgb;
+    FragColor = vec4(result / 16.0, 1.0);
+}
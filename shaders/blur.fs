@@ -6,27 +6,20 @@ in vec2 TexCoords;
 uniform sampler2D image;
 
 uniform bool horizontal;
-uniform float weight[5] = float[] (0.2270270270, 0.1945945946, 0.1216216216, 0.0540540541, 0.0162162162);
+// 9 tap gaussian in 5 fetches: neighbouring taps are merged into one bilinear fetch placed between them at the
+// offset that reproduces both weights, so image must use linear filtering
+uniform float offset[3] = float[] (0.0, 1.3846153846, 3.2307692308);
+uniform float weight[3] = float[] (0.2270270270, 0.3162162162, 0.0702702703);
 
 void main()
 {             
      vec2 tex_offset = 1.0 / textureSize(image, 0); // gets size of single texel
+     vec2 direction = horizontal ? vec2(tex_offset.x, 0.0) : vec2(0.0, tex_offset.y);
      vec3 result = texture(image, TexCoords).rgb * weight[0];
-     if(horizontal)
+     for(int i = 1; i < 3; ++i)
      {
-         for(int i = 1; i < 5; ++i)
-         {
-            result += texture(image, TexCoords + vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-            result += texture(image, TexCoords - vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-         }
-     }
-     else
-     {
-         for(int i = 1; i < 5; ++i)
-         {
-             result += texture(image, TexCoords + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-             result += texture(image, TexCoords - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-         }
+         result += texture(image, TexCoords + direction * offset[i]).rgb * weight[i];
+         result += texture(image, TexCoords - direction * offset[i]).rgb * weight[i];
      }
      FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
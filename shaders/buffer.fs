@@ -1,7 +1,7 @@
 #version 330 core
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec4 gAlbedoSpec;
+// position is not stored, it is rebuilt from the depth buffer (common/gbuffer.glsl)
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
 
 in vec2 TexCoords;
 in vec3 FragPos;
@@ -10,14 +10,21 @@ in vec3 Normal;
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 
+#include "common/octahedral.glsl"
+
+// see MaterialParams in material.h
+layout (std140) uniform MaterialParams
+{
+    vec4 albedo;    // rgb colour
+    vec4 surface;   // metallic, roughness, ao, shininess
+};
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    // store the per-fragment normals into the gbuffer
+    gNormal = encodeNormal(normalize(Normal));
     // and the diffuse per-fragment color
-    gAlbedoSpec.rgb = texture(texture_diffuse1, TexCoords).rgb;
+    gAlbedoSpec.rgb = texture(texture_diffuse1, TexCoords).rgb * albedo.rgb;
     // store specular intensity in gAlbedoSpec's alpha component
     gAlbedoSpec.a = texture(texture_specular1, TexCoords).r;
 }
\ No newline at end of file
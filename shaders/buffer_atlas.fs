@@ -0,0 +1,53 @@
+#version 330 core
+// position is not stored, it is rebuilt from the depth buffer (common/gbuffer.glsl)
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
+
+in vec2 TexCoords;
+in vec3 FragPos;
+in vec3 Normal;
+flat in int MaterialIndex;
+
+// must match TextureArrayAtlas
+#define MAX_MATERIAL_PAGES 4
+#define MAX_MATERIALS 256
+
+struct AtlasMaterial {
+    ivec4 diffuseSpecular;  // diffuse page, layer, specular page, layer
+    ivec4 normalHeight;     // normal page, layer, height page, layer
+};
+
+layout (std140) uniform MaterialTable
+{
+    AtlasMaterial materials[MAX_MATERIALS];
+};
+
+uniform sampler2DArray materialPages[MAX_MATERIAL_PAGES];
+
+#include "common/octahedral.glsl"
+
+// Sampler arrays can only be indexed with constants in GLSL 3.30, so the page is picked with branches.
+// Gradients are taken outside of them since the page can differ between neighbouring fragments.
+vec4 sampleLayer(ivec2 pageLayer, vec2 uv, vec2 dx, vec2 dy, vec4 missing)
+{
+    vec3 coord = vec3(uv, float(pageLayer.y));
+    if (pageLayer.x == 0) return textureGrad(materialPages[0], coord, dx, dy);
+    if (pageLayer.x == 1) return textureGrad(materialPages[1], coord, dx, dy);
+    if (pageLayer.x == 2) return textureGrad(materialPages[2], coord, dx, dy);
+    if (pageLayer.x == 3) return textureGrad(materialPages[3], coord, dx, dy);
+    return missing;
+}
+
+void main()
+{    
+    AtlasMaterial material = materials[MaterialIndex];
+    vec2 dx = dFdx(TexCoords);
+    vec2 dy = dFdy(TexCoords);
+
+    // store the per-fragment normals into the gbuffer
+    gNormal = encodeNormal(normalize(Normal));
+    // and the diffuse per-fragment color
+    gAlbedoSpec.rgb = sampleLayer(material.diffuseSpecular.xy, TexCoords, dx, dy, vec4(1.0)).rgb;
+    // store specular intensity in gAlbedoSpec's alpha component
+    gAlbedoSpec.a = sampleLayer(material.diffuseSpecular.zw, TexCoords, dx, dy, vec4(0.0)).r;
+}
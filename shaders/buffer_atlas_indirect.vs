@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// per instance data, see IndirectRenderer. aMaterial.w holds the material table index.
+layout (location = 8) in mat4 aModel;
+layout (location = 12) in vec4 aMaterial;
+
+out vec3 FragPos;
+out vec2 TexCoords;
+out vec3 Normal;
+flat out int MaterialIndex;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    vec4 worldPos = aModel * vec4(aPos, 1.0);
+    FragPos = worldPos.xyz; 
+    TexCoords = aTexCoords;
+    MaterialIndex = int(aMaterial.w);
+    
+    mat3 normalMatrix = transpose(inverse(mat3(aModel)));
+    Normal = normalMatrix * aNormal;
+
+    gl_Position = projection * view * worldPos;
+}
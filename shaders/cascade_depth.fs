@@ -0,0 +1,6 @@
+#version 330 core
+// Depth only, the cascades need nothing but the depth buffer.
+
+void main()
+{
+}
@@ -0,0 +1,61 @@
+// Cascaded shadow map of a directional light written by CascadedShadowMap (cascaded_shadows.cpp).
+// Usage:
+//     float shadow = cascadedShadow(fragPos, normal, lightDir);   // world space, 1.0 fully shadowed
+
+#define MAX_CASCADES 4
+
+layout (std140) uniform ShadowCascades
+{
+    mat4 cascadeView;                       // camera view
+    mat4 cascadeMatrices[MAX_CASCADES];     // world -> light clip space
+    vec4 cascadeSplits;                     // far view depth of every cascade
+    vec4 cascadeTexelSizes;                 // world size of one shadow texel
+    vec4 cascadeParams;                     // count, blend width, normal offset, depth bias
+};
+
+uniform sampler2DArrayShadow cascadeShadowMap;
+
+// Lit fraction in one cascade. The receiver is pushed along its normal by a number of texels, which removes acne
+// on slopes without the peter panning a large depth bias gives.
+float cascadeVisibility(int cascade, vec3 fragPos, vec3 normal, float slope)
+{
+    vec3 offsetPos = fragPos + normal * cascadeParams.z * cascadeTexelSizes[cascade] * slope;
+    vec4 lightPos = cascadeMatrices[cascade] * vec4(offsetPos, 1.0);
+    vec3 coords = lightPos.xyz * 0.5 + 0.5;
+    float reference = coords.z - cascadeParams.w;
+    // four hardware 2x2 comparisons half a texel apart, a 3x3 texel footprint with smooth weights
+    vec2 texel = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+    float lit = 0.0;
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(-0.5, -0.5) * texel, float(cascade), reference));
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2( 0.5, -0.5) * texel, float(cascade), reference));
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(-0.5,  0.5) * texel, float(cascade), reference));
+    lit += texture(cascadeShadowMap, vec4(coords.xy + vec2( 0.5,  0.5) * texel, float(cascade), reference));
+    return lit * 0.25;
+}
+
+float cascadedShadow(vec3 fragPos, vec3 normal, vec3 lightDir)
+{
+    float viewDepth = -(cascadeView * vec4(fragPos, 1.0)).z;
+    int count = int(cascadeParams.x);
+    int cascade = 0;
+    while (cascade < count && viewDepth > cascadeSplits[cascade])
+        ++cascade;
+    if (cascade == count)
+        return 0.0;
+
+    // normal offset scaled with the angle to the light, none when the light hits the surface head on
+    float cosTheta = clamp(dot(normal, -lightDir), 0.0, 1.0);
+    float slope = sqrt(1.0 - cosTheta * cosTheta);
+    float visibility = cascadeVisibility(cascade, fragPos, normal, slope);
+
+    // fade into the next cascade over the last part of this one, hides the change in resolution
+    float cascadeStart = cascade == 0 ? 0.0 : cascadeSplits[cascade - 1];
+    float blendStart = cascadeSplits[cascade] - cascadeParams.y * (cascadeSplits[cascade] - cascadeStart);
+    if (viewDepth > blendStart)
+    {
+        float t = (viewDepth - blendStart) / (cascadeSplits[cascade] - blendStart);
+        float next = cascade + 1 < count ? cascadeVisibility(cascade + 1, fragPos, normal, slope) : 1.0;
+        visibility = mix(visibility, next, t);
+    }
+    return 1.0 - visibility;
+}
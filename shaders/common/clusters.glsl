@@ -0,0 +1,64 @@
+// Clustered light lists written by LightClusters (light_clusters.cpp).
+// Usage:
+//     int first, count;
+//     clusterLightRange(clusterIndex(gl_FragCoord.xy, viewDepth), first, count);
+//     for (int i = first; i < first + count; ++i) { ClusterLight light = clusterLight(i); ... }
+
+uniform samplerBuffer clusterLights;    // 3 texels per light: position + radius, color, attenuation
+uniform usamplerBuffer clusterGrid;     // per cluster: offset into clusterIndices << 8 | light count
+uniform usamplerBuffer clusterIndices;  // light indices, grouped per cluster
+uniform ivec3 clusterCount;
+uniform vec4 clusterDepth;              // near, far, slice scale, slice bias
+uniform vec2 clusterTileSize;           // pixels
+
+struct ClusterLight {
+    vec3 Position;
+    float Radius;
+    vec3 Color;
+    vec3 Attenuation;                   // constant, linear, quadratic
+};
+
+// ----------------------------------------------------------------------------
+// View space distance along -z of a fragment from its window depth, for a standard perspective projection.
+float clusterViewDepth(float fragDepth)
+{
+    float ndc = fragDepth * 2.0 - 1.0;
+    float n = clusterDepth.x;
+    float f = clusterDepth.y;
+    return 2.0 * n * f / (f + n - ndc * (f - n));
+}
+// ----------------------------------------------------------------------------
+int clusterIndex(vec2 fragCoord, float viewDepth)
+{
+    ivec2 tile = min(ivec2(fragCoord / clusterTileSize), clusterCount.xy - 1);
+    int slice = clamp(int(log(viewDepth) * clusterDepth.z - clusterDepth.w), 0, clusterCount.z - 1);
+    return tile.x + clusterCount.x * (tile.y + clusterCount.y * slice);
+}
+// ----------------------------------------------------------------------------
+void clusterLightRange(int cluster, out int first, out int count)
+{
+    uint cell = texelFetch(clusterGrid, cluster).r;
+    first = int(cell >> 8);
+    count = int(cell & 255u);
+}
+// ----------------------------------------------------------------------------
+ClusterLight clusterLight(int listIndex)
+{
+    int light = int(texelFetch(clusterIndices, listIndex).r) * 3;
+    vec4 positionRadius = texelFetch(clusterLights, light);
+    ClusterLight result;
+    result.Position = positionRadius.xyz;
+    result.Radius = positionRadius.w;
+    result.Color = texelFetch(clusterLights, light + 1).rgb;
+    result.Attenuation = texelFetch(clusterLights, light + 2).xyz;
+    return result;
+}
+// ----------------------------------------------------------------------------
+// Attenuation faded to zero at the light's radius, so lights cut off where the binning stops including them.
+float clusterAttenuation(ClusterLight light, float distance)
+{
+    float falloff = 1.0 / (light.Attenuation.x + light.Attenuation.y * distance + light.Attenuation.z * distance * distance);
+    float ratio = distance / light.Radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return falloff * window * window;
+}
@@ -0,0 +1,3 @@
+// Shared constants. Included once per stage by the shader loader.
+const float PI = 3.14159265359;
+const float HALF_PI = 1.57079632679;
@@ -0,0 +1,29 @@
+// Reads the compact G-buffer set up by GBuffer (gbuffer.cpp):
+//   gDepth       hardware depth, positions are rebuilt from it with inverseProjection
+//   gNormal      RG16_SNORM octahedral normal, in whatever space the geometry pass wrote it
+//   gAlbedoSpec  RGBA8 albedo and specular intensity
+#include "octahedral.glsl"
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseProjection;
+uniform mat4 inverseView;
+
+// ----------------------------------------------------------------------------
+vec3 gbufferViewPosition(vec2 uv)
+{
+    float depth = texture(gDepth, uv).r;
+    vec4 position = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return position.xyz / position.w;
+}
+// ----------------------------------------------------------------------------
+vec3 gbufferWorldPosition(vec2 uv)
+{
+    return (inverseView * vec4(gbufferViewPosition(uv), 1.0)).xyz;
+}
+// ----------------------------------------------------------------------------
+vec3 gbufferNormal(vec2 uv)
+{
+    return decodeNormal(texture(gNormal, uv).rg);
+}
@@ -0,0 +1,58 @@
+// Filtered lookups into an omnidirectional shadow cubemap holding light distance / far_plane (simpleDepth.fs).
+// The cubemap must be a depth texture with GL_TEXTURE_COMPARE_MODE = GL_COMPARE_REF_TO_TEXTURE,
+// GL_TEXTURE_COMPARE_FUNC = GL_LEQUAL and linear filtering: every tap is then a hardware 2x2 PCF that returns the
+// lit fraction, so few taps give the same softness as a large grid of plain fetches.
+// Defines:
+//   SHADOW_SAMPLES   taps per fragment, 8, 16 or 20 (default 16)
+#include "constants.glsl"
+
+#ifndef SHADOW_SAMPLES
+#define SHADOW_SAMPLES 16
+#endif
+
+uniform samplerCubeShadow depthMap;
+uniform float far_plane;
+uniform float shadowBias = 0.05;
+uniform float shadowFilterRadius = 0.04;    // world units at the light, grows with the view distance
+
+const float GOLDEN_ANGLE = 2.39996322973;
+
+float shadowNoise(vec2 position)
+{
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+// Vogel (sunflower) disk: evenly spread for any tap count, so 8, 16 and 20 all cover the disk without clumping.
+vec2 shadowDiskOffset(int i, float rotation)
+{
+    float r = sqrt((float(i) + 0.5) / float(SHADOW_SAMPLES));
+    float theta = float(i) * GOLDEN_ANGLE + rotation;
+    return r * vec2(cos(theta), sin(theta));
+}
+
+// Returns 1.0 for fully shadowed, 0.0 for fully lit.
+float pointShadow(vec3 fragPos, vec3 lightPos, vec3 viewPos)
+{
+    vec3 fragToLight = fragPos - lightPos;
+    float currentDepth = length(fragToLight);
+    float reference = (currentDepth - shadowBias) / far_plane;
+
+    // the disk lies across the lookup direction, offsets along it would only move the fetch within the same texel
+    vec3 direction = fragToLight / currentDepth;
+    vec3 up = abs(direction.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, direction));
+    vec3 bitangent = cross(direction, tangent);
+
+    // wider penumbra further from the camera, where the texels are small on screen anyway
+    float diskRadius = shadowFilterRadius * (1.0 + length(viewPos - fragPos) / far_plane);
+    // rotate the disk per pixel, turning banding into noise
+    float rotation = 2.0 * PI * shadowNoise(gl_FragCoord.xy);
+
+    float lit = 0.0;
+    for (int i = 0; i < SHADOW_SAMPLES; ++i)
+    {
+        vec2 offset = shadowDiskOffset(i, rotation) * diskRadius;
+        lit += texture(depthMap, vec4(fragToLight + tangent * offset.x + bitangent * offset.y, reference));
+    }
+    return 1.0 - lit / float(SHADOW_SAMPLES);
+}
@@ -1,12 +1,21 @@
 #version 330 core
+// Defines:
+//   NR_LIGHTS  number of entries in lights[] (default 32)
+//   SSAO       G-buffer normals are in view space and there is no specular channel, ambient is scaled by the ssao texture
+//   CLUSTERED  read the lights of the pixel's cluster from the LightClusters buffers instead of lights[]
+//              (with SSAO the lights are uploaded in view space and binned with an identity view matrix)
 out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
-uniform sampler2D gAlbedoSpec;
+#include "common/gbuffer.glsl"
+#ifdef SSAO
+uniform sampler2D ssao;
+#endif
 
+#ifdef CLUSTERED
+#include "common/clusters.glsl"
+#else
 struct Light {
     vec3 Position;
     vec3 Color;
@@ -14,36 +23,73 @@ struct Light {
     float Linear;
     float Quadratic;
 };
-const int NR_LIGHTS = 32;
+#ifndef NR_LIGHTS
+#define NR_LIGHTS 32
+#endif
 uniform Light lights[NR_LIGHTS];
+#endif
 uniform vec3 viewPos;
 
+#ifdef SSAO
+const float AMBIENT = 0.3;
+const float SHININESS = 8.0;
+#else
+const float AMBIENT = 0.1;
+const float SHININESS = 16.0;
+#endif
+
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 ViewSpacePos = gbufferViewPosition(TexCoords);
+#ifdef SSAO
+    vec3 FragPos = ViewSpacePos;
+#else
+    vec3 FragPos = (inverseView * vec4(ViewSpacePos, 1.0)).xyz;
+#endif
+    vec3 Normal = gbufferNormal(TexCoords);
     vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
+#ifdef SSAO
+    float Specular = 1.0;
+    float AmbientOcclusion = texture(ssao, TexCoords).r;
+    vec3 lighting  = AMBIENT * Diffuse * AmbientOcclusion;
+    vec3 viewDir  = normalize(-FragPos); // viewpos is (0.0.0)
+#else
     float Specular = texture(gAlbedoSpec, TexCoords).a;
+    vec3 lighting  = AMBIENT * Diffuse; // hard-coded ambient component
+    vec3 viewDir  = normalize(viewPos - FragPos);
+#endif
     
     // then calculate lighting as usual
-    vec3 lighting  = Diffuse * 0.1; // hard-coded ambient component
-    vec3 viewDir  = normalize(viewPos - FragPos);
+#ifdef CLUSTERED
+    int first, count;
+    clusterLightRange(clusterIndex(gl_FragCoord.xy, -ViewSpacePos.z), first, count);
+    for(int i = first; i < first + count; ++i)
+    {
+        ClusterLight light = clusterLight(i);
+        vec3 lightPosition = light.Position;
+        vec3 lightColor = light.Color;
+        float distance = length(lightPosition - FragPos);
+        float attenuation = clusterAttenuation(light, distance);
+#else
     for(int i = 0; i < NR_LIGHTS; ++i)
     {
+        vec3 lightPosition = lights[i].Position;
+        vec3 lightColor = lights[i].Color;
+        float distance = length(lightPosition - FragPos);
+        float attenuation = 1.0 / (1.0 + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
+#endif
         // diffuse
-        vec3 lightDir = normalize(lights[i].Position - FragPos);
-        vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lights[i].Color;
+        vec3 lightDir = normalize(lightPosition - FragPos);
+        vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lightColor;
         // specular
         vec3 halfwayDir = normalize(lightDir + viewDir);  
-        float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-        vec3 specular = lights[i].Color * spec * Specular;
+        float spec = pow(max(dot(Normal, halfwayDir), 0.0), SHININESS);
+        vec3 specular = lightColor * spec * Specular;
         // attenuation
-        float distance = length(lights[i].Position - FragPos);
-        float attenuation = 1.0 / (1.0 + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
         diffuse *= attenuation;
         specular *= attenuation;
         lighting += diffuse + specular;        
     }
     FragColor = vec4(lighting, 1.0);
-}
\ No newline at end of file
+}
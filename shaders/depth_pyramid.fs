@@ -0,0 +1,26 @@
+#version 330 core
+// Linear depth pyramid for gtao.fs. The first level converts the G-buffer depth to positive view distance, every
+// further level keeps the closest of the 2x2 texels of the level above, which SSAORenderer exposes as level 0.
+out float FragColor;
+
+in vec2 TexCoords;
+
+#include "common/gbuffer.glsl"
+uniform sampler2D depthPyramid;
+uniform bool firstLevel;
+
+void main()
+{
+    if (firstLevel)
+    {
+        FragColor = -gbufferViewPosition(TexCoords).z;
+        return;
+    }
+    ivec2 last = textureSize(depthPyramid, 0) - 1;
+    ivec2 coord = ivec2(gl_FragCoord.xy) * 2;
+    float d0 = texelFetch(depthPyramid, min(coord, last), 0).r;
+    float d1 = texelFetch(depthPyramid, min(coord + ivec2(1, 0), last), 0).r;
+    float d2 = texelFetch(depthPyramid, min(coord + ivec2(0, 1), last), 0).r;
+    float d3 = texelFetch(depthPyramid, min(coord + ivec2(1, 1), last), 0).r;
+    FragColor = min(min(d0, d1), min(d2, d3));
+}
@@ -0,0 +1,97 @@
+#version 330 core
+// Ground truth ambient occlusion (Jimenez et al. 2016). For each of a few screen space directions the horizon is
+// searched on both sides of the pixel by marching the linear depth pyramid, and the cosine weighted visibility
+// between the two horizons is integrated analytically. Directions and step offsets change every frame,
+// gtao_temporal.fs accumulates the results.
+out float FragColor;
+
+in vec2 TexCoords;
+
+#include "common/constants.glsl"
+#include "common/octahedral.glsl"
+
+uniform sampler2D depthPyramid;     // positive view distance
+uniform sampler2D gNormal;          // view space, octahedral
+uniform vec2 viewScale;             // 1 / projection[0][0], 1 / projection[1][1]
+uniform float projectionScale;      // target pixels covered by one unit at distance one
+uniform int directionCount = 2;
+uniform int stepCount = 4;
+uniform float radius = 0.5;
+uniform int maxLevel;
+uniform float temporalRotation;
+uniform float temporalOffset;
+
+vec3 viewPosition(vec2 uv, float lod)
+{
+    float depth = textureLod(depthPyramid, uv, lod).r;
+    return vec3((uv * 2.0 - 1.0) * viewScale * depth, -depth);
+}
+
+float interleavedGradientNoise(vec2 position)
+{
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+void main()
+{
+    vec3 P = viewPosition(TexCoords, 0.0);
+    vec3 N = decodeNormal(texture(gNormal, TexCoords).rg);
+    vec3 V = normalize(-P);
+    vec2 texelSize = 1.0 / vec2(textureSize(depthPyramid, 0));
+
+    // radius projected to the screen; nothing to search if it is below a pixel
+    float screenRadius = radius * projectionScale / -P.z;
+    if (screenRadius < 1.0)
+    {
+        FragColor = 1.0;
+        return;
+    }
+    float stepPixels = screenRadius / float(stepCount);
+    float noise = interleavedGradientNoise(gl_FragCoord.xy);
+    float falloffScale = 1.0 / (radius * radius);
+
+    float visibility = 0.0;
+    for (int d = 0; d < directionCount; ++d)
+    {
+        float angle = (float(d) + noise) / float(directionCount) * PI + temporalRotation;
+        vec2 omega = vec2(cos(angle), sin(angle));
+
+        // slice plane through the view vector, and the normal projected into it
+        vec3 direction = vec3(omega, 0.0);
+        vec3 orthoDirection = direction - dot(direction, V) * V;
+        vec3 axis = normalize(cross(orthoDirection, V));
+        vec3 projectedNormal = N - axis * dot(N, axis);
+        float projectedLength = length(projectedNormal);
+        float cosN = clamp(dot(projectedNormal, V) / projectedLength, 0.0, 1.0);
+        float n = sign(dot(orthoDirection, projectedNormal)) * acos(cosN);
+
+        // highest horizon on either side, as the cosine to the view vector
+        vec2 horizonCos = vec2(-1.0);
+        for (int s = 0; s < stepCount; ++s)
+        {
+            float distancePixels = (float(s) + fract(noise + temporalOffset)) * stepPixels + 1.0;
+            float lod = clamp(floor(log2(distancePixels)) - 1.0, 0.0, float(maxLevel));
+            vec2 offset = omega * distancePixels * texelSize;
+
+            vec3 delta0 = viewPosition(TexCoords + offset, lod) - P;
+            vec3 delta1 = viewPosition(TexCoords - offset, lod) - P;
+            float length0 = dot(delta0, delta0);
+            float length1 = dot(delta1, delta1);
+            float cos0 = dot(delta0, V) * inversesqrt(length0);
+            float cos1 = dot(delta1, V) * inversesqrt(length1);
+            // fade occluders out towards the radius
+            cos0 = mix(-1.0, cos0, clamp(1.0 - length0 * falloffScale, 0.0, 1.0));
+            cos1 = mix(-1.0, cos1, clamp(1.0 - length1 * falloffScale, 0.0, 1.0));
+            horizonCos = max(horizonCos, vec2(cos0, cos1));
+        }
+
+        float h0 = -acos(horizonCos.y);
+        float h1 = acos(horizonCos.x);
+        h0 = n + clamp(h0 - n, -HALF_PI, HALF_PI);
+        h1 = n + clamp(h1 - n, -HALF_PI, HALF_PI);
+        float arc0 = (cosN + 2.0 * h0 * sin(n) - cos(2.0 * h0 - n)) * 0.25;
+        float arc1 = (cosN + 2.0 * h1 * sin(n) - cos(2.0 * h1 - n)) * 0.25;
+        visibility += projectedLength * (arc0 + arc1);
+    }
+    FragColor = visibility / float(directionCount);
+}
@@ -0,0 +1,33 @@
+#version 330 core
+// Blends this frame's GTAO into the reprojected history. History is dropped where the depth it was computed for
+// does not match the reprojected surface, so disocclusions start over instead of ghosting.
+out vec2 FragColor;     // occlusion, view distance
+
+in vec2 TexCoords;
+
+uniform sampler2D depthPyramid;
+uniform sampler2D currentAO;
+uniform sampler2D history;
+uniform vec2 viewScale;
+uniform mat4 reprojection;      // previous projection * previous view * inverse current view
+uniform float blendFactor = 0.1;
+
+const float DEPTH_TOLERANCE = 0.05;
+
+void main()
+{
+    float depth = textureLod(depthPyramid, TexCoords, 0.0).r;
+    vec3 P = vec3((TexCoords * 2.0 - 1.0) * viewScale * depth, -depth);
+    float occlusion = texture(currentAO, TexCoords).r;
+
+    vec4 previous = reprojection * vec4(P, 1.0);
+    vec2 previousUV = previous.xy / previous.w * 0.5 + 0.5;
+    if (previous.w > 0.0 && all(greaterThanEqual(previousUV, vec2(0.0))) && all(lessThanEqual(previousUV, vec2(1.0))))
+    {
+        vec2 past = texture(history, previousUV).rg;
+        // w of a perspective projection is the view distance the history should have stored
+        if (abs(past.y - previous.w) < DEPTH_TOLERANCE * previous.w)
+            occlusion = mix(past.x, occlusion, blendFactor);
+    }
+    FragColor = vec2(occlusion, depth);
+}
@@ -0,0 +1,56 @@
+#version 330 core
+// Deferred lighting from light volumes (LightVolumeRenderer), same G-buffer and shading as deferred_shading.fs.
+// Defines:
+//   STENCIL_PASS  no output, only used to mark the pixels inside a volume in the stencil buffer
+//   AMBIENT_PASS  full screen ambient term, drawn once before the volumes
+out vec4 FragColor;
+
+#ifndef STENCIL_PASS
+#include "common/gbuffer.glsl"
+uniform vec2 screenSize;
+
+struct Light {
+    vec3 Position;
+    vec3 Color;
+    vec3 Attenuation;   // constant, linear, quadratic
+    float Radius;
+};
+uniform Light light;
+uniform vec3 viewPos;
+
+const float AMBIENT = 0.1;
+const float SHININESS = 16.0;
+#endif
+
+void main()
+{
+#ifndef STENCIL_PASS
+    // the volume covers arbitrary pixels, so the G-buffer is addressed by screen position
+    vec2 TexCoords = gl_FragCoord.xy / screenSize;
+    vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
+#ifdef AMBIENT_PASS
+    FragColor = vec4(AMBIENT * Diffuse, 1.0);
+#else
+    vec3 FragPos = gbufferWorldPosition(TexCoords);
+    vec3 Normal = gbufferNormal(TexCoords);
+    float Specular = texture(gAlbedoSpec, TexCoords).a;
+    vec3 viewDir  = normalize(viewPos - FragPos);
+
+    float distance = length(light.Position - FragPos);
+    if (distance > light.Radius)
+        discard;
+    // diffuse
+    vec3 lightDir = normalize(light.Position - FragPos);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * light.Color;
+    // specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), SHININESS);
+    vec3 specular = light.Color * spec * Specular;
+    // attenuation, faded to zero at the radius so the edge of the volume does not show
+    float ratio = distance / light.Radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float attenuation = window * window / (light.Attenuation.x + light.Attenuation.y * distance + light.Attenuation.z * distance * distance);
+    FragColor = vec4((diffuse + specular) * attenuation, 1.0);
+#endif
+#endif
+}
@@ -1,5 +1,9 @@
 #version 330 core
-out vec4 FragColor;
+// Defines:
+//   NR_LIGHTS      number of entries in lights[] (default 16)
+//   CLUSTERED      read the lights of the fragment's cluster from the LightClusters buffers instead of lights[]
+// bright parts for bloom are extracted by the first bloom downsample (bloom_downsample.fs), not here
+layout (location = 0) out vec4 FragColor;
 
 in VS_OUT {
     vec3 FragPos;
@@ -7,12 +11,20 @@ in VS_OUT {
     vec2 TexCoords;
 } fs_in;
 
+#ifdef CLUSTERED
+#include "common/clusters.glsl"
+#else
 struct Light {
     vec3 Position;
     vec3 Color;
 };
 
-uniform Light lights[16];
+#ifndef NR_LIGHTS
+#define NR_LIGHTS 16
+#endif
+
+uniform Light lights[NR_LIGHTS];
+#endif
 uniform sampler2D diffuseTexture;
 uniform vec3 viewPos;
 
@@ -24,7 +36,23 @@ void main()
     vec3 ambient = 0.0 * color;
     // lighting
     vec3 lighting = vec3(0.0);
-    for(int i = 0; i < 16; i++)
+#ifdef CLUSTERED
+    int first, count;
+    clusterLightRange(clusterIndex(gl_FragCoord.xy, clusterViewDepth(gl_FragCoord.z)), first, count);
+    for(int i = first; i < first + count; i++)
+    {
+        ClusterLight light = clusterLight(i);
+        // diffuse
+        vec3 lightDir = normalize(light.Position - fs_in.FragPos);
+        float diff = max(dot(lightDir, normal), 0.0);
+        vec3 result = light.Color * diff * color;
+        // attenuation, the lights are uploaded with quadratic falloff
+        float distance = length(fs_in.FragPos - light.Position);
+        result *= clusterAttenuation(light, distance);
+        lighting += result;
+    }
+#else
+    for(int i = 0; i < NR_LIGHTS; i++)
     {
         // diffuse
         vec3 lightDir = normalize(lights[i].Position - fs_in.FragPos);
@@ -37,5 +65,7 @@ void main()
         lighting += result;
                 
     }
-    FragColor = vec4(ambient + lighting, 1.0);
-}
\ No newline at end of file
+#endif
+    vec3 result = ambient + lighting;
+    FragColor = vec4(result, 1.0);
+}
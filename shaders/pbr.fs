@@ -1,75 +1,52 @@
 #version 330 core
+// Defines:
+//   NR_LIGHTS  number of entries in lightPositions[]/lightColors[] (default 4)
+//   CLUSTERED  read the lights of the fragment's cluster from the LightClusters buffers instead
+//   SSAO       ambient is also scaled by the ssao texture, a screen sized SSAORenderer result
 out vec4 FragColor;
 in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
+// metallic, roughness, ao
+flat in vec3 Material;
 
 // material parameters
 uniform vec3 albedo;
-uniform float metallic;
-uniform float roughness;
-uniform float ao;
 
 // IBL
 uniform samplerCube irradianceMap;
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
+#ifdef SSAO
+uniform sampler2D ssao;
+#endif
+
 // lights
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+#ifdef CLUSTERED
+#include "common/clusters.glsl"
+#else
+#ifndef NR_LIGHTS
+#define NR_LIGHTS 4
+#endif
+uniform vec3 lightPositions[NR_LIGHTS];
+uniform vec3 lightColors[NR_LIGHTS];
+#endif
 
 uniform vec3 camPos;
 
-const float PI = 3.14159265359;
-// ----------------------------------------------------------------------------
-float DistributionGGX(vec3 N, vec3 H, float roughness)
-{
-    float a = roughness*roughness;
-    float a2 = a*a;
-    float NdotH = max(dot(N, H), 0.0);
-    float NdotH2 = NdotH*NdotH;
-
-    float nom   = a2;
-    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
-    denom = PI * denom * denom;
-
-    return nom / denom;
-}
-// ----------------------------------------------------------------------------
-float GeometrySchlickGGX(float NdotV, float roughness)
-{
-    float r = (roughness + 1.0);
-    float k = (r*r) / 8.0;
-
-    float nom   = NdotV;
-    float denom = NdotV * (1.0 - k) + k;
-
-    return nom / denom;
-}
-// ----------------------------------------------------------------------------
-float GeometrySmith(vec3 N, vec3 V, vec3 L, float roughness)
-{
-    float NdotV = max(dot(N, V), 0.0);
-    float NdotL = max(dot(N, L), 0.0);
-    float ggx2 = GeometrySchlickGGX(NdotV, roughness);
-    float ggx1 = GeometrySchlickGGX(NdotL, roughness);
+#include "common/brdf.glsl"
 
-    return ggx1 * ggx2;
-}
-// ----------------------------------------------------------------------------
-vec3 fresnelSchlick(float cosTheta, vec3 F0)
-{
-    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}
-// ----------------------------------------------------------------------------
-vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
-{
-    return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
-}   
 // ----------------------------------------------------------------------------
 void main()
 {		
+    float metallic = Material.x;
+    float roughness = Material.y;
+    float ao = Material.z;
+#ifdef SSAO
+    ao *= texelFetch(ssao, ivec2(gl_FragCoord.xy), 0).r;
+#endif
+
     vec3 N = Normal;
     vec3 V = normalize(camPos - WorldPos);
     vec3 R = reflect(-V, N); 
@@ -81,14 +58,27 @@ void main()
 
     // reflectance equation
     vec3 Lo = vec3(0.0);
-    for(int i = 0; i < 4; ++i) 
+#ifdef CLUSTERED
+    int first, count;
+    clusterLightRange(clusterIndex(gl_FragCoord.xy, clusterViewDepth(gl_FragCoord.z)), first, count);
+    for(int i = first; i < first + count; ++i)
     {
         // calculate per-light radiance
-        vec3 L = normalize(lightPositions[i] - WorldPos);
-        vec3 H = normalize(V + L);
-        float distance = length(lightPositions[i] - WorldPos);
+        ClusterLight light = clusterLight(i);
+        vec3 lightPosition = light.Position;
+        float distance = length(lightPosition - WorldPos);
+        vec3 radiance = light.Color * clusterAttenuation(light, distance);
+#else
+    for(int i = 0; i < NR_LIGHTS; ++i) 
+    {
+        // calculate per-light radiance
+        vec3 lightPosition = lightPositions[i];
+        float distance = length(lightPosition - WorldPos);
         float attenuation = 1.0 / (distance * distance);
         vec3 radiance = lightColors[i] * attenuation;
+#endif
+        vec3 L = normalize(lightPosition - WorldPos);
+        vec3 H = normalize(V + L);
 
         // Cook-Torrance BRDF
         float NDF = DistributionGGX(N, H, roughness);   
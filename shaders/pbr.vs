@@ -6,16 +6,22 @@ layout (location = 2) in vec2 aTexCoords;
 out vec2 TexCoords;
 out vec3 WorldPos;
 out vec3 Normal;
+flat out vec3 Material;
 
 uniform mat4 projection;
 uniform mat4 view;
 uniform mat4 model;
 
+uniform float metallic;
+uniform float roughness;
+uniform float ao;
+
 void main()
 {
     TexCoords = aTexCoords;
     WorldPos = vec3(model * vec4(aPos, 1.0));
     Normal = mat3(model) * aNormal;   
+    Material = vec3(metallic, roughness, ao);
 
     gl_Position =  projection * view * vec4(WorldPos, 1.0);
 }
\ No newline at end of file
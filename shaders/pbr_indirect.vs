@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+// per instance data, see IndirectRenderer
+layout (location = 8) in mat4 aModel;
+layout (location = 12) in vec4 aMaterial;
+
+out vec2 TexCoords;
+out vec3 WorldPos;
+out vec3 Normal;
+flat out vec3 Material;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    WorldPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = mat3(aModel) * aNormal;   
+    Material = aMaterial.xyz;
+
+    gl_Position =  projection * view * vec4(WorldPos, 1.0);
+}
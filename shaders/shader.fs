@@ -1,4 +1,6 @@
 #version 330 core
+// Defines:
+//   CASCADED_SHADOWS   shadow the directional light with the CascadedShadowMap cascades
 struct Material {
 	sampler2D diffuse;
 	sampler2D specular;
@@ -54,6 +56,10 @@ uniform SpotLight spotLight;
 
 out vec4 FragColor;
 
+#ifdef CASCADED_SHADOWS
+#include "common/cascades.glsl"
+#endif
+
 vec3 CalcDirLight(DirLight light, vec3 NORMAL, vec3 viewDir) 
 {
 	vec3 lightDir = normalize(-light.direction);
@@ -70,6 +76,12 @@ vec3 CalcDirLight(DirLight light, vec3 NORMAL, vec3 viewDir)
 	vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, texCoords));
 	vec3 specular = light.specular * spec * vec3(texture(material.specular, texCoords));
 
+#ifdef CASCADED_SHADOWS
+	float shadow = cascadedShadow(fragPos, NORMAL, normalize(light.direction));
+	diffuse *= 1.0 - shadow;
+	specular *= 1.0 - shadow;
+#endif
+
 	return (ambient + diffuse + specular);
 }
 
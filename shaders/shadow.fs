@@ -1,4 +1,6 @@
 #version 330 core
+// Defines:
+//   SHADOW_SAMPLES   taps of the shadow filter, 8, 16 or 20 (default 16, see common/point_shadow.glsl)
 out vec4 FragColor;
 
 in VS_OUT {
@@ -8,52 +10,13 @@ in VS_OUT {
 } fs_in;
 
 uniform sampler2D diffuseTexture;
-uniform samplerCube depthMap;
 
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
-uniform float far_plane;
 uniform bool shadows;
 
-float ShadowCalculation(vec3 fragPos)
-{
-    /* Get vector between fragment position and light position */
-    vec3 fragToLight = fragPos - lightPos;
-    /* Sample closest depth from the depth map */
-    float closestDepth = texture(depthMap, fragToLight).r;
-    /* Convert from [0,1] range to original depth value */
-    closestDepth *= far_plane;
-    /* Get current linear depth as the length between the fragment and light position */
-    float currentDepth = length(fragToLight);
-    /* Debugging test for shadows */
-    //float bias = 0.05;
-
-    float shadow  = 0.0;
-    float bias    = 0.05; 
-    float samples = 4.0;
-    float offset  = 0.1;
-    for(float x = -offset; x < offset; x += offset / (samples * 0.5))
-    {
-        for(float y = -offset; y < offset; y += offset / (samples * 0.5))
-        {
-            for(float z = -offset; z < offset; z += offset / (samples * 0.5))
-            {
-                float closestDepth = texture(depthMap, fragToLight + vec3(x, y, z)).r; 
-                closestDepth *= far_plane;
-                if(currentDepth - bias > closestDepth)
-                    shadow += 1.0;
-            }
-        }
-    }
-    shadow /= (samples * samples * samples);
-
-    //float shadow = currentDepth -  bias > closestDepth ? 1.0 : 0.0;        
-    // display closestDepth as debug (to visualize depth cubemap)
-    // FragColor = vec4(vec3(closestDepth / far_plane), 1.0);
-        
-    return shadow;
-}
+#include "common/point_shadow.glsl"
 
 void main()
 {           
@@ -74,7 +37,7 @@ void main()
     spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;    
     /* Calculate shadow */
-    float shadow = shadows ? ShadowCalculation(fs_in.FragPos) : 0.0; 
+    float shadow = shadows ? pointShadow(fs_in.FragPos, lightPos, viewPos) : 0.0; 
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
     
     FragColor = vec4(lighting, 1.0);
@@ -1,9 +1,30 @@
 #version 330 core
+// Point shadow depth pass (PointShadowRenderer), every draw covers only the cube faces its geometry is visible from.
+// Defines:
+//   VERTEX_LAYER_ARB   draw all faces of a mesh in one instanced call, routed with gl_Layer (GL_ARB_shader_viewport_layer_array)
+//   VERTEX_LAYER_AMD   the same through GL_AMD_vertex_shader_layer
+// Without either, each face is attached and drawn on its own and gl_InstanceID is always 0.
+#if defined(VERTEX_LAYER_ARB)
+#extension GL_ARB_shader_viewport_layer_array : require
+#define VERTEX_LAYER
+#elif defined(VERTEX_LAYER_AMD)
+#extension GL_AMD_vertex_shader_layer : require
+#define VERTEX_LAYER
+#endif
 layout (location = 0) in vec3 aPos;
 
 uniform mat4 model;
+uniform mat4 shadowMatrices[6];
+uniform int faceOrder;      // cube faces of this draw, 3 bits each, instance i draws face (faceOrder >> 3i) & 7
+
+out vec4 FragPos;
 
 void main()
 {
-    gl_Position = model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    int face = (faceOrder >> (3 * gl_InstanceID)) & 7;
+    FragPos = model * vec4(aPos, 1.0);
+    gl_Position = shadowMatrices[face] * FragPos;
+#ifdef VERTEX_LAYER
+    gl_Layer = face;
+#endif
+}
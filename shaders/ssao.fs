@@ -3,27 +3,28 @@ out float FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
+#include "common/gbuffer.glsl"
 uniform sampler2D texNoise;
 
-uniform vec3 samples[64];
+// must match SSAO_MAX_KERNEL_SIZE in ssao_renderer.h
+#define MAX_KERNEL_SIZE 64
+uniform vec3 samples[MAX_KERNEL_SIZE];
 
-// parameters (you'd probably want to use them as uniforms to more easily tweak the effect)
-int kernelSize = 64;
-float radius = 0.5;
-float bias = 0.025;
+// parameters, set by SSAORenderer
+uniform int kernelSize = 64;
+uniform float radius = 0.5;
+uniform float bias = 0.025;
 
-// tile noise texture over screen based on screen dimensions divided by noise size
-const vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0); 
+// tile noise texture over the target: its size in pixels divided by the noise size
+uniform vec2 noiseScale;
 
 uniform mat4 projection;
 
 void main()
 {
     // get input for SSAO algorithm
-    vec3 fragPos = texture(gPosition, TexCoords).xyz;
-    vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
+    vec3 fragPos = gbufferViewPosition(TexCoords);
+    vec3 normal = gbufferNormal(TexCoords);
     vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
     // create TBN change-of-basis matrix: from tangent-space to view-space
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -44,13 +45,13 @@ void main()
         offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
         
         // get sample depth
-        float sampleDepth = texture(gPosition, offset.xy).z; // get depth value of kernel sample
+        float sampleDepth = gbufferViewPosition(offset.xy).z; // get depth value of kernel sample
         
         // range check & accumulate
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
         occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;           
     }
-    occlusion = 1.0 - (occlusion / kernelSize);
+    occlusion = 1.0 - (occlusion / float(kernelSize));
     
     FragColor = occlusion;
 }
\ No newline at end of file
@@ -1,21 +1,39 @@
 #version 330 core
+// Separable blur of the occlusion that stops at depth and normal edges, run once per direction.
 out float FragColor;
 
 in vec2 TexCoords;
 
 uniform sampler2D ssaoInput;
+uniform vec2 direction;     // (1, 0) or (0, 1)
+
+#include "common/gbuffer.glsl"
+
+const int BLUR_RADIUS = 4;
+// how fast the weight drops with relative depth difference and with normal deviation
+const float DEPTH_SHARPNESS = 32.0;
+const float NORMAL_SHARPNESS = 8.0;
 
 void main() 
 {
-    vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
+    vec2 texelStep = direction / vec2(textureSize(ssaoInput, 0));
+    float centerDepth = gbufferViewPosition(TexCoords).z;
+    vec3 centerNormal = gbufferNormal(TexCoords);
+
     float result = 0.0;
-    for (int x = -2; x < 2; ++x) 
+    float totalWeight = 0.0;
+    for (int i = -BLUR_RADIUS; i <= BLUR_RADIUS; ++i) 
     {
-        for (int y = -2; y < 2; ++y) 
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, TexCoords + offset).r;
-        }
+        vec2 uv = TexCoords + texelStep * float(i);
+        float depth = gbufferViewPosition(uv).z;
+        vec3 normal = gbufferNormal(uv);
+        // gaussian with sigma = BLUR_RADIUS / 2
+        float weight = exp(-2.0 * float(i * i) / float(BLUR_RADIUS * BLUR_RADIUS));
+        weight *= exp(-abs(depth - centerDepth) / abs(centerDepth) * DEPTH_SHARPNESS);
+        weight *= pow(max(dot(normal, centerNormal), 0.0), NORMAL_SHARPNESS);
+        result += texture(ssaoInput, uv).r * weight;
+        totalWeight += weight;
     }
-    FragColor = result / (4.0 * 4.0);
-}  
\ No newline at end of file
+    // the centre tap always has weight 1
+    FragColor = result / totalWeight;
+}
@@ -1,18 +1,18 @@
 #version 330 core
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec3 gAlbedo;
+// position is not stored, it is rebuilt from the depth buffer (common/gbuffer.glsl)
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedoSpec;
 
 in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
 
+#include "common/octahedral.glsl"
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
-    // and the diffuse per-fragment color
-    gAlbedo.rgb = vec3(0.95);
+    // store the per-fragment view space normals into the gbuffer
+    gNormal = encodeNormal(normalize(Normal));
+    // and the diffuse per-fragment color, the SSAO lighting pass uses no specular map
+    gAlbedoSpec = vec4(vec3(0.95), 1.0);
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #version 330 core
+// Defines:
+//   INSTANCED  model matrix from the IndirectRenderer instance attributes instead of the model uniform
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
@@ -9,12 +11,19 @@ out vec3 Normal;
 
 uniform bool invertedNormals;
 
+#ifdef INSTANCED
+layout (location = 8) in mat4 aModel;
+#else
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
 void main()
 {
+#ifdef INSTANCED
+    mat4 model = aModel;
+#endif
     vec4 viewPos = view * model * vec4(aPos, 1.0);
     FragPos = viewPos.xyz; 
     TexCoords = aTexCoords;
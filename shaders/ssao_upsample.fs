@@ -0,0 +1,52 @@
+#version 330 core
+// Bilateral upsample of the reduced resolution occlusion: the four nearest low resolution texels are blended
+// with bilinear weights, scaled down for texels whose surface differs in depth or orientation from this pixel.
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;
+
+#include "common/gbuffer.glsl"
+
+const float DEPTH_SHARPNESS = 32.0;
+const float NORMAL_SHARPNESS = 8.0;
+
+void main()
+{
+    vec2 lowSize = vec2(textureSize(ssaoInput, 0));
+    vec2 position = TexCoords * lowSize - 0.5;
+    vec2 base = floor(position);
+    vec2 f = position - base;
+
+    float depth = gbufferViewPosition(TexCoords).z;
+    vec3 normal = gbufferNormal(TexCoords);
+
+    float result = 0.0;
+    float totalWeight = 0.0;
+    float nearest = 0.0;
+    float nearestDifference = 1e30;
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 offset = vec2(i & 1, i >> 1);
+        // low resolution texel centre, its surface is the one the occlusion was computed for
+        vec2 uv = (base + offset + 0.5) / lowSize;
+        vec2 bilinear = mix(1.0 - f, f, offset);
+        float tapDepth = gbufferViewPosition(uv).z;
+        float difference = abs(tapDepth - depth) / abs(depth);
+        float weight = bilinear.x * bilinear.y;
+        weight *= exp(-difference * DEPTH_SHARPNESS);
+        weight *= pow(max(dot(gbufferNormal(uv), normal), 0.0), NORMAL_SHARPNESS);
+
+        float occlusion = texture(ssaoInput, uv).r;
+        result += occlusion * weight;
+        totalWeight += weight;
+        if (difference < nearestDifference)
+        {
+            nearestDifference = difference;
+            nearest = occlusion;
+        }
+    }
+    // thin features none of the taps belong to take the closest tap in depth
+    FragColor = totalWeight > 1e-4 ? result / totalWeight : nearest;
+}
@@ -0,0 +1,371 @@
+#include "ssao_renderer.h"
+
+#include "gbuffer.h"
+#include "geometry_arena.h"
+#include "profiler.h"
+#include "gl_resources.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+const unsigned int NoiseSize = 4;
+/* Share of the new frame in the GTAO history, about a ten frame average. */
+const float TemporalBlend = 0.1f;
+
+SSAORenderer::SSAORenderer() : width(0), height(0), mode(AO_MODE_SSAO), resolution(SSAO_HALF), kernelSize(16),
+	gtaoDirections(2), gtaoSteps(4), radius(0.5f), bias(0.025f), kernelProgram(0), noiseTexture(0), lowFBOs(), lowTextures(),
+	outputFBO(0), outputTexture(0), pyramidFBO(0), pyramidTexture(0), historyFBOs(), historyTextures(), historyIndex(0),
+	frameIndex(0), previousViewProjection(1.0f), timerQueries(), timerModes(), timerPending(), timerIndex(0), gpuTimes()
+{
+	generateKernel();
+}
+
+void SSAORenderer::generateKernel()
+{
+	/* Fixed seed, so the same settings always give the same image. */
+	std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
+	std::default_random_engine generator;
+	kernel.clear();
+	for (unsigned int i = 0; i < kernelSize; ++i) {
+		glm::vec3 sample(randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator));
+		sample = glm::normalize(sample);
+		sample *= randomFloats(generator);
+		/* Concentrate the samples near the fragment, whatever the kernel size. */
+		float scale = (float)i / kernelSize;
+		scale = 0.1f + 0.9f * scale * scale;
+		kernel.push_back(sample * scale);
+	}
+	kernelProgram = 0;
+}
+
+void SSAORenderer::setKernelSize(unsigned int size)
+{
+	unsigned int rounded = 8;
+	while (rounded < size && rounded < SSAO_MAX_KERNEL_SIZE) {
+		rounded *= 2;
+	}
+	if (rounded != kernelSize) {
+		kernelSize = rounded;
+		generateKernel();
+	}
+}
+
+void SSAORenderer::setMode(AO_Mode newMode)
+{
+	if (newMode != mode) {
+		mode = newMode;
+		/* The history is stale once the other mode ran in between. */
+		if (width > 0) {
+			create(width, height);
+		}
+	}
+}
+
+void SSAORenderer::setResolution(SSAO_Resolution newResolution)
+{
+	if (newResolution != resolution) {
+		resolution = newResolution;
+		if (width > 0) {
+			create(width, height);
+		}
+	}
+}
+
+void SSAORenderer::createNoise()
+{
+	/* Random rotations around the normal, tiled over the screen. */
+	std::uniform_real_distribution<float> randomFloats(0.0f, 1.0f);
+	std::default_random_engine generator;
+	vector<glm::vec3> noise;
+	for (unsigned int i = 0; i < NoiseSize * NoiseSize; i++) {
+		noise.push_back(glm::vec3(randomFloats(generator) * 2.0f - 1.0f, randomFloats(generator) * 2.0f - 1.0f, 0.0f));
+	}
+	glGenTextures(1, &noiseTexture);
+	glBindTexture(GL_TEXTURE_2D, noiseTexture);
+	GL_LABEL(RESOURCE_TEXTURE, noiseTexture, "ssao noise");
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, NoiseSize, NoiseSize, 0, GL_RGB, GL_FLOAT, &noise[0]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+}
+
+static void createTarget(const string &label, unsigned int &fbo, unsigned int &texture, GLenum internalFormat, GLenum format, int width, int height)
+{
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	GL_LABEL(RESOURCE_FRAMEBUFFER, fbo, label);
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	GL_LABEL(RESOURCE_TEXTURE, texture, label);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, NULL);
+	/* The blur and upsample pick their own taps, nearest keeps them exact. */
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "ERROR::SSAO::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+}
+
+void SSAORenderer::create(int width, int height)
+{
+	deleteTargets();
+	this->width = width;
+	this->height = height;
+	if (noiseTexture == 0) {
+		createNoise();
+		glGenQueries(2, timerQueries);
+	}
+
+	int lowWidth = std::max(width / resolution, 1);
+	int lowHeight = std::max(height / resolution, 1);
+	for (unsigned int i = 0; i < 2; i++) {
+		createTarget("ao " + std::to_string(i), lowFBOs[i], lowTextures[i], GL_R8, GL_RED, lowWidth, lowHeight);
+	}
+	createTarget("ao output", outputFBO, outputTexture, GL_R8, GL_RED, width, height);
+
+	if (mode == AO_MODE_GTAO) {
+		/* Mip levels are filled one by one from the level above, see renderGTAO. */
+		glGenTextures(1, &pyramidTexture);
+		glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+		GL_LABEL(RESOURCE_TEXTURE, pyramidTexture, "ao depth pyramid");
+		for (int level = 0; level < AO_PYRAMID_LEVELS; level++) {
+			glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(lowWidth >> level, 1), std::max(lowHeight >> level, 1), 0, GL_RED, GL_FLOAT, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, AO_PYRAMID_LEVELS - 1);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glGenFramebuffers(1, &pyramidFBO);
+		GL_LABEL(RESOURCE_FRAMEBUFFER, pyramidFBO, "ao depth pyramid");
+
+		for (unsigned int i = 0; i < 2; i++) {
+			createTarget("ao history " + std::to_string(i), historyFBOs[i], historyTextures[i], GL_RG16F, GL_RG, lowWidth, lowHeight);
+			/* Zero depth never matches, so the first frame starts without history. */
+			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
+		}
+		frameIndex = 0;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+unsigned int SSAORenderer::renderSSAO(const AOShaders &shaders, const glm::mat4 &projection, unsigned int gbufferUnit)
+{
+	Shader &ssaoShader = *shaders.ssao;
+	int lowWidth = std::max(width / resolution, 1);
+	int lowHeight = std::max(height / resolution, 1);
+	unsigned int inputUnit = gbufferUnit + 3;
+
+	GBuffer::setupShader(ssaoShader, gbufferUnit);
+	GBuffer::setMatrices(ssaoShader, projection, glm::mat4(1.0f));
+	ssaoShader.setInt("texNoise", inputUnit);
+	glUniformMatrix4fv(glGetUniformLocation(ssaoShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+	if (kernelProgram != ssaoShader.ID) {
+		glUniform3fv(glGetUniformLocation(ssaoShader.ID, "samples"), kernelSize, glm::value_ptr(kernel[0]));
+		kernelProgram = ssaoShader.ID;
+	}
+	ssaoShader.setInt("kernelSize", kernelSize);
+	ssaoShader.setFloat("radius", radius);
+	ssaoShader.setFloat("bias", bias);
+	/* Tile the noise once per target texel block, not per window pixel. */
+	float noiseScale[2] = { (float)lowWidth / NoiseSize, (float)lowHeight / NoiseSize };
+	ssaoShader.setVecN("noiseScale", noiseScale, 2);
+
+	glActiveTexture(GL_TEXTURE0 + inputUnit);
+	glBindTexture(GL_TEXTURE_2D, noiseTexture);
+	glBindFramebuffer(GL_FRAMEBUFFER, lowFBOs[0]);
+	glViewport(0, 0, lowWidth, lowHeight);
+	GeometryArena::get().drawScreenQuad();
+	return lowTextures[0];
+}
+
+unsigned int SSAORenderer::renderGTAO(const AOShaders &shaders, const glm::mat4 &projection, const glm::mat4 &view, unsigned int gbufferUnit)
+{
+	GeometryArena &arena = GeometryArena::get();
+	int lowWidth = std::max(width / resolution, 1);
+	int lowHeight = std::max(height / resolution, 1);
+	unsigned int inputUnit = gbufferUnit + 3;
+	float viewScale[2] = { 1.0f / projection[0][0], 1.0f / projection[1][1] };
+
+	/* Depth pyramid: level 0 is the linear view depth at the AO resolution, each further level keeps the closest
+	 * of four texels. While a level is written only the level above it is visible to the sampler, which keeps
+	 * reading and writing the same texture well defined. */
+	Shader &pyramidShader = *shaders.depthPyramid;
+	GBuffer::setupShader(pyramidShader, gbufferUnit);
+	GBuffer::setMatrices(pyramidShader, projection, glm::mat4(1.0f));
+	pyramidShader.setInt("depthPyramid", inputUnit);
+	glActiveTexture(GL_TEXTURE0 + inputUnit);
+	glBindFramebuffer(GL_FRAMEBUFFER, pyramidFBO);
+	for (int level = 0; level < AO_PYRAMID_LEVELS; level++) {
+		if (level == 0) {
+			/* Level 0 only reads the G-buffer. */
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+		else {
+			glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+		}
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, level);
+		glViewport(0, 0, std::max(lowWidth >> level, 1), std::max(lowHeight >> level, 1));
+		pyramidShader.setBool("firstLevel", level == 0);
+		arena.drawScreenQuad();
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, AO_PYRAMID_LEVELS - 1);
+	glViewport(0, 0, lowWidth, lowHeight);
+
+	/* Horizon search. The rotation sequence covers the half circle evenly over six frames. */
+	const float rotations[6] = { 60.0f, 300.0f, 180.0f, 240.0f, 120.0f, 0.0f };
+	const float offsets[4] = { 0.0f, 0.5f, 0.25f, 0.75f };
+	Shader &gtaoShader = *shaders.gtao;
+	gtaoShader.use();
+	gtaoShader.setInt("depthPyramid", inputUnit);
+	gtaoShader.setInt("gNormal", gbufferUnit + 1);
+	gtaoShader.setVecN("viewScale", viewScale, 2);
+	gtaoShader.setFloat("projectionScale", 0.5f * lowHeight * projection[1][1]);
+	gtaoShader.setInt("directionCount", gtaoDirections);
+	gtaoShader.setInt("stepCount", gtaoSteps);
+	gtaoShader.setFloat("radius", radius);
+	gtaoShader.setInt("maxLevel", AO_PYRAMID_LEVELS - 1);
+	gtaoShader.setFloat("temporalRotation", glm::radians(rotations[frameIndex % 6]) / gtaoDirections);
+	gtaoShader.setFloat("temporalOffset", offsets[(frameIndex / 6) % 4]);
+	glBindFramebuffer(GL_FRAMEBUFFER, lowFBOs[0]);
+	arena.drawScreenQuad();
+
+	/* Temporal accumulation into the next history target. */
+	unsigned int previous = historyIndex;
+	historyIndex = 1 - historyIndex;
+	glm::mat4 reprojection = previousViewProjection * glm::inverse(view);
+	Shader &temporalShader = *shaders.temporal;
+	temporalShader.use();
+	temporalShader.setInt("depthPyramid", inputUnit);
+	temporalShader.setInt("currentAO", inputUnit + 1);
+	temporalShader.setInt("history", inputUnit + 2);
+	temporalShader.setVecN("viewScale", viewScale, 2);
+	temporalShader.setFloat("blendFactor", TemporalBlend);
+	glUniformMatrix4fv(glGetUniformLocation(temporalShader.ID, "reprojection"), 1, GL_FALSE, glm::value_ptr(reprojection));
+	glActiveTexture(GL_TEXTURE0 + inputUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, lowTextures[0]);
+	glActiveTexture(GL_TEXTURE0 + inputUnit + 2);
+	glBindTexture(GL_TEXTURE_2D, historyTextures[previous]);
+	glBindFramebuffer(GL_FRAMEBUFFER, historyFBOs[historyIndex]);
+	arena.drawScreenQuad();
+
+	previousViewProjection = projection * view;
+	frameIndex++;
+	return historyTextures[historyIndex];
+}
+
+void SSAORenderer::readTimer(unsigned int index)
+{
+	if (!timerPending[index]) {
+		return;
+	}
+	int available = 0;
+	glGetQueryObjectiv(timerQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available) {
+		GLuint64 elapsed;
+		glGetQueryObjectui64v(timerQueries[index], GL_QUERY_RESULT, &elapsed);
+		gpuTimes[timerModes[index]] = elapsed / 1000000.0f;
+		timerPending[index] = false;
+	}
+}
+
+void SSAORenderer::render(const AOShaders &shaders, const glm::mat4 &projection, const glm::mat4 &view, unsigned int gbufferUnit)
+{
+	PROFILE_GPU_SCOPE("ssao");
+	GeometryArena &arena = GeometryArena::get();
+	unsigned int inputUnit = gbufferUnit + 3;
+
+	/* The query issued two frames ago is finished by now, reusing it never waits on the GPU. */
+	readTimer(timerIndex);
+	if (!timerPending[timerIndex]) {
+		glBeginQuery(GL_TIME_ELAPSED, timerQueries[timerIndex]);
+	}
+	glDisable(GL_DEPTH_TEST);
+
+	unsigned int occlusion = mode == AO_MODE_GTAO ? renderGTAO(shaders, projection, view, gbufferUnit) : renderSSAO(shaders, projection, gbufferUnit);
+
+	/* Separable bilateral blur, horizontal into the second target and vertical back, or straight into the
+	 * output at full resolution. */
+	Shader &blurShader = *shaders.blur;
+	GBuffer::setupShader(blurShader, gbufferUnit);
+	GBuffer::setMatrices(blurShader, projection, glm::mat4(1.0f));
+	blurShader.setInt("ssaoInput", inputUnit);
+	float directions[2][2] = { { 1.0f, 0.0f }, { 0.0f, 1.0f } };
+	unsigned int inputs[2] = { occlusion, lowTextures[1] };
+	unsigned int targets[2] = { lowFBOs[1], resolution == SSAO_FULL ? outputFBO : lowFBOs[0] };
+	for (unsigned int pass = 0; pass < 2; pass++) {
+		blurShader.setVecN("direction", directions[pass], 2);
+		glActiveTexture(GL_TEXTURE0 + inputUnit);
+		glBindTexture(GL_TEXTURE_2D, inputs[pass]);
+		glBindFramebuffer(GL_FRAMEBUFFER, targets[pass]);
+		arena.drawScreenQuad();
+	}
+
+	if (resolution != SSAO_FULL) {
+		Shader &upsampleShader = *shaders.upsample;
+		GBuffer::setupShader(upsampleShader, gbufferUnit);
+		GBuffer::setMatrices(upsampleShader, projection, glm::mat4(1.0f));
+		upsampleShader.setInt("ssaoInput", inputUnit);
+		glActiveTexture(GL_TEXTURE0 + inputUnit);
+		glBindTexture(GL_TEXTURE_2D, lowTextures[0]);
+		glBindFramebuffer(GL_FRAMEBUFFER, outputFBO);
+		glViewport(0, 0, width, height);
+		arena.drawScreenQuad();
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+
+	if (!timerPending[timerIndex]) {
+		glEndQuery(GL_TIME_ELAPSED);
+		timerModes[timerIndex] = mode;
+		timerPending[timerIndex] = true;
+	}
+	timerIndex = 1 - timerIndex;
+}
+
+void SSAORenderer::deleteTargets()
+{
+	if (outputFBO != 0) {
+		glDeleteFramebuffers(2, lowFBOs);
+		glDeleteTextures(2, lowTextures);
+		glDeleteFramebuffers(1, &outputFBO);
+		glDeleteTextures(1, &outputTexture);
+		lowFBOs[0] = lowFBOs[1] = lowTextures[0] = lowTextures[1] = 0;
+		outputFBO = outputTexture = 0;
+	}
+	if (pyramidFBO != 0) {
+		glDeleteFramebuffers(1, &pyramidFBO);
+		glDeleteTextures(1, &pyramidTexture);
+		glDeleteFramebuffers(2, historyFBOs);
+		glDeleteTextures(2, historyTextures);
+		pyramidFBO = pyramidTexture = 0;
+		historyFBOs[0] = historyFBOs[1] = historyTextures[0] = historyTextures[1] = 0;
+	}
+}
+
+void SSAORenderer::deleteBuffers()
+{
+	deleteTargets();
+	if (noiseTexture != 0) {
+		glDeleteTextures(1, &noiseTexture);
+		glDeleteQueries(2, timerQueries);
+		noiseTexture = 0;
+		timerPending[0] = timerPending[1] = false;
+	}
+	kernelProgram = 0;
+}
@@ -0,0 +1,146 @@
+#include "texture_atlas.h"
+#include "gl_resources.h"
+
+#include "stb_image.h"
+
+#include <iostream>
+
+TextureArrayAtlas::TextureArrayAtlas() : materialBuffer(0)
+{
+}
+
+int TextureArrayAtlas::findOpenPage(int width, int height)
+{
+	for (unsigned int i = 0; i < pages.size(); i++) {
+		if (pages[i].texture == 0 && pages[i].width == width && pages[i].height == height) {
+			return i;
+		}
+	}
+	if (pages.size() >= MAX_MATERIAL_PAGES) {
+		return -1;
+	}
+	Page page;
+	page.width = width;
+	page.height = height;
+	page.texture = 0;
+	pages.push_back(page);
+	return static_cast<int>(pages.size()) - 1;
+}
+
+TextureLayer TextureArrayAtlas::addTexture(const string &path)
+{
+	for (unsigned int i = 0; i < loaded.size(); i++) {
+		if (loaded[i].path == path) {
+			return loaded[i].layer;
+		}
+	}
+
+	TextureLayer result;
+	int width, height, nrComponents;
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrComponents, 4);
+	if (!data) {
+		std::cout << "Texture failed to load at path: " << path << std::endl;
+		return result;
+	}
+
+	int page = findOpenPage(width, height);
+	if (page < 0) {
+		std::cout << "ERROR::ATLAS::OUT_OF_PAGES " << path << " (" << width << "x" << height << ")" << std::endl;
+		stbi_image_free(data);
+		return result;
+	}
+
+	result.page = page;
+	result.layer = static_cast<int>(pages[page].pending.size());
+	pages[page].pending.push_back(PendingLayer{ path, data });
+	loaded.push_back(LoadedTexture{ path, result });
+	return result;
+}
+
+int TextureArrayAtlas::addMaterial(const AtlasMaterial &material)
+{
+	if (materials.size() >= MAX_MATERIALS) {
+		std::cout << "ERROR::ATLAS::MATERIAL_TABLE_FULL" << std::endl;
+		return -1;
+	}
+	materials.push_back(material);
+	return static_cast<int>(materials.size()) - 1;
+}
+
+void TextureArrayAtlas::build()
+{
+	for (unsigned int i = 0; i < pages.size(); i++) {
+		Page &page = pages[i];
+		if (page.texture != 0 || page.pending.empty()) {
+			continue;
+		}
+
+		GLsizei layers = static_cast<GLsizei>(page.pending.size());
+		glGenTextures(1, &page.texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, page.texture);
+		GL_LABEL(RESOURCE_TEXTURE, page.texture, "atlas page " + std::to_string(i));
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, page.width, page.height, layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		for (GLsizei layer = 0; layer < layers; layer++) {
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, page.width, page.height, 1, GL_RGBA, GL_UNSIGNED_BYTE, page.pending[layer].pixels);
+			stbi_image_free(page.pending[layer].pixels);
+		}
+		page.pending.clear();
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+
+	/* The table is always allocated at full size so the block size matches the shader declaration. */
+	if (materialBuffer == 0) {
+		glGenBuffers(1, &materialBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+		GL_LABEL(RESOURCE_BUFFER, materialBuffer, "atlas materials");
+		glBufferData(GL_UNIFORM_BUFFER, MAX_MATERIALS * sizeof(AtlasMaterial), NULL, GL_STATIC_DRAW);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, materialBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, materials.size() * sizeof(AtlasMaterial), materials.data());
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void TextureArrayAtlas::setupShader(Shader &shader, unsigned int firstUnit)
+{
+	shader.use();
+	for (unsigned int i = 0; i < MAX_MATERIAL_PAGES; i++) {
+		shader.setInt("materialPages[" + std::to_string(i) + "]", firstUnit + i);
+	}
+	unsigned int blockIndex = glGetUniformBlockIndex(shader.ID, "MaterialTable");
+	if (blockIndex != GL_INVALID_INDEX) {
+		glUniformBlockBinding(shader.ID, blockIndex, MATERIAL_TABLE_BINDING);
+	}
+}
+
+void TextureArrayAtlas::bind(unsigned int firstUnit)
+{
+	for (unsigned int i = 0; i < pages.size(); i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, pages[i].texture);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_TABLE_BINDING, materialBuffer);
+}
+
+void TextureArrayAtlas::deleteTextures()
+{
+	for (unsigned int i = 0; i < pages.size(); i++) {
+		for (unsigned int j = 0; j < pages[i].pending.size(); j++) {
+			stbi_image_free(pages[i].pending[j].pixels);
+		}
+		if (pages[i].texture != 0) {
+			glDeleteTextures(1, &pages[i].texture);
+		}
+	}
+	pages.clear();
+	loaded.clear();
+	if (materialBuffer != 0) {
+		glDeleteBuffers(1, &materialBuffer);
+		materialBuffer = 0;
+	}
+}